@@ -11,8 +11,11 @@ extern "C" {
 // Professional Audio Output System for macOS
 // Supports 16+ voices, adjustable buffers, latency monitoring, and real-time performance tracking
 
+struct dx7_engine;  // midi_input.h
+
 // Audio output system initialization and control
-void* audio_output_initialize(double sample_rate);
+// The render callback pulls its audio from engine
+void* audio_output_initialize(double sample_rate, struct dx7_engine* engine);
 void audio_output_shutdown(void* handle);
 bool audio_output_start(void* handle);
 void audio_output_stop(void* handle);
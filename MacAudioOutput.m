@@ -13,6 +13,7 @@
 
 // Audio context structure
 typedef struct {
+    dx7_engine_t* engine;   // Engine the render callback plays
     AudioUnit output_unit;
     AudioStreamBasicDescription stream_format;
     double sample_rate;
@@ -65,7 +66,7 @@ static bool configure_stream_format(mac_audio_context_t* context);
 static void update_performance_stats(mac_audio_context_t* context, double callback_time_ms);
 
 // Initialize audio output system
-void* audio_output_initialize(double sample_rate) {
+void* audio_output_initialize(double sample_rate, struct dx7_engine* engine) {
     mac_audio_context_t* context = calloc(1, sizeof(mac_audio_context_t));
     if (!context) {
         NSLog(@"❌ Failed to allocate audio context");
@@ -84,6 +85,7 @@ void* audio_output_initialize(double sample_rate) {
     }
     
     // Set parameters
+    context->engine = engine;
     context->sample_rate = sample_rate;
     context->buffer_size_frames = 512; // Default
     
@@ -366,7 +368,7 @@ static OSStatus audio_render_callback(void *inRefCon,
     
     // Generate mono audio using our synthesis system
     pthread_mutex_lock(&context->audio_mutex);
-    generate_audio_block(context->mono_buffer, frame_count, context->sample_rate);
+    generate_audio_block(context->engine, context->mono_buffer, frame_count, context->sample_rate);
     pthread_mutex_unlock(&context->audio_mutex);
     
     // Convert mono to stereo interleaved with gentle limiting
@@ -0,0 +1,245 @@
+// Generated by gen_algorithm_kernels.py from the algorithms[] table in
+// algorithms.c - do not edit, run 'make kernels' after changing the table
+//
+// DX7_ALGORITHM_n is the straight-line body of algorithm n. The includer
+// defines the operations for its sample type:
+//   ALG_OP(op, modulation)       replace op's output with the modulated sine
+//   ALG_TERM(op, strength)       op's contribution as a modulator
+//   ALG_CARRIER(op)              op's output as a carrier
+//   ALG_OUTPUT(sum, carriers)    normalise the carrier sum
+// Operators are 0-indexed; modulated operators come in topological order.
+
+#ifndef ALGORITHM_KERNELS_H
+#define ALGORITHM_KERNELS_H
+
+// Algorithm 1: 6→5→4→3→2→1 (Classic FM chain)
+// Evaluation order: 5 4 3 2
+#define DX7_ALGORITHM_1 \
+    ALG_OP(4, ALG_TERM(5, 1)); \
+    ALG_OP(3, ALG_TERM(4, 1)); \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0), 1);
+
+// Algorithm 2: 6→5→4→3→2, 1 (Two separate chains)
+// Evaluation order: 5 4 3
+#define DX7_ALGORITHM_2 \
+    ALG_OP(4, ALG_TERM(4, 1)); \
+    ALG_OP(3, ALG_TERM(3, 1)); \
+    ALG_OP(2, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1), 2);
+
+// Algorithm 3: 6→5→4→3, 2→1 (Two separate chains)
+// Evaluation order: 5 4 1
+#define DX7_ALGORITHM_3 \
+    ALG_OP(4, ALG_TERM(5, 1)); \
+    ALG_OP(3, ALG_TERM(4, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2), 2);
+
+// Algorithm 4: 6→5→4, 3→2→1 (E.PIANO algorithm - two chains)
+// Evaluation order: 5 2 1
+#define DX7_ALGORITHM_4 \
+    ALG_OP(4, ALG_TERM(5, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(3), 2);
+
+// Algorithm 5: 6→5, 4→3→2→1 (Mixed)
+// Evaluation order: 3 2 1
+#define DX7_ALGORITHM_5 \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(4), 2);
+
+// Algorithm 6: 6→5, 4→3→2, 1 (Three separate outputs)
+// Evaluation order: 3 2
+#define DX7_ALGORITHM_6 \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(4), 3);
+
+// Algorithm 7: 6→5, 4→3, 2→1 (Three chains)
+// Evaluation order: 1
+#define DX7_ALGORITHM_7 \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(4), 3);
+
+// Algorithm 8: 6→5, 4→3, 2, 1 (Four outputs)
+#define DX7_ALGORITHM_8 \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(2) + ALG_CARRIER(4), 4);
+
+// Algorithm 9: 6→5, 4, 3→2→1 (Mixed)
+// Evaluation order: 2 1
+#define DX7_ALGORITHM_9 \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(3) + ALG_CARRIER(4), 3);
+
+// Algorithm 10: 6→5, 4, 3→2, 1 (Four outputs)
+// Evaluation order: 2
+#define DX7_ALGORITHM_10 \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(3) + ALG_CARRIER(4), 4);
+
+// Algorithm 11: 6→5, 4, 3, 2→1 (Four outputs)
+// Evaluation order: 1
+#define DX7_ALGORITHM_11 \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(3) + ALG_CARRIER(4), 4);
+
+// Algorithm 12: 6→5, 4, 3, 2, 1 (Five separate outputs)
+#define DX7_ALGORITHM_12 \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(2) + ALG_CARRIER(3) + ALG_CARRIER(4), 5);
+
+// Algorithm 13: 6, 5→4→3→2→1 (One modulator chain)
+// Evaluation order: 4 3 2 1
+#define DX7_ALGORITHM_13 \
+    ALG_OP(3, ALG_TERM(4, 1)); \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(5), 2);
+
+// Algorithm 14: 6, 5→4→3→2, 1 (Two separate outputs)
+// Evaluation order: 4 3 2
+#define DX7_ALGORITHM_14 \
+    ALG_OP(3, ALG_TERM(4, 1)); \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(5), 3);
+
+// Algorithm 15: 6, 5→4→3, 2→1 (Three outputs)
+// Evaluation order: 4 1
+#define DX7_ALGORITHM_15 \
+    ALG_OP(3, ALG_TERM(4, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(5), 3);
+
+// Algorithm 16: 6, 5→4, 3→2→1 (Three outputs)
+// Evaluation order: 2 1
+#define DX7_ALGORITHM_16 \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(3) + ALG_CARRIER(5), 3);
+
+// Algorithm 17: 6, 5→4, 3→2, 1 (Four outputs)
+// Evaluation order: 2
+#define DX7_ALGORITHM_17 \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(3) + ALG_CARRIER(5), 4);
+
+// Algorithm 18: 6, 5→4, 3, 2→1 (Four outputs)
+// Evaluation order: 1
+#define DX7_ALGORITHM_18 \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(3) + ALG_CARRIER(5), 4);
+
+// Algorithm 19: 6, 5, 4→3→2→1 (Three outputs with one chain)
+// Evaluation order: 3 2 1
+#define DX7_ALGORITHM_19 \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(4) + ALG_CARRIER(5), 3);
+
+// Algorithm 20: 6, 5, 4→3→2, 1 (Four outputs)
+// Evaluation order: 3 2
+#define DX7_ALGORITHM_20 \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(4) + ALG_CARRIER(5), 4);
+
+// Algorithm 21: 6, 5, 4→3, 2→1 (Four outputs)
+// Evaluation order: 1
+#define DX7_ALGORITHM_21 \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(4) + ALG_CARRIER(5), 4);
+
+// Algorithm 22: 6, 5, 4, 3→2→1 (Four outputs)
+// Evaluation order: 2 1
+#define DX7_ALGORITHM_22 \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(3) + ALG_CARRIER(4) + ALG_CARRIER(5), 4);
+
+// Algorithm 23: 6, 5, 4, 3→2, 1 (Five outputs)
+// Evaluation order: 2
+#define DX7_ALGORITHM_23 \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(3) + ALG_CARRIER(4) + ALG_CARRIER(5), 5);
+
+// Algorithm 24: 6, 5, 4, 3, 2→1 (Five outputs)
+// Evaluation order: 1
+#define DX7_ALGORITHM_24 \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(3) + ALG_CARRIER(4) + ALG_CARRIER(5), 5);
+
+// Algorithm 25: 6, 5, 4, 3, 2, 1 (All separate - additive synthesis)
+#define DX7_ALGORITHM_25 \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(2) + ALG_CARRIER(3) + ALG_CARRIER(4) + ALG_CARRIER(5), 6);
+
+// Algorithm 26: (6+5)→4→3→2→1 (Parallel modulators)
+// Evaluation order: 4 3 2 1
+#define DX7_ALGORITHM_26 \
+    ALG_OP(3, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0), 1);
+
+// Algorithm 27: (6+5)→4→3→2, 1 (Parallel modulators to chain)
+// Evaluation order: 4 3 2
+#define DX7_ALGORITHM_27 \
+    ALG_OP(3, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(2, ALG_TERM(3, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1), 2);
+
+// Algorithm 28: (6+5)→4→3, 2→1 (Mixed parallel)
+// Evaluation order: 4 1
+#define DX7_ALGORITHM_28 \
+    ALG_OP(3, ALG_TERM(3, 1) + ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2), 2);
+
+// Algorithm 29: (6+5)→4, 3→2→1 (Parallel to separate chains)
+// Evaluation order: 5 2 1
+#define DX7_ALGORITHM_29 \
+    ALG_OP(4, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(3), 2);
+
+// Algorithm 30: (6+5)→4, 3→2, 1 (Multiple outputs)
+// Evaluation order: 4 2
+#define DX7_ALGORITHM_30 \
+    ALG_OP(3, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(1, ALG_TERM(2, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(3), 3);
+
+// Algorithm 31: (6+5)→4, 3, 2→1 (Multiple outputs)
+// Evaluation order: 4 1
+#define DX7_ALGORITHM_31 \
+    ALG_OP(3, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(0, ALG_TERM(1, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(2) + ALG_CARRIER(3), 3);
+
+// Algorithm 32: (6+5)→(4+3+2+1) (All modulated by parallel pair)
+// Evaluation order: 4 3 2 1
+#define DX7_ALGORITHM_32 \
+    ALG_OP(3, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(2, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(1, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    ALG_OP(0, ALG_TERM(4, 1) + ALG_TERM(5, 1)); \
+    return ALG_OUTPUT(ALG_CARRIER(0) + ALG_CARRIER(1) + ALG_CARRIER(2) + ALG_CARRIER(3), 4);
+
+// Expand X(n) for every algorithm, 1-32
+#define DX7_ALGORITHM_LIST(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) \
+    X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) \
+    X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32)
+
+#endif // ALGORITHM_KERNELS_H
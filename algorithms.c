@@ -110,55 +110,53 @@ static algorithm_def_t algorithms[33] = { // Index 0 unused, algorithms 1-32
     {{1,2,3,4}, 4, {{0,0,0,0,0,0}, {0,0,0,0,0,0}, {0,0,0,0,0,0}, {0,0,0,0,0,0}, {1,1,1,1,0,0}, {1,1,1,1,0,0}}}
 };
 
-double apply_fm_modulation(double carrier_freq, double modulator_output, double mod_index) {
-    return sin(TWO_PI * carrier_freq + modulator_output * mod_index);
+double apply_fm_modulation(dx7_sine_fn_t sine, double carrier_freq, double modulator_output, double mod_index) {
+    return dx7_sine_radians(sine, TWO_PI * carrier_freq + modulator_output * mod_index);
 }
 
-double process_algorithm(const double* op_outputs, const double* op_levels, int algorithm, double feedback_val) {
+// Straight-line kernels generated from the table above (make kernels)
+#include "algorithm_kernels.h"
+
+#define ALG_OP(op, modulation) processed_ops[op] = apply_fm_modulation(sine, 1.0, (modulation), 1.0)
+#define ALG_TERM(op, strength) processed_ops[op] * ((double)(strength) * op_levels[op] * 2.0)
+#define ALG_CARRIER(op) processed_ops[op]
+#define ALG_OUTPUT(sum, carriers) ((sum) / sqrt((double)(carriers))) // Normalize to prevent clipping
+
+#define ALGORITHM_KERNEL(n) \
+static double algorithm_kernel_##n(const double* op_outputs, const double* op_levels, double feedback_val, \
+                                   dx7_sine_fn_t sine) { \
+    double processed_ops[MAX_OPERATORS]; \
+    for (int i = 0; i < MAX_OPERATORS; i++) { \
+        processed_ops[i] = op_outputs[i] * op_levels[i]; \
+    } \
+    if (feedback_val != 0.0) { \
+        processed_ops[0] = dx7_sine_radians(sine, TWO_PI * processed_ops[0] + feedback_val); \
+    } \
+    DX7_ALGORITHM_##n \
+}
+DX7_ALGORITHM_LIST(ALGORITHM_KERNEL)
+#undef ALGORITHM_KERNEL
+
+#define ALGORITHM_ENTRY(n) algorithm_kernel_##n,
+static const dx7_algorithm_fn_t algorithm_kernels[33] = {
+    NULL, // Index 0 unused
+    DX7_ALGORITHM_LIST(ALGORITHM_ENTRY)
+};
+#undef ALGORITHM_ENTRY
+
+// Kernel for an algorithm number - look up once per note, not per sample
+dx7_algorithm_fn_t get_algorithm_kernel(int algorithm) {
     if (algorithm < 1 || algorithm > 32) {
         algorithm = 1; // Default to algorithm 1
     }
-    
-    const algorithm_def_t* alg = &algorithms[algorithm];
-    double final_output = 0.0;
-    double processed_ops[MAX_OPERATORS];
-    
-    // Copy original outputs and scale by operator levels
-    for (int i = 0; i < MAX_OPERATORS; i++) {
-        processed_ops[i] = op_outputs[i] * op_levels[i];
-    }
-    
-    // Apply feedback to operator 1 (0-indexed as operator 0)
-    if (feedback_val != 0.0) {
-        processed_ops[0] = sin(TWO_PI * processed_ops[0] + feedback_val);
-    }
-    
-    // Process modulation matrix
-    for (int modulator = 0; modulator < MAX_OPERATORS; modulator++) {
-        for (int carrier = 0; carrier < MAX_OPERATORS; carrier++) {
-            if (algorithms[algorithm].modulation_matrix[modulator][carrier] > 0) {
-                // Apply FM modulation - modulator level affects modulation depth
-                double mod_depth = (double)algorithms[algorithm].modulation_matrix[modulator][carrier] * 
-                                 op_levels[modulator] * 2.0; // Scale modulation by modulator level
-                processed_ops[carrier] = apply_fm_modulation(1.0, processed_ops[modulator], mod_depth);
-            }
-        }
-    }
-    
-    // Sum carrier outputs (already scaled by their levels)
-    for (int i = 0; i < alg->num_carriers; i++) {
-        int carrier_idx = alg->carriers[i] - 1; // Convert to 0-indexed
-        if (carrier_idx >= 0 && carrier_idx < MAX_OPERATORS) {
-            final_output += processed_ops[carrier_idx];
-        }
-    }
-    
-    // Normalize by number of carriers to prevent clipping
-    if (alg->num_carriers > 0) {
-        final_output /= sqrt((double)alg->num_carriers);
-    }
-    
-    return final_output;
+    return algorithm_kernels[algorithm];
+}
+
+// Modulated operators are evaluated in topological order, so chains like
+// 6→5→4 see their modulators' final outputs, and parallel modulators sum
+double process_algorithm(const double* op_outputs, const double* op_levels, int algorithm, double feedback_val,
+                         dx7_sine_fn_t sine) {
+    return get_algorithm_kernel(algorithm)(op_outputs, op_levels, feedback_val, sine);
 }
 
 void get_algorithm_routing(int algorithm, int* carriers, int* num_carriers, 
@@ -180,3 +178,51 @@ void get_algorithm_routing(int algorithm, int* carriers, int* num_carriers,
         }
     }
 }
+
+// Operators that have to be computed for the output to be right
+// sounding has bit i set when operator i can be non-zero (output level and
+// envelope). A sounding carrier is live, and so is a sounding operator that
+// modulates a live one or any carrier: ALG_OP replaces a modulated carrier
+// with the sine of its modulation, unscaled by its own level, so it plays
+// while a modulator does even with its envelope parked at silence. Such a
+// carrier is live too. Zero means the whole voice is silent.
+uint8_t dx7_algorithm_live_ops(int algorithm, uint8_t sounding) {
+    if (algorithm < 1 || algorithm > 32) {
+        algorithm = 1;
+    }
+    
+    const algorithm_def_t* alg = &algorithms[algorithm];
+    uint8_t carriers = 0;
+    for (int i = 0; i < alg->num_carriers; i++) {
+        carriers |= (uint8_t)(1u << (alg->carriers[i] - 1)); // Carriers are 1-indexed
+    }
+    uint8_t live = carriers & sounding;
+    
+    // Each pass climbs one level up the modulator chains
+    for (bool grew = true; grew; ) {
+        grew = false;
+        for (int mod = 0; mod < MAX_OPERATORS; mod++) {
+            uint8_t bit = (uint8_t)(1u << mod);
+            if ((live & bit) || !(sounding & bit)) continue;
+            
+            for (int op = 0; op < MAX_OPERATORS; op++) {
+                if (alg->modulation_matrix[mod][op] && ((live | carriers) & (1u << op))) {
+                    live |= bit;
+                    grew = true;
+                    break;
+                }
+            }
+        }
+    }
+    
+    // Silent carriers still sounding through a live modulator
+    for (int mod = 0; mod < MAX_OPERATORS; mod++) {
+        if (!(live & (1u << mod))) continue;
+        for (int op = 0; op < MAX_OPERATORS; op++) {
+            if (alg->modulation_matrix[mod][op] && (carriers & (1u << op))) {
+                live |= (uint8_t)(1u << op);
+            }
+        }
+    }
+    return live;
+}
@@ -0,0 +1,76 @@
+#include "dx7.h"
+
+// Build the per-note tables for a patch played at sample_rate
+// Every value is computed with the same expressions init_operators() uses,
+// so a voice started from the tables is identical to one built from scratch
+void compile_patch(const dx7_patch_t* patch, int sample_rate, dx7_compiled_patch_t* compiled) {
+    memcpy(&compiled->patch, patch, sizeof(dx7_patch_t));
+    compiled->sample_rate = sample_rate;
+    compiled->algorithm_fn = get_algorithm_kernel(patch->algorithm);
+
+    for (int note = 0; note < DX7_NOTE_COUNT; note++) {
+        compiled->note_freq[note] = midi_note_to_frequency(note);
+    }
+
+    for (int i = 0; i < MAX_OPERATORS; i++) {
+        const dx7_operator_t* op = &compiled->patch.operators[i];
+        dx7_compiled_operator_t* cop = &compiled->operators[i];
+
+        double detune_factor = pow(2.0, (op->detune / 7.0) * 0.01); // About 1% per detune unit
+
+        for (int note = 0; note < DX7_NOTE_COUNT; note++) {
+            cop->freq[note] = compiled->note_freq[note] * op->freq_ratio;
+            cop->freq[note] *= detune_factor;
+
+            cop->level_scale[note] = calculate_key_scaling(
+                note,
+                op->key_level_scale_break_point,
+                op->key_level_scale_left_depth,
+                op->key_level_scale_right_depth,
+                op->key_level_scale_left_curve,
+                op->key_level_scale_right_curve
+            );
+
+            double key_distance = (double)(note - 60) / 12.0; // Distance from C4 in octaves
+            cop->rate_scale[note] = key_distance * (op->key_rate_scaling / 7.0);
+
+            for (int stage = ENV_ATTACK; stage < ENV_RELEASE; stage++) {
+                cop->env_rates[note][stage] = envelope_stage_rate(op, stage, cop->rate_scale[note], sample_rate);
+            }
+        }
+    }
+}
+
+// Note-on from a compiled patch - table lookups only, no pow() or exp()
+void init_operators_compiled(voice_state_t* voice, const dx7_compiled_patch_t* compiled,
+                             int midi_note, double velocity, int control_rate, dx7_sine_fn_t sine_fn) {
+    voice->note_freq = compiled->note_freq[midi_note];
+    voice->midi_note = midi_note;
+    voice->velocity = velocity;
+    voice->samples_played = 0;
+    dx7_lfo_reset(&voice->lfo, (uint32_t)midi_note);
+    voice->algorithm_fn = compiled->algorithm_fn;
+    voice->sample_rate = compiled->sample_rate;
+    voice->control_rate = control_rate;
+    voice->sine_fn = sine_fn;
+
+    for (int i = 0; i < MAX_OPERATORS; i++) {
+        const dx7_compiled_operator_t* cop = &compiled->operators[i];
+        operator_state_t* op_state = &voice->operators[i];
+        envelope_state_t* env = &op_state->env;
+
+        op_state->phase = 0;
+        op_state->freq = cop->freq[midi_note];
+        op_state->level_scale = cop->level_scale[midi_note];
+        op_state->rate_scale = cop->rate_scale[midi_note];
+        op_state->output = 0.0;
+
+        env->stage = ENV_ATTACK;
+        env->level = 0.0;
+        env->samples_in_stage = 0;
+        env->note_rates = cop->env_rates[midi_note];
+        env->sample_rate = compiled->sample_rate;
+        env->rate = env->note_rates[ENV_ATTACK];
+        env->target = (double)compiled->patch.operators[i].env_levels[ENV_ATTACK] / 99.0;
+    }
+}
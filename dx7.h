@@ -7,25 +7,77 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <pthread.h>
 #include <sndfile.h>
 #include "midi_manager.h"
 
 #define MAX_OPERATORS 6
-// Default sample rate (can be overridden)
-extern int g_sample_rate;
+// Default sample rate (-s overrides it; every engine and render has its own)
+#define DX7_DEFAULT_SAMPLE_RATE 48000
 #define ENVELOPE_STAGES 4
+
+// Frames rendered per inner pass of process_operators_block()
+#define DX7_BLOCK_SIZE 64
+
+// Default control rate: samples between envelope and LFO updates, with
+// levels ramped linearly in between. A power of two up to DX7_BLOCK_SIZE;
+// 1 updates every sample (override with -DDX7_CONTROL_RATE=32 etc.)
+#ifndef DX7_CONTROL_RATE
+#define DX7_CONTROL_RATE 16
+#endif
 #define MAX_ALGORITHMS 32
 #define MAX_PATCH_NAME 32
 
 // MIDI note number for C3
 #define MIDI_C3 60
 
+// Phase accumulator resolution: 2^32 counts per oscillator cycle
+#define DX7_PHASE_SCALE 4294967296.0
+
+// Sine kernels (see sine.c)
+typedef enum {
+    DX7_SINE_LIBM = 0,    // libm sin() - reference path
+    DX7_SINE_TABLE,       // Interpolated quarter-wave table
+    DX7_SINE_POLY         // Odd polynomial approximation
+} dx7_sine_kernel_t;
+
+// Build-time default kernel (override with -DDX7_SINE_KERNEL=DX7_SINE_POLY etc.)
+#ifndef DX7_SINE_KERNEL
+#define DX7_SINE_KERNEL DX7_SINE_TABLE
+#endif
+
+// Sine of a 32-bit phase (0 to 2^32 = one cycle)
+typedef double (*dx7_sine_fn_t)(uint32_t phase);
+
+// LFO waveforms (patch lfo_wave)
+typedef enum {
+    DX7_LFO_TRIANGLE = 0,
+    DX7_LFO_SAW_DOWN,
+    DX7_LFO_SAW_UP,
+    DX7_LFO_SQUARE,
+    DX7_LFO_SINE,
+    DX7_LFO_SAMPLE_HOLD,
+    DX7_LFO_WAVE_COUNT
+} dx7_lfo_wave_t;
+
+// LFO oscillator state (see lfo.c)
+// One runs per patch in play mode and every voice reads its values; voices
+// only advance their own when the patch asks for key sync
+typedef struct {
+    uint32_t phase;       // Same scale as the operator phases
+    uint32_t random;      // Sample & hold generator
+    double hold;          // Current sample & hold level
+} dx7_lfo_t;
+
 // Envelope stage indices
 #define ENV_ATTACK 0
 #define ENV_DECAY1 1
 #define ENV_DECAY2 2
 #define ENV_RELEASE 3
 
+// Envelope level treated as silence (-60 dB) for operator and voice culling
+#define DX7_SILENCE_LEVEL 0.001
+
 // DX7 Operator structure
 typedef struct {
     // Frequency parameters
@@ -39,6 +91,7 @@ typedef struct {
     // Output and scaling
     int output_level;      // 0-99
     int key_vel_sens;      // 0-7
+    int amp_mod_sens;      // 0-3 (carried through conversions, not rendered yet)
     
     // Keyboard scaling
     int key_level_scale_break_point;  // 0-99 (MIDI note)
@@ -51,6 +104,7 @@ typedef struct {
     
     // Oscillator sync
     int osc_sync;         // 0-1
+    int osc_mode;         // 0 = ratio, 1 = fixed frequency (carried through, played as ratio)
 } dx7_operator_t;
 
 // DX7 Patch structure
@@ -93,11 +147,13 @@ typedef struct {
     double rate;          // Current rate
     double target;        // Target level for current stage
     int samples_in_stage; // Samples elapsed in current stage
+    const double* note_rates; // Precompiled attack/decay rates for this note, or NULL
+    int sample_rate;      // Rate the per-sample increments are for
 } envelope_state_t;
 
 // Operator state for runtime
 typedef struct {
-    double phase;         // Current phase (0.0-1.0)
+    uint32_t phase;       // Current phase (2^32 = one cycle)
     double freq;          // Current frequency in Hz
     double output;        // Current output value
     envelope_state_t env; // Envelope state
@@ -105,31 +161,106 @@ typedef struct {
     double rate_scale;    // Keyboard rate scaling factor
 } operator_state_t;
 
+// Straight-line algorithm kernel: operator outputs and levels in, sample out
+typedef double (*dx7_algorithm_fn_t)(const double* op_outputs, const double* op_levels, double feedback_val,
+                                     dx7_sine_fn_t sine);
+
 // Voice state for runtime
 typedef struct {
     operator_state_t operators[MAX_OPERATORS];
     double note_freq;     // Base note frequency
     int midi_note;        // MIDI note number
     double velocity;      // Note velocity (0.0-1.0)
-    int samples_played;   // Total samples played
-    double lfo_phase;     // LFO phase
+    int64_t samples_played; // Total samples played (hours at 192 kHz overflow an int)
+    dx7_lfo_t lfo;        // Key-synced LFO (unused while a shared one is supplied)
+    dx7_algorithm_fn_t algorithm_fn; // Selected at note on from the patch algorithm
+    int sample_rate;      // Rate the voice renders at
+    int control_rate;     // Samples between envelope and LFO updates
+    dx7_sine_fn_t sine_fn; // Oscillator and algorithm sine kernel
 } voice_state_t;
 
+// Modulation shared by every voice for one process_operators_block() call
+typedef struct {
+    const double* lfo_values;  // Shared LFO at the control points (dx7_lfo_render), NULL for the voice's own
+    double pitch_bend_start;   // Pitch bend frequency ratio before the first frame
+    double pitch_bend;         // Ratio reached at the last frame, ramped linearly in between
+    double mod_wheel;          // 0.0 to 1.0, sets the speed of the voice's own LFO
+} dx7_block_mod_t;
+
+// Compiled patch: everything note-on needs, precomputed for all 128 notes
+// Built once when a patch is loaded or changed; note-on is then a table copy
+#define DX7_NOTE_COUNT 128
+
+typedef struct {
+    double freq[DX7_NOTE_COUNT];          // Note frequency x ratio x detune
+    double level_scale[DX7_NOTE_COUNT];   // Keyboard level scaling
+    double rate_scale[DX7_NOTE_COUNT];    // Keyboard rate scaling
+    double env_rates[DX7_NOTE_COUNT][ENV_RELEASE]; // Increments entering attack, decay 1, decay 2
+} dx7_compiled_operator_t;
+
+typedef struct {
+    dx7_patch_t patch;                    // Source parameters
+    int sample_rate;                      // Rate the envelope increments are for
+    double note_freq[DX7_NOTE_COUNT];     // Base frequency per MIDI note
+    dx7_compiled_operator_t operators[MAX_OPERATORS];
+    dx7_algorithm_fn_t algorithm_fn;
+} dx7_compiled_patch_t;
+
 // Function declarations from envelope.c
 double dx7_envelope_rate_to_time(int rate, int level_diff);
-void init_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale);
+void init_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale, int sample_rate);
 double update_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale);
 void trigger_release(envelope_state_t* env, const dx7_operator_t* op, double rate_scale);
+double advance_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale, int samples);
+double envelope_stage_rate(const dx7_operator_t* op, int stage, double rate_scale, int sample_rate);
+bool envelope_is_silent(int stage, double level, double rate);
 
 // Function declarations from oscillators.c
-void init_operators(voice_state_t* voice, const dx7_patch_t* patch, int midi_note, double velocity);
+bool dx7_control_rate_valid(int samples);
+void init_operators(voice_state_t* voice, const dx7_patch_t* patch, int midi_note, double velocity,
+                    int sample_rate, int control_rate, dx7_sine_fn_t sine_fn);
 double process_operators(voice_state_t* voice, const dx7_patch_t* patch);
+void process_operators_block(voice_state_t* voice, const dx7_patch_t* patch, const dx7_block_mod_t* mod,
+                             double* output, int frame_count);
+void dx7_render_note(voice_state_t* voice, const dx7_patch_t* patch, float* output, int frame_count);
+uint8_t dx7_voice_live_ops(const voice_state_t* voice, const dx7_patch_t* patch);
 double midi_note_to_frequency(int midi_note);
 double calculate_key_scaling(int midi_note, int break_point, int left_depth, int right_depth, 
                            int left_curve, int right_curve);
 
+// Function declarations from sine.c
+void dx7_sine_init(void);
+dx7_sine_fn_t dx7_sine_kernel_fn(dx7_sine_kernel_t kernel);
+const char* dx7_sine_kernel_name(dx7_sine_kernel_t kernel);
+int dx7_sine_kernel_from_name(const char* name);
+double dx7_sine_radians(dx7_sine_fn_t sine, double radians);
+double dx7_sine_libm(uint32_t phase);
+double dx7_sine_table(uint32_t phase);
+double dx7_sine_poly(uint32_t phase);
+
+// Function declarations from lfo.c
+void dx7_lfo_init(void);
+const char* dx7_lfo_wave_name(int wave);
+void dx7_lfo_reset(dx7_lfo_t* lfo, uint32_t seed);
+double dx7_lfo_speed(const dx7_patch_t* patch, double mod_wheel);
+uint32_t dx7_lfo_increment(const dx7_patch_t* patch, double mod_wheel, int sample_rate);
+double dx7_lfo_value(const dx7_lfo_t* lfo, int wave);
+double dx7_lfo_advance(dx7_lfo_t* lfo, int wave, uint32_t delta);
+int dx7_lfo_render(dx7_lfo_t* lfo, const dx7_patch_t* patch, double mod_wheel, int sample_rate,
+                   int control_rate, int frame_count, double* values);
+double dx7_lfo_delay_samples(const dx7_patch_t* patch, int sample_rate);
+double dx7_lfo_delay_gain(double delay_samples, int64_t samples);
+
+// Function declarations from compiled_patch.c
+void compile_patch(const dx7_patch_t* patch, int sample_rate, dx7_compiled_patch_t* compiled);
+void init_operators_compiled(voice_state_t* voice, const dx7_compiled_patch_t* compiled,
+                             int midi_note, double velocity, int control_rate, dx7_sine_fn_t sine_fn);
+
 // Function declarations from algorithms.c
-double process_algorithm(const double* op_outputs, const double* op_levels, int algorithm, double feedback_val);
+double process_algorithm(const double* op_outputs, const double* op_levels, int algorithm, double feedback_val,
+                         dx7_sine_fn_t sine);
+dx7_algorithm_fn_t get_algorithm_kernel(int algorithm);
+uint8_t dx7_algorithm_live_ops(int algorithm, uint8_t sounding);
 void get_algorithm_routing(int algorithm, int* carriers, int* num_carriers, 
                           int routing[MAX_OPERATORS][MAX_OPERATORS]);
 
@@ -146,31 +277,197 @@ typedef struct {
     uint8_t end_sysex;       // 0xF7
 } __attribute__((packed)) dx7_sysex_voice_t;
 
+// 32-voice bulk dump (VMEM): F0 43 0n 09 20 00, 32 packed 128-byte voices,
+// checksum, F7
+#define DX7_SYSEX_VCED_SIZE    155     // Single voice (format 0) payload
+#define DX7_SYSEX_VMEM_FORMAT  0x09
+#define DX7_VMEM_VOICES        32
+#define DX7_VMEM_VOICE_SIZE    128
+#define DX7_VMEM_DATA_SIZE     (DX7_VMEM_VOICES * DX7_VMEM_VOICE_SIZE)   // 4096
+#define DX7_VMEM_DUMP_SIZE     (DX7_VMEM_DATA_SIZE + 8)                  // 4104
+
+// What a finished SysEx message turned out to be
+typedef enum {
+    DX7_SYSEX_IGNORED = 0,      // Not a DX7 voice dump
+    DX7_SYSEX_VOICE,            // Single voice, checksum good
+    DX7_SYSEX_BANK,             // 32-voice bank, checksum good
+    DX7_SYSEX_BAD_CHECKSUM,
+    DX7_SYSEX_BAD_LENGTH        // Ended early, or ran past its byte count
+} dx7_sysex_result_t;
+
+// Streaming SysEx receiver - bytes go straight into a fixed buffer as they
+// arrive and the checksum is summed along the way, so a complete dump is
+// validated the moment F7 arrives. Anything that isn't a Yamaha voice dump
+// is skipped without being stored
+typedef struct {
+    uint8_t state;
+    uint8_t header[5];          // 43, sub-status, format, byte count MSB, LSB
+    int header_length;
+    int expected;               // Payload bytes announced by the header
+    int received;               // Payload bytes so far, checksum included
+    uint8_t sum;                // 7-bit running sum of payload + checksum
+    uint8_t data[DX7_VMEM_DATA_SIZE + 1];
+} dx7_sysex_receiver_t;
+
 // Function declarations from dx7_sysex.c
 bool dx7_patch_to_sysex(const dx7_patch_t* patch, dx7_sysex_voice_t* sysex, int channel);
 bool dx7_sysex_to_patch(const dx7_sysex_voice_t* sysex, dx7_patch_t* patch);
+void dx7_vced_to_patch(const uint8_t* vced, dx7_patch_t* patch);
+void dx7_vmem_to_patch(const uint8_t* vmem, dx7_patch_t* patch);
+void dx7_patch_to_vmem(const dx7_patch_t* patch, uint8_t* vmem);
+void dx7_bank_to_sysex(const dx7_patch_t* patches, int channel, uint8_t* dump);
+int dx7_sysex_decode(const uint8_t* data, size_t length, dx7_patch_t* patches, uint8_t* records,
+                     int max_patches);
 uint8_t calculate_dx7_checksum(const uint8_t* data, size_t length);
+void dx7_sysex_receiver_start(dx7_sysex_receiver_t* receiver);   // After F0
+void dx7_sysex_receiver_byte(dx7_sysex_receiver_t* receiver, uint8_t byte);
+dx7_sysex_result_t dx7_sysex_receiver_end(dx7_sysex_receiver_t* receiver);   // At F7
+const uint8_t* dx7_sysex_receiver_voice(const dx7_sysex_receiver_t* receiver, int voice);
 bool dx7_send_patch_to_device(void* device_handle, const dx7_patch_t* patch, int channel);
 
+// Bulk conversion targets (patch_convert.c)
+typedef enum {
+    DX7_CONVERT_SYX = 0,    // 32-voice bank dumps
+    DX7_CONVERT_PATCH,      // Text .patch files, one per voice
+    DX7_CONVERT_VCED        // Single-voice dumps, one per voice
+} dx7_convert_format_t;
+
+// Function declarations from patch_convert.c
+int dx7_convert_format_from_name(const char* name);
+int dx7_convert(const char* const* inputs, int input_count, const char* output_dir,
+                dx7_convert_format_t format, int threads);
+char** dx7_list_patch_files(const char* const* inputs, int input_count, int* count);
+void dx7_free_patch_files(char** paths, int count);
+int dx7_decode_patch_file(const char* path, dx7_patch_t** voices, uint8_t** records);
+void dx7_path_stem(const char* path, char* stem, size_t size);
+
+// Patch library (.dx7lib) - built once, then memory-mapped read-only
+// Layout: header, voice_count packed 128-byte VMEM records, one canonical
+// hash per record, then an open-addressed name index of index_slots
+// entries. Nothing is parsed when a library is opened
+#define DX7_LIBRARY_MAGIC   "DX7LIB\0\0"
+#define DX7_LIBRARY_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t voice_count;
+    uint32_t index_slots;       // Power of two, at least twice voice_count
+    uint32_t reserved;
+    uint64_t records_offset;    // Byte offsets from the start of the file
+    uint64_t hashes_offset;
+    uint64_t index_offset;
+    uint8_t padding[16];        // Header fills one 64-byte line
+} dx7_library_header_t;
+
+typedef struct {
+    uint32_t name_hash;
+    uint32_t voice;             // Voice index + 1, 0 for an empty slot
+} dx7_library_slot_t;
+
+typedef struct {
+    void* map;
+    size_t size;
+    const dx7_library_header_t* header;
+    const uint8_t* records;
+    const uint64_t* hashes;
+    const dx7_library_slot_t* index;
+} dx7_library_t;
+
+// Function declarations from patch_library.c
+uint64_t dx7_vmem_hash(const uint8_t* vmem);
+int dx7_library_build(const char* const* inputs, int input_count, const char* path, int threads);
+bool dx7_library_open(dx7_library_t* library, const char* path);
+void dx7_library_close(dx7_library_t* library);
+int dx7_library_count(const dx7_library_t* library);
+int dx7_library_find(const dx7_library_t* library, const char* name);
+int dx7_library_select(const dx7_library_t* library, const char* selector);
+bool dx7_library_get(const dx7_library_t* library, int index, dx7_patch_t* patch);
+
+// Problems found in a text patch (patch_parser.c)
+typedef struct {
+    int unknown_keys;
+    int out_of_range;   // Clamped into range
+    int malformed;      // Not KEY = VALUE or OPn, or not a number
+    bool unreadable;    // The file couldn't be read at all
+} dx7_patch_issues_t;
+
+// Function declarations from patch_parser.c
+int dx7_parse_patch(const char* text, size_t length, const char* source,
+                    dx7_patch_t* patch, dx7_patch_issues_t* issues);
+int read_patch_file(const char* filename, dx7_patch_t* patch, dx7_patch_issues_t* issues);
+int dx7_load_patch_files(const char* const* paths, int count, dx7_patch_t* patches,
+                         dx7_patch_issues_t* issues, int threads);
+int dx7_check_patches(const char* const* inputs, int input_count, int threads);
+
+// Offline WAV output, written by a thread while the next chunk renders
+#define DX7_WAV_CHUNK_FRAMES 16384
+
+typedef struct {
+    SNDFILE* file;
+    float* chunks[2];
+    int frames[2];              // Frames waiting to be written, 0 when free
+    int filling;                // Chunk the renderer has (renderer only)
+    bool closing;
+    bool failed;
+    int64_t frames_written;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} dx7_wav_stream_t;
+
+// Function declarations from wav_stream.c
+bool dx7_wav_stream_open(dx7_wav_stream_t* stream, const char* path, int sample_rate);
+float* dx7_wav_stream_chunk(dx7_wav_stream_t* stream);
+void dx7_wav_stream_submit(dx7_wav_stream_t* stream, int frames);
+bool dx7_wav_stream_close(dx7_wav_stream_t* stream);
+
+// Multisample batch render (multisample.c)
+#define DX7_MULTISAMPLE_MAX_LAYERS 16
+
+typedef struct {
+    int note_low;               // MIDI notes, inclusive
+    int note_high;
+    int note_step;
+    int velocities[DX7_MULTISAMPLE_MAX_LAYERS];  // Rising, one per layer
+    int velocity_count;
+    double duration;            // Seconds per sample
+    int sample_rate;            // Hz
+    int control_rate;           // Samples between envelope and LFO updates
+    dx7_sine_kernel_t sine_kernel;
+    int loop_cycles;            // LFO cycles to loop (SFZ loop points), 0 = no loop
+} dx7_multisample_spec_t;
+
+// Function declarations from multisample.c
+bool dx7_parse_note_range(const char* text, dx7_multisample_spec_t* spec);
+bool dx7_parse_velocity_layers(const char* text, dx7_multisample_spec_t* spec);
+int dx7_render_multisamples(const char* const* inputs, int input_count, const char* output_dir,
+                            const dx7_multisample_spec_t* spec, int threads);
+
+// Loop points in samples from note-on (loop_points.c)
+typedef struct {
+    int64_t start;              // First sample of the loop
+    int64_t end;                // One past the last; the sample here matches start
+    double lfo_period;          // LFO cycle in samples, 0 without an audible LFO
+    int cycles;                 // LFO cycles covered
+} dx7_loop_t;
+
+// Function declarations from loop_points.c
+double dx7_loop_lfo_period(const dx7_patch_t* patch, double mod_wheel, int sample_rate);
+bool dx7_find_loop(const voice_state_t* voice, const dx7_patch_t* patch, int cycles, dx7_loop_t* loop);
+
+// Function declarations from midi_file.c
+struct dx7_engine_config;  // midi_input.h
+int dx7_render_midi_file(const char* midi_path, const dx7_patch_t* patch,
+                         const struct dx7_engine_config* config, const char* output_path);
+
 // Function declarations from main.c
 int load_patch(const char* filename, dx7_patch_t* patch);
+int write_patch_file(const char* filename, const dx7_patch_t* patch);
 void print_usage(const char* program_name);
-double calculate_lfo_frequency(const dx7_patch_t* patch);
-int calculate_perfect_loop_samples(const dx7_patch_t* patch, int num_cycles);
-int find_zero_crossing_loop_end(voice_state_t* voice, const dx7_patch_t* patch, 
-                                int target_samples, float* buffer, int max_samples);
 void list_midi_devices(void);
 bool send_patch_to_midi_device(int device_index, const dx7_patch_t* patch, int channel);
 
-// Function declarations from midi_input.c
-bool midi_input_initialize(const dx7_patch_t* patch, int input_device, int channel);
-void midi_input_shutdown(void);
-bool midi_input_start_play_mode(void);
-void midi_input_stop_play_mode(void);
-void generate_audio_block(float* output_buffer, int frame_count, double sample_rate);
-void print_midi_stats(void);
-void print_active_voices(void);
-
 // MIDI platform functions (from MacMidiDevice.m)
 bool midi_platform_initialize(void);
 void midi_platform_shutdown(void);
@@ -14,33 +14,30 @@ uint8_t calculate_dx7_checksum(const uint8_t* data, size_t length) {
 // Convert frequency ratio to DX7 coarse/fine format
 static void freq_ratio_to_dx7_format(double ratio, uint8_t* coarse, uint8_t* fine) {
     if (ratio < 1.0) {
-        // Fixed ratios below 1.0
-        if (ratio >= 0.50) {
-            *coarse = 0;  // 0.50
-            *fine = 0;
-        } else {
-            *coarse = 0;
-            *fine = 0;
-        }
+        // Coarse 0 is 0.50, with fine adding half-hundredths up to 0.995
+        int fine_int = (int)((ratio - 0.50) * 200.0 + 0.5);
+        *coarse = 0;
+        *fine = (uint8_t)(fine_int < 0 ? 0 : (fine_int > 99 ? 99 : fine_int));
     } else {
         // Integer part (coarse)
         int coarse_int = (int)ratio;
         if (coarse_int > 31) coarse_int = 31;
         *coarse = coarse_int;
         
-        // Fractional part (fine) - scale to 0-99
+        // Fractional part (fine) in hundredths, 0-99 - rounded so a ratio
+        // survives a round trip through dx7_format_to_freq_ratio
         double fractional = ratio - coarse_int;
-        *fine = (uint8_t)(fractional * 99.0);
-        if (*fine > 99) *fine = 99;
+        int fine_int = (int)(fractional * 100.0 + 0.5);
+        *fine = (uint8_t)(fine_int > 99 ? 99 : fine_int);
     }
 }
 
 // Convert DX7 coarse/fine format to frequency ratio
 static double dx7_format_to_freq_ratio(uint8_t coarse, uint8_t fine) {
     if (coarse == 0) {
-        return 0.50; // Special case for sub-harmonic
+        return 0.50 + (double)fine / 200.0; // Sub-harmonic, below coarse 1
     }
-    return (double)coarse + ((double)fine / 99.0);
+    return (double)coarse + ((double)fine / 100.0);
 }
 
 // Convert patch to DX7 SysEx format
@@ -91,7 +88,7 @@ bool dx7_patch_to_sysex(const dx7_patch_t* patch, dx7_sysex_voice_t* sysex, int
                                       ((operator->key_rate_scaling & 0x07) << 2);
         
         // Packed: Amp mod sensitivity + Key velocity sensitivity (13)
-        sysex->voice_data[base + 13] = 0 | ((operator->key_vel_sens & 0x07) << 2);
+        sysex->voice_data[base + 13] = (operator->amp_mod_sens & 0x03) | ((operator->key_vel_sens & 0x07) << 2);
         
         // Output level (14)
         sysex->voice_data[base + 14] = operator->output_level;
@@ -101,7 +98,7 @@ bool dx7_patch_to_sysex(const dx7_patch_t* patch, dx7_sysex_voice_t* sysex, int
         freq_ratio_to_dx7_format(operator->freq_ratio, &freq_coarse, &freq_fine);
         
         // Packed: Oscillator mode + Frequency coarse (15)
-        sysex->voice_data[base + 15] = (operator->osc_sync & 0x01) | ((freq_coarse & 0x1F) << 1);
+        sysex->voice_data[base + 15] = (operator->osc_mode & 0x01) | ((freq_coarse & 0x1F) << 1);
         
         // Frequency fine (16)
         sysex->voice_data[base + 16] = freq_fine;
@@ -194,8 +191,15 @@ bool dx7_sysex_to_patch(const dx7_sysex_voice_t* sysex, dx7_patch_t* patch) {
         return false;
     }
     
-    // Clear patch
+    dx7_vced_to_patch(sysex->voice_data, patch);
+    return true;
+}
+
+// Unpack 155 bytes of single-voice (VCED) data
+void dx7_vced_to_patch(const uint8_t* vced, dx7_patch_t* patch) {
+    // Clear patch - the bend range is a function parameter, not part of the voice
     memset(patch, 0, sizeof(dx7_patch_t));
+    patch->pitch_bend_range = 2;
     
     // Unpack operator data (reverse order: DX7 stores as 6,5,4,3,2,1)
     for (int op = 0; op < 6; op++) {
@@ -204,68 +208,70 @@ bool dx7_sysex_to_patch(const dx7_sysex_voice_t* sysex, dx7_patch_t* patch) {
         dx7_operator_t* operator = &patch->operators[dx7_op];
         
         // Envelope rates and levels
-        operator->env_rates[ENV_ATTACK] = sysex->voice_data[base + 0];
-        operator->env_rates[ENV_DECAY1] = sysex->voice_data[base + 1];
-        operator->env_rates[ENV_DECAY2] = sysex->voice_data[base + 2];
-        operator->env_rates[ENV_RELEASE] = sysex->voice_data[base + 3];
+        operator->env_rates[ENV_ATTACK] = vced[base + 0];
+        operator->env_rates[ENV_DECAY1] = vced[base + 1];
+        operator->env_rates[ENV_DECAY2] = vced[base + 2];
+        operator->env_rates[ENV_RELEASE] = vced[base + 3];
         
-        operator->env_levels[ENV_ATTACK] = sysex->voice_data[base + 4];
-        operator->env_levels[ENV_DECAY1] = sysex->voice_data[base + 5];
-        operator->env_levels[ENV_DECAY2] = sysex->voice_data[base + 6];
-        operator->env_levels[ENV_RELEASE] = sysex->voice_data[base + 7];
+        operator->env_levels[ENV_ATTACK] = vced[base + 4];
+        operator->env_levels[ENV_DECAY1] = vced[base + 5];
+        operator->env_levels[ENV_DECAY2] = vced[base + 6];
+        operator->env_levels[ENV_RELEASE] = vced[base + 7];
         
         // Keyboard scaling
-        operator->key_level_scale_break_point = sysex->voice_data[base + 8];
-        operator->key_level_scale_left_depth = sysex->voice_data[base + 9];
-        operator->key_level_scale_right_depth = sysex->voice_data[base + 10];
-        operator->key_level_scale_left_curve = sysex->voice_data[base + 11] & 0x03;
-        operator->key_level_scale_right_curve = sysex->voice_data[base + 12] & 0x03;
-        operator->key_rate_scaling = (sysex->voice_data[base + 12] >> 2) & 0x07;
+        operator->key_level_scale_break_point = vced[base + 8];
+        operator->key_level_scale_left_depth = vced[base + 9];
+        operator->key_level_scale_right_depth = vced[base + 10];
+        operator->key_level_scale_left_curve = vced[base + 11] & 0x03;
+        operator->key_level_scale_right_curve = vced[base + 12] & 0x03;
+        operator->key_rate_scaling = (vced[base + 12] >> 2) & 0x07;
         
-        // Velocity sensitivity
-        operator->key_vel_sens = (sysex->voice_data[base + 13] >> 2) & 0x07;
+        // Amp mod and velocity sensitivity
+        operator->amp_mod_sens = vced[base + 13] & 0x03;
+        operator->key_vel_sens = (vced[base + 13] >> 2) & 0x07;
         
         // Output level
-        operator->output_level = sysex->voice_data[base + 14];
+        operator->output_level = vced[base + 14];
         
         // Frequency parameters
-        uint8_t freq_coarse = (sysex->voice_data[base + 15] >> 1) & 0x1F;
-        uint8_t freq_fine = sysex->voice_data[base + 16];
+        uint8_t freq_coarse = (vced[base + 15] >> 1) & 0x1F;
+        uint8_t freq_fine = vced[base + 16];
         operator->freq_ratio = dx7_format_to_freq_ratio(freq_coarse, freq_fine);
         
-        // Detune and sync
-        operator->osc_sync = sysex->voice_data[base + 15] & 0x01;
-        uint8_t detune_dx7 = (sysex->voice_data[base + 17] >> 1) & 0x0F;
+        // Oscillator mode, detune and sync
+        operator->osc_mode = vced[base + 15] & 0x01;
+        operator->osc_sync = vced[base + 17] & 0x01;
+        uint8_t detune_dx7 = (vced[base + 17] >> 1) & 0x0F;
         operator->detune = (int)detune_dx7 - 7; // Convert from 0-14 to -7 to +7
     }
     
     // Global parameters
     for (int i = 0; i < 4; i++) {
-        patch->pitch_env_rates[i] = sysex->voice_data[126 + i];
-        patch->pitch_env_levels[i] = sysex->voice_data[130 + i];
+        patch->pitch_env_rates[i] = vced[126 + i];
+        patch->pitch_env_levels[i] = vced[130 + i];
     }
     
     // Algorithm (convert from 0-31 to 1-32)
-    patch->algorithm = (sysex->voice_data[134] & 0x1F) + 1;
+    patch->algorithm = (vced[134] & 0x1F) + 1;
     
     // Feedback
-    patch->feedback = sysex->voice_data[135] & 0x07;
+    patch->feedback = vced[135] & 0x07;
     
     // LFO parameters
-    patch->lfo_speed = sysex->voice_data[136];
-    patch->lfo_delay = sysex->voice_data[137];
-    patch->lfo_pmd = sysex->voice_data[138];
-    patch->lfo_amd = sysex->voice_data[139];
-    patch->lfo_sync = sysex->voice_data[140] & 0x01;
-    patch->lfo_wave = (sysex->voice_data[140] >> 1) & 0x07;
-    patch->lfo_pitch_mod_sens = (sysex->voice_data[140] >> 4) & 0x07;
+    patch->lfo_speed = vced[136];
+    patch->lfo_delay = vced[137];
+    patch->lfo_pmd = vced[138];
+    patch->lfo_amd = vced[139];
+    patch->lfo_sync = vced[140] & 0x01;
+    patch->lfo_wave = (vced[140] >> 1) & 0x07;
+    patch->lfo_pitch_mod_sens = (vced[140] >> 4) & 0x07;
     
     // Transpose (convert from 0-48 to -24/+24)
-    patch->transpose = (int)(sysex->voice_data[141] & 0x3F) - 24;
+    patch->transpose = (int)(vced[141] & 0x3F) - 24;
     
     // Voice name
     for (int i = 0; i < 10 && i < MAX_PATCH_NAME - 1; i++) {
-        patch->name[i] = (char)sysex->voice_data[142 + i];
+        patch->name[i] = (char)vced[142 + i];
     }
     patch->name[MAX_PATCH_NAME - 1] = '\0';
     
@@ -274,8 +280,282 @@ bool dx7_sysex_to_patch(const dx7_sysex_voice_t* sysex, dx7_patch_t* patch) {
     while (len > 0 && patch->name[len - 1] == ' ') {
         patch->name[--len] = '\0';
     }
+}
+
+// Packed parameter byte, limited to the parameter's range
+static int vmem_param(uint8_t byte, int max) {
+    int value = byte & 0x7F;
+    return value > max ? max : value;
+}
+
+// Unpack one 128-byte voice from a 32-voice bulk dump (VMEM)
+// Operators are stored 6 first, 17 bytes each, with the small parameters
+// packed two or three to a byte
+void dx7_vmem_to_patch(const uint8_t* vmem, dx7_patch_t* patch) {
+    memset(patch, 0, sizeof(dx7_patch_t));
+    patch->pitch_bend_range = 2;
     
-    return true;
+    int key_sync = (vmem[111] >> 3) & 0x01;
+    
+    for (int op = 0; op < 6; op++) {
+        const uint8_t* packed = vmem + op * 17;
+        dx7_operator_t* operator = &patch->operators[5 - op];
+        
+        for (int i = 0; i < ENVELOPE_STAGES; i++) {
+            operator->env_rates[i] = vmem_param(packed[i], 99);
+            operator->env_levels[i] = vmem_param(packed[4 + i], 99);
+        }
+        
+        operator->key_level_scale_break_point = vmem_param(packed[8], 99);
+        operator->key_level_scale_left_depth = vmem_param(packed[9], 99);
+        operator->key_level_scale_right_depth = vmem_param(packed[10], 99);
+        operator->key_level_scale_left_curve = packed[11] & 0x03;
+        operator->key_level_scale_right_curve = (packed[11] >> 2) & 0x03;
+        operator->key_rate_scaling = packed[12] & 0x07;
+        operator->detune = vmem_param(packed[12] >> 3, 14) - 7;
+        operator->amp_mod_sens = packed[13] & 0x03;
+        operator->key_vel_sens = (packed[13] >> 2) & 0x07;
+        operator->output_level = vmem_param(packed[14], 99);
+        
+        operator->osc_mode = packed[15] & 0x01;
+        operator->freq_ratio = dx7_format_to_freq_ratio((packed[15] >> 1) & 0x1F,
+                                                        (uint8_t)vmem_param(packed[16], 99));
+        operator->osc_sync = key_sync;
+    }
+    
+    for (int i = 0; i < ENVELOPE_STAGES; i++) {
+        patch->pitch_env_rates[i] = vmem_param(vmem[102 + i], 99);
+        patch->pitch_env_levels[i] = vmem_param(vmem[106 + i], 99);
+    }
+    
+    patch->algorithm = (vmem[110] & 0x1F) + 1;
+    patch->feedback = vmem[111] & 0x07;
+    patch->lfo_speed = vmem_param(vmem[112], 99);
+    patch->lfo_delay = vmem_param(vmem[113], 99);
+    patch->lfo_pmd = vmem_param(vmem[114], 99);
+    patch->lfo_amd = vmem_param(vmem[115], 99);
+    patch->lfo_sync = vmem[116] & 0x01;
+    patch->lfo_wave = vmem_param((vmem[116] >> 1) & 0x07, DX7_LFO_SAMPLE_HOLD);
+    patch->lfo_pitch_mod_sens = (vmem[116] >> 4) & 0x07;
+    patch->transpose = vmem_param(vmem[117], 48) - 24;
+    
+    // Name, with unprintable bytes shown as spaces and trailing spaces trimmed
+    int len = 0;
+    for (int i = 0; i < 10 && i < MAX_PATCH_NAME - 1; i++) {
+        uint8_t c = vmem[118 + i];
+        patch->name[i] = (c >= 0x20 && c < 0x7F) ? (char)c : ' ';
+        if (patch->name[i] != ' ') {
+            len = i + 1;
+        }
+    }
+    patch->name[len] = '\0';
+}
+
+// Parameter limited to its range for packing
+static uint8_t pack_param(int value, int max) {
+    return (uint8_t)(value < 0 ? 0 : (value > max ? max : value));
+}
+
+// Pack a voice into the 128-byte bulk dump format (VMEM)
+// Oscillator key sync is taken from operator 1
+void dx7_patch_to_vmem(const dx7_patch_t* patch, uint8_t* vmem) {
+    memset(vmem, 0, DX7_VMEM_VOICE_SIZE);
+    
+    for (int op = 0; op < 6; op++) {
+        uint8_t* packed = vmem + op * 17;
+        const dx7_operator_t* operator = &patch->operators[5 - op];
+        
+        for (int i = 0; i < ENVELOPE_STAGES; i++) {
+            packed[i] = pack_param(operator->env_rates[i], 99);
+            packed[4 + i] = pack_param(operator->env_levels[i], 99);
+        }
+        
+        packed[8] = pack_param(operator->key_level_scale_break_point, 99);
+        packed[9] = pack_param(operator->key_level_scale_left_depth, 99);
+        packed[10] = pack_param(operator->key_level_scale_right_depth, 99);
+        packed[11] = pack_param(operator->key_level_scale_left_curve, 3) |
+                     (pack_param(operator->key_level_scale_right_curve, 3) << 2);
+        packed[12] = pack_param(operator->key_rate_scaling, 7) |
+                     (pack_param(operator->detune + 7, 14) << 3);
+        packed[13] = pack_param(operator->amp_mod_sens, 3) | (pack_param(operator->key_vel_sens, 7) << 2);
+        packed[14] = pack_param(operator->output_level, 99);
+        
+        uint8_t freq_coarse, freq_fine;
+        freq_ratio_to_dx7_format(operator->freq_ratio, &freq_coarse, &freq_fine);
+        packed[15] = (operator->osc_mode & 0x01) | ((freq_coarse & 0x1F) << 1);
+        packed[16] = freq_fine;
+    }
+    
+    for (int i = 0; i < ENVELOPE_STAGES; i++) {
+        vmem[102 + i] = pack_param(patch->pitch_env_rates[i], 99);
+        vmem[106 + i] = pack_param(patch->pitch_env_levels[i], 99);
+    }
+    
+    vmem[110] = (patch->algorithm - 1) & 0x1F;
+    vmem[111] = pack_param(patch->feedback, 7) | ((patch->operators[0].osc_sync & 0x01) << 3);
+    vmem[112] = pack_param(patch->lfo_speed, 99);
+    vmem[113] = pack_param(patch->lfo_delay, 99);
+    vmem[114] = pack_param(patch->lfo_pmd, 99);
+    vmem[115] = pack_param(patch->lfo_amd, 99);
+    vmem[116] = (patch->lfo_sync & 0x01) | (pack_param(patch->lfo_wave, DX7_LFO_SAMPLE_HOLD) << 1) |
+                (pack_param(patch->lfo_pitch_mod_sens, 7) << 4);
+    vmem[117] = pack_param(patch->transpose + 24, 48);
+    
+    // Name - 10 characters, padded with spaces
+    size_t name_length = strlen(patch->name);
+    for (int i = 0; i < 10; i++) {
+        char c = i < (int)name_length ? patch->name[i] : ' ';
+        vmem[118 + i] = (c >= 0x20 && c < 0x7F) ? (uint8_t)c : ' ';
+    }
+}
+
+// Build a complete 32-voice bulk dump (DX7_VMEM_DUMP_SIZE bytes)
+void dx7_bank_to_sysex(const dx7_patch_t* patches, int channel, uint8_t* dump) {
+    dump[0] = 0xF0;
+    dump[1] = 0x43;                     // Yamaha
+    dump[2] = 0x00 | (channel & 0x0F);  // Device 0 + MIDI channel
+    dump[3] = DX7_SYSEX_VMEM_FORMAT;
+    dump[4] = 0x20;                     // 4096 = 0x20 << 7
+    dump[5] = 0x00;
+    
+    uint8_t* data = dump + 6;
+    for (int i = 0; i < DX7_VMEM_VOICES; i++) {
+        dx7_patch_to_vmem(&patches[i], data + i * DX7_VMEM_VOICE_SIZE);
+    }
+    dump[6 + DX7_VMEM_DATA_SIZE] = calculate_dx7_checksum(data, DX7_VMEM_DATA_SIZE);
+    dump[7 + DX7_VMEM_DATA_SIZE] = 0xF7;
+}
+
+// Unpack every voice dump in a buffer of SysEx messages (a .syx file) into
+// patches, at most max_patches. records, if not NULL, gets every voice
+// packed as VMEM - bank voices byte for byte as they were received.
+// Returns the number of voices, or -1 if a voice dump is corrupt or there
+// is no room for it
+int dx7_sysex_decode(const uint8_t* data, size_t length, dx7_patch_t* patches, uint8_t* records,
+                     int max_patches) {
+    dx7_sysex_receiver_t receiver;
+    bool in_sysex = false;
+    int count = 0;
+    
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+        if (byte == 0xF0) {
+            dx7_sysex_receiver_start(&receiver);
+            in_sysex = true;
+        } else if (byte == 0xF7 && in_sysex) {
+            in_sysex = false;
+            dx7_sysex_result_t result = dx7_sysex_receiver_end(&receiver);
+            if (result == DX7_SYSEX_BAD_CHECKSUM || result == DX7_SYSEX_BAD_LENGTH) {
+                return -1;
+            }
+            
+            int voices = result == DX7_SYSEX_BANK ? DX7_VMEM_VOICES : (result == DX7_SYSEX_VOICE ? 1 : 0);
+            if (count + voices > max_patches) {
+                return -1;
+            }
+            for (int v = 0; v < voices; v++) {
+                const uint8_t* voice = dx7_sysex_receiver_voice(&receiver, v);
+                uint8_t* record = records ? records + (size_t)count * DX7_VMEM_VOICE_SIZE : NULL;
+                if (result == DX7_SYSEX_BANK) {
+                    dx7_vmem_to_patch(voice, &patches[count]);
+                    if (record) memcpy(record, voice, DX7_VMEM_VOICE_SIZE);
+                } else {
+                    dx7_vced_to_patch(voice, &patches[count]);
+                    if (record) dx7_patch_to_vmem(&patches[count], record);
+                }
+                count++;
+            }
+        } else if (in_sysex && byte < 0x80) {
+            dx7_sysex_receiver_byte(&receiver, byte);
+        }
+    }
+    return count;
+}
+
+// Streaming receiver
+// Header bytes are checked as they arrive; once the byte count is known the
+// payload is stored and summed byte by byte, and F7 only has to look at
+// the running sum. Nothing is unpacked here
+
+enum {
+    RECEIVER_IDLE = 0,
+    RECEIVER_HEADER,
+    RECEIVER_DATA,
+    RECEIVER_SKIP,      // Not a voice dump - swallowed up to F7
+    RECEIVER_OVERRUN    // More payload than announced
+};
+
+void dx7_sysex_receiver_start(dx7_sysex_receiver_t* receiver) {
+    receiver->state = RECEIVER_HEADER;
+    receiver->header_length = 0;
+    receiver->expected = 0;
+    receiver->received = 0;
+    receiver->sum = 0;
+}
+
+void dx7_sysex_receiver_byte(dx7_sysex_receiver_t* receiver, uint8_t byte) {
+    switch (receiver->state) {
+        case RECEIVER_HEADER: {
+            receiver->header[receiver->header_length++] = byte;
+            if (receiver->header_length < (int)sizeof(receiver->header)) {
+                // Yamaha, bulk dump sub-status (any device number)
+                if ((receiver->header_length == 1 && byte != 0x43) ||
+                    (receiver->header_length == 2 && (byte & 0x70) != 0x00)) {
+                    receiver->state = RECEIVER_SKIP;
+                }
+                return;
+            }
+            
+            int format = receiver->header[2];
+            int count = (receiver->header[3] << 7) | receiver->header[4];
+            if ((format == 0x00 && count == DX7_SYSEX_VCED_SIZE) ||
+                (format == DX7_SYSEX_VMEM_FORMAT && count == DX7_VMEM_DATA_SIZE)) {
+                receiver->expected = count;
+                receiver->state = RECEIVER_DATA;
+            } else {
+                receiver->state = RECEIVER_SKIP;
+            }
+            return;
+        }
+        
+        case RECEIVER_DATA:
+            // Payload then the checksum byte, which brings the sum to zero
+            if (receiver->received > receiver->expected) {
+                receiver->state = RECEIVER_OVERRUN;
+                return;
+            }
+            receiver->data[receiver->received++] = byte;
+            receiver->sum = (uint8_t)((receiver->sum + byte) & 0x7F);
+            return;
+            
+        default:
+            return;
+    }
+}
+
+dx7_sysex_result_t dx7_sysex_receiver_end(dx7_sysex_receiver_t* receiver) {
+    int state = receiver->state;
+    receiver->state = RECEIVER_IDLE;
+    
+    if (state == RECEIVER_OVERRUN) {
+        return DX7_SYSEX_BAD_LENGTH;
+    }
+    if (state != RECEIVER_DATA) {
+        return DX7_SYSEX_IGNORED;
+    }
+    if (receiver->received != receiver->expected + 1) {
+        return DX7_SYSEX_BAD_LENGTH;
+    }
+    if (receiver->sum != 0) {
+        return DX7_SYSEX_BAD_CHECKSUM;
+    }
+    return receiver->expected == DX7_VMEM_DATA_SIZE ? DX7_SYSEX_BANK : DX7_SYSEX_VOICE;
+}
+
+// Packed data of one received voice: VCED for a single voice, VMEM for
+// voice 0-31 of a bank
+const uint8_t* dx7_sysex_receiver_voice(const dx7_sysex_receiver_t* receiver, int voice) {
+    return receiver->data + (size_t)voice * DX7_VMEM_VOICE_SIZE;
 }
 
 // Send patch to MIDI device
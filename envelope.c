@@ -1,8 +1,5 @@
 #include "dx7.h"
 
-// External global sample rate
-extern int g_sample_rate;
-
 // DX7 envelope rate table (approximate timings in seconds for full scale)
 static const double rate_table[100] = {
     // Rates 0-9: Very slow
@@ -40,21 +37,41 @@ double dx7_envelope_rate_to_time(int rate, int level_diff) {
     return base_time * scale;
 }
 
-void init_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale) {
-    env->stage = ENV_ATTACK;
-    env->level = 0.0;
-    env->samples_in_stage = 0;
+// Per-sample increment at sample_rate on entering an attack or decay stage
+// Attack rate 99 (zero time) is an instant jump; a zero-length or flat
+// decay stage holds its level
+double envelope_stage_rate(const dx7_operator_t* op, int stage, double rate_scale, int sample_rate) {
+    double key_scale = 1.0 + rate_scale * (op->key_rate_scaling / 7.0);
     
-    // Calculate attack rate (scaled by keyboard rate scaling)
-    double attack_time = dx7_envelope_rate_to_time(op->env_rates[ENV_ATTACK], op->env_levels[ENV_ATTACK]);
-    attack_time /= (1.0 + rate_scale * (op->key_rate_scaling / 7.0));
+    if (stage == ENV_ATTACK) {
+        double attack_time = dx7_envelope_rate_to_time(op->env_rates[ENV_ATTACK], op->env_levels[ENV_ATTACK]);
+        attack_time /= key_scale;
+        
+        if (attack_time > 0.0) {
+            return (double)op->env_levels[ENV_ATTACK] / (99.0 * attack_time * sample_rate);
+        }
+        return 99.0; // Instant attack
+    }
     
-    if (attack_time > 0.0) {
-        env->rate = (double)op->env_levels[ENV_ATTACK] / (99.0 * attack_time * g_sample_rate);
-    } else {
-        env->rate = 99.0; // Instant attack
+    int level_diff = op->env_levels[stage - 1] - op->env_levels[stage];
+    double decay_time = dx7_envelope_rate_to_time(op->env_rates[stage], level_diff);
+    decay_time /= key_scale;
+    
+    if (decay_time > 0.0 && level_diff != 0) {
+        return -(double)level_diff / (99.0 * decay_time * sample_rate);
     }
+    return 0.0;
+}
+
+void init_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale, int sample_rate) {
+    env->stage = ENV_ATTACK;
+    env->level = 0.0;
+    env->samples_in_stage = 0;
+    env->note_rates = NULL;
+    env->sample_rate = sample_rate;
     
+    // Attack rate (scaled by keyboard rate scaling)
+    env->rate = envelope_stage_rate(op, ENV_ATTACK, rate_scale, sample_rate);
     env->target = (double)op->env_levels[ENV_ATTACK] / 99.0;
 }
 
@@ -68,18 +85,8 @@ double update_envelope(envelope_state_t* env, const dx7_operator_t* op, double r
                 env->stage = ENV_DECAY1;
                 env->level = env->target;
                 env->samples_in_stage = 0;
-                
-                // Calculate Decay 1 rate
-                int level_diff = op->env_levels[ENV_ATTACK] - op->env_levels[ENV_DECAY1];
-                double decay1_time = dx7_envelope_rate_to_time(op->env_rates[ENV_DECAY1], level_diff);
-                decay1_time /= (1.0 + rate_scale * (op->key_rate_scaling / 7.0));
-                
-                if (decay1_time > 0.0 && level_diff != 0) {
-                    env->rate = -(double)level_diff / (99.0 * decay1_time * g_sample_rate);
-                } else {
-                    env->rate = 0.0;
-                }
-                
+                env->rate = env->note_rates ? env->note_rates[ENV_DECAY1]
+                                            : envelope_stage_rate(op, ENV_DECAY1, rate_scale, env->sample_rate);
                 env->target = (double)op->env_levels[ENV_DECAY1] / 99.0;
             } else {
                 env->level += env->rate;
@@ -93,18 +100,8 @@ double update_envelope(envelope_state_t* env, const dx7_operator_t* op, double r
                 env->stage = ENV_DECAY2;
                 env->level = env->target;
                 env->samples_in_stage = 0;
-                
-                // Calculate Decay 2 rate
-                int level_diff = op->env_levels[ENV_DECAY1] - op->env_levels[ENV_DECAY2];
-                double decay2_time = dx7_envelope_rate_to_time(op->env_rates[ENV_DECAY2], level_diff);
-                decay2_time /= (1.0 + rate_scale * (op->key_rate_scaling / 7.0));
-                
-                if (decay2_time > 0.0 && level_diff != 0) {
-                    env->rate = -(double)level_diff / (99.0 * decay2_time * g_sample_rate);
-                } else {
-                    env->rate = 0.0;
-                }
-                
+                env->rate = env->note_rates ? env->note_rates[ENV_DECAY2]
+                                            : envelope_stage_rate(op, ENV_DECAY2, rate_scale, env->sample_rate);
                 env->target = (double)op->env_levels[ENV_DECAY2] / 99.0;
             } else {
                 env->level += env->rate;
@@ -139,10 +136,42 @@ void trigger_release(envelope_state_t* env, const dx7_operator_t* op, double rat
     release_time /= (1.0 + rate_scale * (op->key_rate_scaling / 7.0));
     
     if (release_time > 0.0 && level_diff != 0) {
-        env->rate = -(double)level_diff / (99.0 * release_time * g_sample_rate);
+        env->rate = -(double)level_diff / (99.0 * release_time * env->sample_rate);
     } else {
         env->rate = -0.1; // Default fast release
     }
     
     env->target = (double)op->env_levels[ENV_RELEASE] / 99.0;
 }
+
+// True once an envelope is at or below DX7_SILENCE_LEVEL and can't rise
+// again before the next note-on: decay 2 only ever falls towards its
+// target, and release only falls unless it started below its end level
+bool envelope_is_silent(int stage, double level, double rate) {
+    if (level > DX7_SILENCE_LEVEL) {
+        return false;
+    }
+    return stage == ENV_DECAY2 || (stage == ENV_RELEASE && rate <= 0.0);
+}
+
+// Control-rate step: advance the envelope by several samples at once
+// Within a stage the level moves linearly, so this is update_envelope() with
+// the per-sample rate scaled up. A stage change lands on the control-rate
+// boundary and leaves the new stage's per-sample rate in place.
+double advance_envelope(envelope_state_t* env, const dx7_operator_t* op, double rate_scale, int samples) {
+    if (samples == 1) {
+        return update_envelope(env, op, rate_scale);
+    }
+    
+    int stage = env->stage;
+    double rate = env->rate;
+    
+    env->rate = rate * samples;
+    update_envelope(env, op, rate_scale);
+    if (env->stage == stage) {
+        env->rate = rate;
+        env->samples_in_stage += samples - 1;
+    }
+    
+    return env->level;
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Generate algorithm_kernels.h from the algorithms[] table in algorithms.c
+
+Each DX7 algorithm becomes a straight-line macro body: the modulated
+operators in topological order (every modulator before the operators it
+feeds), then the carrier sum. The bodies are expanded by algorithms.c for
+the scalar path and by voice_bank_kernel.h for the SIMD lanes.
+
+Usage: python3 gen_algorithm_kernels.py [algorithms.c] [algorithm_kernels.h]
+       (or: make kernels)
+"""
+
+import re
+import sys
+
+MAX_OPERATORS = 6
+
+ENTRY = re.compile(
+    r"//\s*(Algorithm (\d+):[^\n]*)\n\s*"
+    r"\{\{([\d,\s]*)\},\s*(\d+),\s*\{((?:\s*\{[\d,\s]*\},?)+)\s*\}\}")
+ROW = re.compile(r"\{([\d,\s]*)\}")
+
+
+def parse_table(source):
+    algorithms = {}
+    for match in ENTRY.finditer(source):
+        title, number = match.group(1), int(match.group(2))
+        carriers = [int(c) for c in match.group(3).split(",") if c.strip()]
+        num_carriers = int(match.group(4))
+        matrix = [[int(v) for v in row.split(",")] for row in ROW.findall(match.group(5))]
+
+        if len(matrix) != MAX_OPERATORS or any(len(r) != MAX_OPERATORS for r in matrix):
+            sys.exit("algorithm %d: modulation matrix is not %dx%d" % (number, MAX_OPERATORS, MAX_OPERATORS))
+        # The C initializer zero-fills, so only the first num_carriers entries count
+        carriers = carriers[:num_carriers]
+        if len(carriers) != num_carriers or not all(1 <= c <= MAX_OPERATORS for c in carriers):
+            sys.exit("algorithm %d: bad carrier list" % number)
+
+        algorithms[number] = (title, carriers, matrix)
+
+    missing = [n for n in range(1, 33) if n not in algorithms]
+    if missing:
+        sys.exit("algorithms not found in table: %s" % missing)
+    return algorithms
+
+
+# Modulated operators ordered so each one's modulators are already final
+# A diagonal entry (self-modulation) reads the operator's own unmodulated
+# output, so it is not a dependency
+def evaluation_order(number, matrix):
+    modulators = {c: [m for m in range(MAX_OPERATORS) if matrix[m][c] > 0] for c in range(MAX_OPERATORS)}
+    pending = [c for c in range(MAX_OPERATORS) if modulators[c]]
+    order = []
+    while pending:
+        ready = [c for c in pending if all(m == c or m not in pending for m in modulators[c])]
+        if not ready:
+            sys.exit("algorithm %d: modulation cycle between operators %s" % (number, [c + 1 for c in pending]))
+        # Highest operator first, matching the DX7 diagrams (6 feeds down to 1)
+        ready.sort(reverse=True)
+        order.append(ready[0])
+        pending.remove(ready[0])
+    return [(c, [(m, matrix[m][c]) for m in modulators[c]]) for c in order]
+
+
+def emit_body(number, title, carriers, matrix):
+    lines = ["// %s" % title]
+    order = evaluation_order(number, matrix)
+    if order:
+        lines.append("// Evaluation order: %s" % " ".join("%d" % (c + 1) for c, _ in order))
+    lines.append("#define DX7_ALGORITHM_%d \\" % number)
+    for carrier, mods in order:
+        terms = " + ".join("ALG_TERM(%d, %d)" % (m, strength) for m, strength in mods)
+        lines.append("    ALG_OP(%d, %s); \\" % (carrier, terms))
+    total = " + ".join("ALG_CARRIER(%d)" % (c - 1) for c in carriers)
+    lines.append("    return ALG_OUTPUT(%s, %d);" % (total, len(carriers)))
+    return "\n".join(lines)
+
+
+def main():
+    source_path = sys.argv[1] if len(sys.argv) > 1 else "algorithms.c"
+    output_path = sys.argv[2] if len(sys.argv) > 2 else "algorithm_kernels.h"
+
+    with open(source_path) as f:
+        algorithms = parse_table(f.read())
+
+    out = [
+        "// Generated by gen_algorithm_kernels.py from the algorithms[] table in",
+        "// algorithms.c - do not edit, run 'make kernels' after changing the table",
+        "//",
+        "// DX7_ALGORITHM_n is the straight-line body of algorithm n. The includer",
+        "// defines the operations for its sample type:",
+        "//   ALG_OP(op, modulation)       replace op's output with the modulated sine",
+        "//   ALG_TERM(op, strength)       op's contribution as a modulator",
+        "//   ALG_CARRIER(op)              op's output as a carrier",
+        "//   ALG_OUTPUT(sum, carriers)    normalise the carrier sum",
+        "// Operators are 0-indexed; modulated operators come in topological order.",
+        "",
+        "#ifndef ALGORITHM_KERNELS_H",
+        "#define ALGORITHM_KERNELS_H",
+        "",
+    ]
+    for number in range(1, 33):
+        out.append(emit_body(number, *algorithms[number]))
+        out.append("")
+
+    out.append("// Expand X(n) for every algorithm, 1-32")
+    out.append("#define DX7_ALGORITHM_LIST(X) \\")
+    for start in range(1, 33, 8):
+        row = " ".join("X(%d)" % n for n in range(start, start + 8))
+        out.append("    %s%s" % (row, " \\" if start + 8 <= 32 else ""))
+    out.append("")
+    out.append("#endif // ALGORITHM_KERNELS_H")
+
+    with open(output_path, "w") as f:
+        f.write("\n".join(out) + "\n")
+    print("Wrote %s (32 algorithms)" % output_path)
+
+
+if __name__ == "__main__":
+    main()
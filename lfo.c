@@ -0,0 +1,117 @@
+#include "dx7.h"
+
+// One cycle per table, indexed by the top 8 bits of the phase with the next
+// 24 bits as the interpolation fraction. The guard point repeats entry 0 so
+// the last segment interpolates back to the start of the cycle
+#define LFO_TABLE_BITS 8
+#define LFO_TABLE_SIZE (1 << LFO_TABLE_BITS)
+#define LFO_FRAC_BITS (32 - LFO_TABLE_BITS)
+#define LFO_FRAC_SCALE (1.0 / (double)(1 << LFO_FRAC_BITS))
+
+// Longest delay (lfo_delay 99) in seconds
+#define LFO_MAX_DELAY 5.0
+
+static double lfo_tables[DX7_LFO_SAMPLE_HOLD][LFO_TABLE_SIZE + 1];
+
+static const char* lfo_wave_names[DX7_LFO_WAVE_COUNT] = {
+    "triangle", "saw down", "saw up", "square", "sine", "sample & hold"
+};
+
+// Fill the waveform tables - bipolar, every wave starts at phase 0
+void dx7_lfo_init(void) {
+    for (int i = 0; i <= LFO_TABLE_SIZE; i++) {
+        double x = (double)(i & (LFO_TABLE_SIZE - 1)) / LFO_TABLE_SIZE;
+
+        // Triangle starts at zero rising, like the sine
+        double triangle;
+        if (x < 0.25) triangle = 4.0 * x;
+        else if (x < 0.75) triangle = 2.0 - 4.0 * x;
+        else triangle = 4.0 * x - 4.0;
+
+        lfo_tables[DX7_LFO_TRIANGLE][i] = triangle;
+        lfo_tables[DX7_LFO_SAW_DOWN][i] = 1.0 - 2.0 * x;
+        lfo_tables[DX7_LFO_SAW_UP][i] = 2.0 * x - 1.0;
+        lfo_tables[DX7_LFO_SQUARE][i] = x < 0.5 ? 1.0 : -1.0;
+        lfo_tables[DX7_LFO_SINE][i] = sin(2.0 * M_PI * x);
+    }
+}
+
+const char* dx7_lfo_wave_name(int wave) {
+    return (wave >= 0 && wave < DX7_LFO_WAVE_COUNT) ? lfo_wave_names[wave] : "unknown";
+}
+
+// Start a cycle from phase 0 - the seed keeps sample & hold deterministic
+void dx7_lfo_reset(dx7_lfo_t* lfo, uint32_t seed) {
+    lfo->phase = 0;
+    lfo->random = seed * 2654435761u + 1;
+    lfo->hold = 0.0;
+}
+
+// LFO rate in Hz - the mod wheel scales it from 0.1x to 3.0x
+double dx7_lfo_speed(const dx7_patch_t* patch, double mod_wheel) {
+    double speed = (double)patch->lfo_speed / 99.0 * 6.0; // Base speed (0-6 Hz)
+    return speed * (0.1 + mod_wheel * 2.9);
+}
+
+// Phase increment per sample for the 32-bit accumulator
+uint32_t dx7_lfo_increment(const dx7_patch_t* patch, double mod_wheel, int sample_rate) {
+    return (uint32_t)(dx7_lfo_speed(patch, mod_wheel) / sample_rate * DX7_PHASE_SCALE);
+}
+
+// Value at the current phase without advancing
+double dx7_lfo_value(const dx7_lfo_t* lfo, int wave) {
+    if (wave < 0 || wave >= DX7_LFO_SAMPLE_HOLD) {
+        return lfo->hold; // Sample & hold (and out-of-range waves)
+    }
+
+    const double* table = lfo_tables[wave];
+    uint32_t index = lfo->phase >> LFO_FRAC_BITS;
+    double frac = (double)(lfo->phase & ((1u << LFO_FRAC_BITS) - 1)) * LFO_FRAC_SCALE;
+    return table[index] + (table[index + 1] - table[index]) * frac;
+}
+
+// Move the phase on by delta samples' worth and return the new value
+// Sample & hold picks a new level each time the phase wraps
+double dx7_lfo_advance(dx7_lfo_t* lfo, int wave, uint32_t delta) {
+    uint32_t phase = lfo->phase + delta;
+    if (phase < lfo->phase) {
+        lfo->random = lfo->random * 1664525u + 1013904223u;
+        lfo->hold = (double)(lfo->random >> 8) / (double)(1u << 23) - 1.0;
+    }
+    lfo->phase = phase;
+    return dx7_lfo_value(lfo, wave);
+}
+
+// Values at the control points of a block: values[0] at the start, then
+// one at the end of every control_rate period (the last may be shorter).
+// Returns how many values were written - at most frame_count + 1
+int dx7_lfo_render(dx7_lfo_t* lfo, const dx7_patch_t* patch, double mod_wheel, int sample_rate,
+                   int control_rate, int frame_count, double* values) {
+    const int wave = patch->lfo_wave;
+    const uint32_t increment = dx7_lfo_increment(patch, mod_wheel, sample_rate);
+    int count = 0;
+
+    values[count++] = dx7_lfo_value(lfo, wave);
+    for (int t = 0; t < frame_count; t += control_rate) {
+        int n = frame_count - t;
+        if (n > control_rate) n = control_rate;
+        values[count++] = dx7_lfo_advance(lfo, wave, increment * (uint32_t)n);
+    }
+    return count;
+}
+
+// Samples from note-on until the LFO reaches full depth, 0 for no delay
+double dx7_lfo_delay_samples(const dx7_patch_t* patch, int sample_rate) {
+    double delay = (double)patch->lfo_delay / 99.0;
+    return delay * delay * LFO_MAX_DELAY * sample_rate;
+}
+
+// Depth multiplier for a voice that has played for samples: silent for the
+// first half of the delay, then a linear fade-in over the second half
+double dx7_lfo_delay_gain(double delay_samples, int64_t samples) {
+    if (delay_samples <= 0.0) {
+        return 1.0;
+    }
+    double gain = (double)samples * (2.0 / delay_samples) - 1.0;
+    return gain < 0.0 ? 0.0 : (gain > 1.0 ? 1.0 : gain);
+}
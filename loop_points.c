@@ -0,0 +1,145 @@
+#include "dx7.h"
+#include <float.h>
+
+// Loop point finder
+// The loop length comes straight from the LFO: its 32-bit phase advances by
+// a fixed increment per sample, so one cycle is exactly 2^32 / increment
+// samples and no cycle counting is needed. Only two short windows are then
+// rendered and searched - one for the start once the LFO delay has faded
+// in, one around start + length for the end - so memory stays constant
+// however long the loop is. Rendering always moves in whole
+// DX7_BLOCK_SIZE blocks from note-on, so a later dx7_render_note() pass
+// in DX7_WAV_CHUNK_FRAMES pieces reproduces exactly the searched samples.
+
+// Search window for each loop point, either side of the target
+#define LOOP_SEARCH_SECONDS 0.02
+
+// Loop length without an audible LFO
+#define LOOP_DEFAULT_SECONDS 1.0
+
+static int64_t align_down(int64_t samples) {
+    return samples / DX7_BLOCK_SIZE * DX7_BLOCK_SIZE;
+}
+
+static int64_t align_up(int64_t samples) {
+    return align_down(samples + DX7_BLOCK_SIZE - 1);
+}
+
+// LFO cycle in samples at the given mod wheel, 0 when the LFO can't be
+// heard (no speed, or neither amplitude nor pitch depth)
+double dx7_loop_lfo_period(const dx7_patch_t* patch, double mod_wheel, int sample_rate) {
+    bool audible = patch->lfo_amd > 0 || (patch->lfo_pmd > 0 && patch->lfo_pitch_mod_sens > 0);
+    uint32_t increment = dx7_lfo_increment(patch, mod_wheel, sample_rate);
+    if (!audible || increment == 0) {
+        return 0.0;
+    }
+    return DX7_PHASE_SCALE / (double)increment;
+}
+
+// Render on to sample target, discarding the output
+static void skip_to(voice_state_t* voice, const dx7_patch_t* patch, int64_t* position, int64_t target,
+                    float* scratch, int scratch_frames) {
+    while (*position < target) {
+        int frames = scratch_frames;
+        if (target - *position < frames) frames = (int)(target - *position);
+        dx7_render_note(voice, patch, scratch, frames);
+        *position += frames;
+    }
+}
+
+// Score every rising zero crossing by how far its value and slope are from
+// the wanted ones - everything else scores FLT_MAX. Branch-free so the
+// loop vectorizes, then the best score nearest to target wins
+static int best_crossing(const float* restrict samples, float* restrict scores, int count,
+                         float value, float slope, int target) {
+    for (int i = 1; i < count; i++) {
+        float previous = samples[i - 1];
+        float current = samples[i];
+        float score = fabsf(current - value) + fabsf((current - previous) - slope);
+        scores[i] = (previous < 0.0f && current >= 0.0f) ? score : FLT_MAX;
+    }
+
+    int best = -1;
+    float best_score = FLT_MAX;
+    for (int i = 1; i < count; i++) {
+        if (scores[i] < best_score ||
+            (scores[i] == best_score && best >= 0 && abs(i - target) < abs(best - target))) {
+            best = i;
+            best_score = scores[i];
+        }
+    }
+    return best_score < FLT_MAX ? best : -1;
+}
+
+// Steepest rise between neighbouring samples
+static float peak_slope(const float* samples, int count) {
+    float peak = 0.0f;
+    for (int i = 1; i < count; i++) {
+        float slope = samples[i] - samples[i - 1];
+        peak = slope > peak ? slope : peak;
+    }
+    return peak;
+}
+
+// Find loop points for cycles LFO cycles of a voice that was just started
+// (the voice itself is left untouched). The start is the steepest rising
+// zero crossing once the LFO delay is over; the end is the rising crossing
+// near start + cycles periods whose value and slope best match it, so the
+// sample at end can stand in for the one at start
+bool dx7_find_loop(const voice_state_t* voice, const dx7_patch_t* patch, int cycles, dx7_loop_t* loop) {
+    memset(loop, 0, sizeof(dx7_loop_t));
+    loop->cycles = cycles;
+    loop->lfo_period = dx7_loop_lfo_period(patch, 0.0, voice->sample_rate); // Offline renders have no mod wheel
+
+    int64_t length = loop->lfo_period > 0.0
+        ? (int64_t)llround(cycles * loop->lfo_period)
+        : (int64_t)(LOOP_DEFAULT_SECONDS * voice->sample_rate);
+
+    // Each window is a whole number of blocks, and never wider than the loop
+    int64_t half_window = align_up((int64_t)(LOOP_SEARCH_SECONDS * voice->sample_rate));
+    if (half_window > align_down(length / 2)) half_window = align_down(length / 2);
+    if (half_window < DX7_BLOCK_SIZE) half_window = DX7_BLOCK_SIZE;
+    int capacity = (int)(2 * half_window + DX7_BLOCK_SIZE);
+
+    float* samples = (float*)malloc((size_t)capacity * sizeof(float));
+    float* scores = (float*)malloc((size_t)capacity * sizeof(float));
+    if (!samples || !scores) {
+        free(samples);
+        free(scores);
+        return false;
+    }
+
+    voice_state_t state = *voice;
+    int64_t position = 0;
+
+    // Start window, after the LFO has faded in
+    skip_to(&state, patch, &position, align_up((int64_t)ceil(dx7_lfo_delay_samples(patch, voice->sample_rate))), samples, capacity);
+    int64_t window = position;
+    int count = (int)half_window;
+    dx7_render_note(&state, patch, samples, count);
+    position += count;
+
+    int start = best_crossing(samples, scores, count, 0.0f, peak_slope(samples, count), 0);
+    if (start < 0) {
+        start = 0; // Silent or no crossing - loop from the window
+    }
+    loop->start = window + start;
+    float start_value = samples[start];
+    float start_slope = start > 0 ? samples[start] - samples[start - 1] : 0.0f;
+
+    // End window, centred on start + length
+    int64_t target = loop->start + length;
+    int64_t first = align_down(target - half_window);
+    if (first < position) first = position;
+    skip_to(&state, patch, &position, first, samples, capacity);
+    count = (int)(align_up(target + half_window) - first);
+    if (count > capacity) count = capacity;
+    dx7_render_note(&state, patch, samples, count);
+
+    int end = best_crossing(samples, scores, count, start_value, start_slope, (int)(target - first));
+    loop->end = end >= 0 ? first + end : target;
+
+    free(samples);
+    free(scores);
+    return true;
+}
@@ -1,11 +1,10 @@
 #include "dx7.h"
+#include "midi_input.h"
+#include "rt_log.h"
 #include <getopt.h>
 #include <unistd.h>
 #include <string.h>
 
-// Global sample rate variable
-int g_sample_rate = 48000;
-
 void print_usage(const char* program_name) {
     printf("Usage: %s [options] <patch_file>\n", program_name);
     printf("Options:\n");
@@ -16,11 +15,37 @@ void print_usage(const char* program_name) {
     printf("  -s, --samplerate <hz> Sample rate in Hz (default: 48000)\n");
     printf("  -l, --loop [cycles]   Generate perfect loop (1-16 cycles, default: 1)\n");
     printf("                        Overrides duration - creates exact LFO cycles\n");
+    printf("                        (with -R: loop points in every sample and SFZ)\n");
     printf("  -m, --midi-list       List available MIDI devices and exit\n");
     printf("  -M, --midi-send <dev> Send patch to MIDI device (device index)\n");
-    printf("  -c, --midi-channel <ch> MIDI channel for SysEx (1-16, default: 1)\n");
+    printf("  -c, --midi-channel <ch> MIDI channel for SysEx and -f (1-16, default: 1)\n");
     printf("  -p, --play            Real-time MIDI play mode\n");
     printf("  -i, --midi-input <dev> MIDI input device for play mode (device index)\n");
+    printf("  -S, --sine <kernel>   Sine kernel: libm, table, poly (default: %s)\n",
+           dx7_sine_kernel_name(DX7_SINE_KERNEL));
+    printf("  -K, --control-rate <n> Envelope/LFO update interval in samples:\n");
+    printf("                        1, 2, 4 ... %d (default: %d)\n", DX7_BLOCK_SIZE, DX7_CONTROL_RATE);
+    printf("  -B, --voice-bank <isa> Play mode SIMD kernel: auto, sse2, avx2, neon, off\n");
+    printf("                        (default: auto - best the CPU supports)\n");
+    printf("  -P, --polyphony <n>   Play mode voices, 1-%d (default: %d)\n", MAX_POLYPHONY, DEFAULT_POLYPHONY);
+    printf("  -T, --threads <n>     Play mode render threads, or 'auto' for one per core\n");
+    printf("                        (default: 1 - render on the audio thread only)\n");
+    printf("  -L, --log-level <lvl> Play mode messages: error, warn, info, debug\n");
+    printf("                        (default: info - debug adds pitch bend and voice steals)\n");
+    printf("  -y, --library <file>  Take <patch_file> as a voice name or #index in a patch\n");
+    printf("                        library (also for 'l' in play mode)\n");
+    printf("  -b, --build-library <file> Build a patch library from .syx/.patch files\n");
+    printf("                        or directories, dropping duplicate voices\n");
+    printf("  -R, --multisample <lo:hi[:step]> Render every note in the range for each\n");
+    printf("                        voice in the patch files/banks given, plus SFZ maps\n");
+    printf("  -V, --velocity-layers <v1,v2,...> Velocity layers for -R (default: -v)\n");
+    printf("  -f, --midi-file <file> Render a type 0/1 MIDI file with the patch, polyphonic\n");
+    printf("                        (every channel unless -c is given; -P/-T/-B apply)\n");
+    printf("  -k, --check           Check .patch files (or directories) for unknown keys,\n");
+    printf("                        malformed lines and out-of-range values\n");
+    printf("  -X, --convert <fmt>   Convert .syx/.patch files or directories to syx (32-voice\n");
+    printf("                        banks), patch (text) or vced (single-voice dumps) in the\n");
+    printf("                        -o directory, using -T threads (default: one per core)\n");
     printf("  -h, --help           Show this help message\n");
     printf("\nExamples:\n");
     printf("  %s -n 64 -o epiano.wav epiano.patch\n", program_name);
@@ -29,259 +54,110 @@ void print_usage(const char* program_name) {
     printf("  %s -m                                         # List MIDI devices\n", program_name);
     printf("  %s -M 0 -c 1 epiano.patch                     # Send to MIDI device 0, channel 1\n", program_name);
     printf("  %s -p -i 0 -c 1 epiano.patch                  # Real-time play mode\n", program_name);
+    printf("  %s -X patch -o library/ cartridges/           # Unpack every bank to .patch files\n", program_name);
+    printf("  %s -b all.dx7lib cartridges/                  # Build a patch library\n", program_name);
+    printf("  %s -R 36:96:3 -V 40,90,127 -o piano/ epiano.patch # Multisampled instrument\n", program_name);
+    printf("  %s -f song.mid -P 32 -o song.wav epiano.patch # Render a backing track\n", program_name);
+    printf("  %s -k -T 8 library/                           # Validate a .patch library\n", program_name);
+    printf("  %s -y all.dx7lib -o ep.wav \"E.PIANO 1\"        # Render a library voice\n", program_name);
 }
 
 int load_patch(const char* filename, dx7_patch_t* patch) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Cannot open patch file '%s'\n", filename);
+    if (read_patch_file(filename, patch, NULL) != 0) {
         return -1;
     }
-    
-    char line[256];
-    int current_operator = -1;
-    
-    // Initialize patch with defaults
-    memset(patch, 0, sizeof(dx7_patch_t));
-    strcpy(patch->name, "INIT VOICE");
-    patch->algorithm = 1;
-    patch->feedback = 0;
-    patch->transpose = 0;
-    patch->poly_mono = 0;
-    patch->pitch_bend_range = 2;
-    
-    while (fgets(line, sizeof(line), file)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
-        
-        // Skip empty lines and comments
-        if (line[0] == '\0' || line[0] == '#') continue;
-        
-        // Parse operator header
-        if (strncmp(line, "OP", 2) == 0) {
-            current_operator = atoi(line + 2) - 1; // Convert to 0-indexed
-            if (current_operator < 0 || current_operator >= MAX_OPERATORS) {
-                current_operator = -1;
-            }
-            continue;
-        }
-        
-        // Parse parameters
-        char param[64], value[64];
-        if (sscanf(line, "%63s = %63s", param, value) == 2) {
-            if (strcmp(param, "NAME") == 0) {
-                strncpy(patch->name, value, MAX_PATCH_NAME - 1);
-                patch->name[MAX_PATCH_NAME - 1] = '\0';
-            } else if (strcmp(param, "ALGORITHM") == 0) {
-                patch->algorithm = atoi(value);
-            } else if (strcmp(param, "FEEDBACK") == 0) {
-                patch->feedback = atoi(value);
-            } else if (strcmp(param, "LFO_SPEED") == 0) {
-                patch->lfo_speed = atoi(value);
-            } else if (strcmp(param, "LFO_DELAY") == 0) {
-                patch->lfo_delay = atoi(value);
-            } else if (strcmp(param, "LFO_PMD") == 0) {
-                patch->lfo_pmd = atoi(value);
-            } else if (strcmp(param, "LFO_AMD") == 0) {
-                patch->lfo_amd = atoi(value);
-            } else if (strcmp(param, "LFO_SYNC") == 0) {
-                patch->lfo_sync = atoi(value);
-            } else if (strcmp(param, "LFO_WAVE") == 0) {
-                patch->lfo_wave = atoi(value);
-            } else if (strcmp(param, "LFO_PITCH_MOD_SENS") == 0) {
-                patch->lfo_pitch_mod_sens = atoi(value);
-            } else if (strcmp(param, "TRANSPOSE") == 0) {
-                patch->transpose = atoi(value);
-            } else if (current_operator >= 0) {
-                dx7_operator_t* op = &patch->operators[current_operator];
-                
-                if (strcmp(param, "FREQ_RATIO") == 0) {
-                    op->freq_ratio = atof(value);
-                } else if (strcmp(param, "DETUNE") == 0) {
-                    op->detune = atoi(value);
-                } else if (strcmp(param, "OUTPUT_LEVEL") == 0) {
-                    op->output_level = atoi(value);
-                } else if (strcmp(param, "KEY_VEL_SENS") == 0) {
-                    op->key_vel_sens = atoi(value);
-                } else if (strcmp(param, "ENV_ATTACK") == 0) {
-                    op->env_rates[ENV_ATTACK] = atoi(value);
-                } else if (strcmp(param, "ENV_DECAY1") == 0) {
-                    op->env_rates[ENV_DECAY1] = atoi(value);
-                } else if (strcmp(param, "ENV_DECAY2") == 0) {
-                    op->env_rates[ENV_DECAY2] = atoi(value);
-                } else if (strcmp(param, "ENV_RELEASE") == 0) {
-                    op->env_rates[ENV_RELEASE] = atoi(value);
-                } else if (strcmp(param, "ENV_LEVEL1") == 0) {
-                    op->env_levels[ENV_ATTACK] = atoi(value);
-                } else if (strcmp(param, "ENV_LEVEL2") == 0) {
-                    op->env_levels[ENV_DECAY1] = atoi(value);
-                } else if (strcmp(param, "ENV_LEVEL3") == 0) {
-                    op->env_levels[ENV_DECAY2] = atoi(value);
-                } else if (strcmp(param, "ENV_LEVEL4") == 0) {
-                    op->env_levels[ENV_RELEASE] = atoi(value);
-                } else if (strcmp(param, "KEY_LEVEL_SCALE_BREAK_POINT") == 0) {
-                    op->key_level_scale_break_point = atoi(value);
-                } else if (strcmp(param, "KEY_LEVEL_SCALE_LEFT_DEPTH") == 0) {
-                    op->key_level_scale_left_depth = atoi(value);
-                } else if (strcmp(param, "KEY_LEVEL_SCALE_RIGHT_DEPTH") == 0) {
-                    op->key_level_scale_right_depth = atoi(value);
-                } else if (strcmp(param, "KEY_LEVEL_SCALE_LEFT_CURVE") == 0) {
-                    op->key_level_scale_left_curve = atoi(value);
-                } else if (strcmp(param, "KEY_LEVEL_SCALE_RIGHT_CURVE") == 0) {
-                    op->key_level_scale_right_curve = atoi(value);
-                } else if (strcmp(param, "KEY_RATE_SCALING") == 0) {
-                    op->key_rate_scaling = atoi(value);
-                } else if (strcmp(param, "OSC_SYNC") == 0) {
-                    op->osc_sync = atoi(value);
-                }
-            }
-        }
-    }
-    
-    fclose(file);
     printf("Loaded patch: %s\n", patch->name);
     return 0;
 }
 
-double calculate_lfo_frequency(const dx7_patch_t* patch) {
-    // LFO frequency calculation based on oscillators.c implementation
-    // Max frequency is 6 Hz when speed = 99
-    return (double)patch->lfo_speed / 99.0 * 6.0;
-}
-
-int calculate_perfect_loop_samples(const dx7_patch_t* patch, int num_cycles) {
-    double lfo_freq = calculate_lfo_frequency(patch);
-    
-    if (lfo_freq <= 0.0) {
-        // No LFO, default to 1 second loop
-        printf("No LFO detected, using 1 second loop\n");
-        return g_sample_rate;
+// Write a patch in the text format read_patch_file() reads
+// Names can't contain spaces there, so they are written with underscores
+int write_patch_file(const char* filename, const dx7_patch_t* patch) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot create patch file '%s'\n", filename);
+        return -1;
     }
     
-    // Calculate approximate samples for desired number of LFO cycles
-    double cycle_time = (double)num_cycles / lfo_freq;
-    int samples = (int)round(cycle_time * g_sample_rate);
-    
-    // Ensure we have at least some samples
-    if (samples < 1) samples = 1;
-    
-    printf("LFO frequency: %.2f Hz\n", lfo_freq);
-    printf("Approximate loop duration: %.3f seconds (%d cycles)\n", cycle_time, num_cycles);
-    printf("Target samples (will adjust for zero crossing): %d\n", samples);
-    
-    return samples;
-}
-
-int find_zero_crossing_loop_end(voice_state_t* voice, const dx7_patch_t* patch, 
-                                int target_samples, float* buffer, int max_samples) {
-    double prev_sample = 0.0;
-    double current_sample = 0.0;
-    int samples_generated = 0;
-    int lfo_cycles_completed = 0;
-    double prev_lfo_phase = 0.0;
-    int target_cycles = (int)round((double)target_samples * calculate_lfo_frequency(patch) / g_sample_rate);
-    int loop_start_index = 0;
-    int found_start = 0;
-    
-    printf("Target LFO cycles: %d\n", target_cycles);
-    
-    // Step 1: Find first zero crossing to start our loop
-    printf("Finding starting zero crossing...\n");
-    for (int i = 0; i < max_samples / 4; i++) { // Search first quarter of buffer for start
-        current_sample = process_operators(voice, patch);
-        
-        if (i > 0) {
-            // Look for zero crossing (sign change or very close to zero)
-            if (((prev_sample >= 0.0 && current_sample < 0.0) || 
-                 (prev_sample < 0.0 && current_sample >= 0.0)) ||
-                 (fabs(current_sample) < 0.001)) { // Very close to zero
-                
-                loop_start_index = i;
-                buffer[i] = 0.0f; // Force exact zero at start
-                found_start = 1;
-                samples_generated = i + 1;
-                prev_lfo_phase = voice->lfo_phase;
-                printf("Loop start at sample %d (value: %.6f)\n", i, current_sample);
-                break;
-            }
-        }
-        
-        buffer[i] = (float)current_sample * 0.8f;
-        prev_sample = current_sample;
+    char name[MAX_PATCH_NAME];
+    strncpy(name, patch->name[0] ? patch->name : "UNNAMED", sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    for (char* c = name; *c; c++) {
+        if (*c == ' ' || *c == '\t' || *c == '#') *c = '_';
     }
     
-    if (!found_start) {
-        printf("Warning: Could not find starting zero crossing, using sample 0\n");
-        loop_start_index = 0;
-        samples_generated = 1;
-        prev_lfo_phase = voice->lfo_phase;
-        buffer[0] = 0.0f; // Force zero start
+    fprintf(file, "# DX7 %s Patch\n\n", name);
+    fprintf(file, "NAME = %s\n\n", name);
+    
+    fprintf(file, "# Global parameters\n");
+    fprintf(file, "ALGORITHM = %d\n", patch->algorithm);
+    fprintf(file, "FEEDBACK = %d\n", patch->feedback);
+    fprintf(file, "TRANSPOSE = %d\n", patch->transpose);
+    fprintf(file, "PITCH_BEND_RANGE = %d\n\n", patch->pitch_bend_range);
+    
+    fprintf(file, "# LFO settings\n");
+    fprintf(file, "LFO_SPEED = %d\n", patch->lfo_speed);
+    fprintf(file, "LFO_DELAY = %d\n", patch->lfo_delay);
+    fprintf(file, "LFO_PMD = %d\n", patch->lfo_pmd);
+    fprintf(file, "LFO_AMD = %d\n", patch->lfo_amd);
+    fprintf(file, "LFO_SYNC = %d\n", patch->lfo_sync);
+    fprintf(file, "LFO_WAVE = %d\n", patch->lfo_wave);
+    fprintf(file, "LFO_PITCH_MOD_SENS = %d\n\n", patch->lfo_pitch_mod_sens);
+    
+    fprintf(file, "# Pitch envelope\n");
+    for (int i = 0; i < ENVELOPE_STAGES; i++) {
+        fprintf(file, "PITCH_ENV_RATE%d = %d\n", i + 1, patch->pitch_env_rates[i]);
+    }
+    for (int i = 0; i < ENVELOPE_STAGES; i++) {
+        fprintf(file, "PITCH_ENV_LEVEL%d = %d\n", i + 1, patch->pitch_env_levels[i]);
     }
     
-    // Step 2: Continue synthesis, counting LFO cycles
-    prev_sample = 0.0; // Reset for end detection
+    for (int i = 0; i < MAX_OPERATORS; i++) {
+        const dx7_operator_t* op = &patch->operators[i];
+        fprintf(file, "\n# Operator %d\nOP%d\n", i + 1, i + 1);
+        fprintf(file, "FREQ_RATIO = %.4f\n", op->freq_ratio);
+        fprintf(file, "DETUNE = %d\n", op->detune);
+        fprintf(file, "OUTPUT_LEVEL = %d\n", op->output_level);
+        fprintf(file, "KEY_VEL_SENS = %d\n", op->key_vel_sens);
+        fprintf(file, "AMP_MOD_SENS = %d\n", op->amp_mod_sens);
+        fprintf(file, "ENV_ATTACK = %d\n", op->env_rates[ENV_ATTACK]);
+        fprintf(file, "ENV_DECAY1 = %d\n", op->env_rates[ENV_DECAY1]);
+        fprintf(file, "ENV_DECAY2 = %d\n", op->env_rates[ENV_DECAY2]);
+        fprintf(file, "ENV_RELEASE = %d\n", op->env_rates[ENV_RELEASE]);
+        fprintf(file, "ENV_LEVEL1 = %d\n", op->env_levels[ENV_ATTACK]);
+        fprintf(file, "ENV_LEVEL2 = %d\n", op->env_levels[ENV_DECAY1]);
+        fprintf(file, "ENV_LEVEL3 = %d\n", op->env_levels[ENV_DECAY2]);
+        fprintf(file, "ENV_LEVEL4 = %d\n", op->env_levels[ENV_RELEASE]);
+        fprintf(file, "KEY_LEVEL_SCALE_BREAK_POINT = %d\n", op->key_level_scale_break_point);
+        fprintf(file, "KEY_LEVEL_SCALE_LEFT_DEPTH = %d\n", op->key_level_scale_left_depth);
+        fprintf(file, "KEY_LEVEL_SCALE_RIGHT_DEPTH = %d\n", op->key_level_scale_right_depth);
+        fprintf(file, "KEY_LEVEL_SCALE_LEFT_CURVE = %d\n", op->key_level_scale_left_curve);
+        fprintf(file, "KEY_LEVEL_SCALE_RIGHT_CURVE = %d\n", op->key_level_scale_right_curve);
+        fprintf(file, "KEY_RATE_SCALING = %d\n", op->key_rate_scaling);
+        fprintf(file, "OSC_SYNC = %d\n", op->osc_sync);
+        fprintf(file, "OSC_MODE = %d\n", op->osc_mode);
+    }
     
-    for (int i = samples_generated; i < max_samples; i++) {
-        current_sample = process_operators(voice, patch);
-        
-        // Count completed LFO cycles (detect when LFO phase wraps around)
-        if (voice->lfo_phase < prev_lfo_phase) {
-            lfo_cycles_completed++;
-            printf("LFO cycle %d completed at sample %d\n", lfo_cycles_completed, i);
-        }
-        prev_lfo_phase = voice->lfo_phase;
-        
-        // Step 3: After completing target cycles, look for ending zero crossing
-        if (lfo_cycles_completed >= target_cycles && i > (loop_start_index + target_samples)) {
-            // Check for zero crossing (sign change) or very close to zero
-            if (((prev_sample >= 0.0 && current_sample < 0.0) || 
-                 (prev_sample < 0.0 && current_sample >= 0.0)) ||
-                 (fabs(current_sample) < 0.001)) {
-                
-                buffer[i] = 0.0f; // Force exact zero for perfect loop end
-                samples_generated = i + 1;
-                
-                printf("Loop end zero crossing at sample %d (value: %.6f)\n", i, current_sample);
-                printf("Total LFO cycles completed: %d\n", lfo_cycles_completed);
-                printf("Loop length: %d samples (%.3f seconds)\n", 
-                       samples_generated - loop_start_index, 
-                       (double)(samples_generated - loop_start_index) / g_sample_rate);
-                
-                // Shift the loop to start at index 0
-                if (loop_start_index > 0) {
-                    int loop_length = samples_generated - loop_start_index;
-                    memmove(buffer, buffer + loop_start_index, loop_length * sizeof(float));
-                    samples_generated = loop_length;
-                    printf("Shifted loop to start at sample 0, final length: %d samples\n", samples_generated);
-                }
-                
-                return samples_generated;
-            }
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok ? 0 : -1;
+}
+
+// Load a patch by library name or "#index" when a library is open,
+// otherwise (or if the library has no such voice) from a patch file
+static int select_patch(const dx7_library_t* library, const char* selector, dx7_patch_t* patch) {
+    if (library->map) {
+        int index = dx7_library_select(library, selector);
+        if (index >= 0 && dx7_library_get(library, index, patch)) {
+            printf("Loaded patch: %s (library voice #%d)\n", patch->name, index);
+            return 0;
         }
-        
-        // Apply gentle limiting to prevent clipping
-        if (current_sample > 1.0) current_sample = 1.0;
-        if (current_sample < -1.0) current_sample = -1.0;
-        
-        buffer[i] = (float)current_sample * 0.8f;
-        prev_sample = current_sample;
-        samples_generated++;
-        
-        // Safety check
-        if (i >= max_samples - 1) {
-            printf("Warning: Reached maximum samples without finding ending zero crossing\n");
-            break;
+        if (access(selector, F_OK) != 0) {
+            fprintf(stderr, "Error: No voice '%s' in the library\n", selector);
+            return -1;
         }
     }
-    
-    // If we didn't find a perfect end, just return what we have
-    if (loop_start_index > 0 && samples_generated > loop_start_index) {
-        int loop_length = samples_generated - loop_start_index;
-        memmove(buffer, buffer + loop_start_index, loop_length * sizeof(float));
-        return loop_length;
-    }
-    
-    return samples_generated;
+    return load_patch(selector, patch);
 }
 
 // List available MIDI devices
@@ -408,6 +284,25 @@ int main(int argc, char* argv[]) {
     int midi_channel = 1;
     int play_mode = 0;
     int midi_input_device = -1;
+    int sample_rate = DX7_DEFAULT_SAMPLE_RATE;
+    dx7_engine_config_t engine_config; // Play mode and -f engine, control rate and sine for every render
+    dx7_engine_default_config(&engine_config);
+    int threads = 0;               // Conversion threads, 0 = one per core
+    int convert_format = -1;
+    bool output_given = false;
+    const char* library_path = NULL;
+    const char* build_library_path = NULL;
+    bool check_patches = false;
+    const char* note_range = NULL;
+    const char* velocity_layers = NULL;
+    const char* midi_file = NULL;
+    bool channel_given = false;
+    bool log_level_given = false;
+    dx7_library_t library = {0};
+    
+    // Build the sine and LFO tables
+    dx7_sine_init();
+    dx7_lfo_init();
     
     // Command line parsing
     static struct option long_options[] = {
@@ -422,12 +317,25 @@ int main(int argc, char* argv[]) {
         {"midi-channel", required_argument, 0, 'c'},
         {"play", no_argument, 0, 'p'},
         {"midi-input", required_argument, 0, 'i'},
+        {"sine", required_argument, 0, 'S'},
+        {"control-rate", required_argument, 0, 'K'},
+        {"voice-bank", required_argument, 0, 'B'},
+        {"polyphony", required_argument, 0, 'P'},
+        {"threads", required_argument, 0, 'T'},
+        {"log-level", required_argument, 0, 'L'},
+        {"convert", required_argument, 0, 'X'},
+        {"library", required_argument, 0, 'y'},
+        {"build-library", required_argument, 0, 'b'},
+        {"check", no_argument, 0, 'k'},
+        {"multisample", required_argument, 0, 'R'},
+        {"velocity-layers", required_argument, 0, 'V'},
+        {"midi-file", required_argument, 0, 'f'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "n:o:v:d:s:l::mM:c:pi:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "n:o:v:d:s:l::mM:c:pi:S:K:B:P:T:L:X:y:b:kR:V:f:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'n':
                 midi_note = atoi(optarg);
@@ -439,6 +347,7 @@ int main(int argc, char* argv[]) {
             case 'o':
                 strncpy(output_filename, optarg, sizeof(output_filename) - 1);
                 output_filename[sizeof(output_filename) - 1] = '\0';
+                output_given = true;
                 break;
             case 'v':
                 velocity = atoi(optarg);
@@ -455,8 +364,8 @@ int main(int argc, char* argv[]) {
                 }
                 break;
             case 's':
-                g_sample_rate = atoi(optarg);
-                if (g_sample_rate < 8000 || g_sample_rate > 192000) {
+                sample_rate = atoi(optarg);
+                if (sample_rate < 8000 || sample_rate > 192000) {
                     fprintf(stderr, "Error: Sample rate must be 8000-192000 Hz\n");
                     return 1;
                 }
@@ -483,6 +392,7 @@ int main(int argc, char* argv[]) {
                 break;
             case 'c':
                 midi_channel = atoi(optarg);
+                channel_given = true;
                 if (midi_channel < 1 || midi_channel > 16) {
                     fprintf(stderr, "Error: MIDI channel must be 1-16\n");
                     return 1;
@@ -498,6 +408,82 @@ int main(int argc, char* argv[]) {
                     return 1;
                 }
                 break;
+            case 'S': {
+                int kernel = dx7_sine_kernel_from_name(optarg);
+                if (kernel < 0) {
+                    fprintf(stderr, "Error: Sine kernel must be libm, table or poly\n");
+                    return 1;
+                }
+                engine_config.sine_kernel = (dx7_sine_kernel_t)kernel;
+                break;
+            }
+            case 'K':
+                if (!dx7_engine_config_set_control_rate(&engine_config, atoi(optarg))) {
+                    fprintf(stderr, "Error: Control rate must be a power of two from 1 to %d\n", DX7_BLOCK_SIZE);
+                    return 1;
+                }
+                break;
+            case 'B': {
+                if (strcmp(optarg, "off") == 0) {
+                    engine_config.use_voice_bank = false;
+                    break;
+                }
+                int isa = voice_bank_isa_from_name(optarg);
+                if (isa < VOICE_BANK_ISA_AUTO) {
+                    fprintf(stderr, "Error: Voice bank kernel must be auto, sse2, avx2, neon or off\n");
+                    return 1;
+                }
+                engine_config.voice_bank_isa = (voice_bank_isa_t)isa;
+                break;
+            }
+            case 'P':
+                if (!dx7_engine_config_set_polyphony(&engine_config, atoi(optarg))) {
+                    fprintf(stderr, "Error: Polyphony must be between 1 and %d\n", MAX_POLYPHONY);
+                    return 1;
+                }
+                break;
+            case 'T':
+                threads = strcmp(optarg, "auto") == 0 ? 0 : atoi(optarg);
+                if (!dx7_engine_config_set_render_threads(&engine_config, threads)) {
+                    fprintf(stderr, "Error: Threads must be 'auto' or between 1 and %d\n", RENDER_POOL_MAX_THREADS + 1);
+                    return 1;
+                }
+                break;
+            case 'y':
+                library_path = optarg;
+                break;
+            case 'b':
+                build_library_path = optarg;
+                break;
+            case 'k':
+                check_patches = true;
+                break;
+            case 'R':
+                note_range = optarg;
+                break;
+            case 'V':
+                velocity_layers = optarg;
+                break;
+            case 'f':
+                midi_file = optarg;
+                break;
+            case 'X':
+                convert_format = dx7_convert_format_from_name(optarg);
+                if (convert_format < 0) {
+                    fprintf(stderr, "Error: Conversion format must be syx, patch or vced\n");
+                    return 1;
+                }
+                break;
+            case 'L': {
+                int level = rt_log_level_from_name(optarg);
+                if (level < 0) {
+                    fprintf(stderr, "Error: Log level must be error, warn, info or debug\n");
+                    return 1;
+                }
+                rt_log_set_level((rt_log_level_t)level);
+                log_level_given = true;
+                break;
+            }
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -513,6 +499,62 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
+    // Handle bulk conversion - every remaining argument is an input
+    if (convert_format >= 0) {
+        if (optind >= argc) {
+            fprintf(stderr, "Error: No files or directories to convert\n");
+            return 1;
+        }
+        int failed = dx7_convert((const char* const*)(argv + optind), argc - optind,
+                                 output_given ? output_filename : ".",
+                                 (dx7_convert_format_t)convert_format, threads);
+        return failed == 0 ? 0 : 1;
+    }
+    
+    // Handle multisample rendering - every remaining argument is an input
+    if (note_range) {
+        dx7_multisample_spec_t spec = { .duration = duration, .loop_cycles = use_loop_mode ? loop_cycles : 0,
+                                        .sample_rate = sample_rate, .control_rate = engine_config.control_rate,
+                                        .sine_kernel = engine_config.sine_kernel };
+        if (!dx7_parse_note_range(note_range, &spec)) {
+            fprintf(stderr, "Error: Note range must be lo:hi or lo:hi:step with 0 <= lo <= hi <= 127\n");
+            return 1;
+        }
+        if (!velocity_layers) {
+            spec.velocities[0] = velocity;
+            spec.velocity_count = 1;
+        } else if (!dx7_parse_velocity_layers(velocity_layers, &spec)) {
+            fprintf(stderr, "Error: Velocity layers must be up to %d rising values from 1 to 127\n",
+                    DX7_MULTISAMPLE_MAX_LAYERS);
+            return 1;
+        }
+        if (optind >= argc) {
+            fprintf(stderr, "Error: No patch files to render\n");
+            return 1;
+        }
+        return dx7_render_multisamples((const char* const*)(argv + optind), argc - optind,
+                                       output_given ? output_filename : ".", &spec, threads) == 0 ? 0 : 1;
+    }
+    
+    // Handle patch checking - nonzero exit if any file has problems
+    if (check_patches) {
+        if (optind >= argc) {
+            fprintf(stderr, "Error: No files or directories to check\n");
+            return 1;
+        }
+        return dx7_check_patches((const char* const*)(argv + optind), argc - optind, threads) == 0 ? 0 : 1;
+    }
+    
+    // Handle library building - every remaining argument is an input
+    if (build_library_path) {
+        if (optind >= argc) {
+            fprintf(stderr, "Error: No files or directories to build the library from\n");
+            return 1;
+        }
+        return dx7_library_build((const char* const*)(argv + optind), argc - optind,
+                                 build_library_path, threads) >= 0 ? 0 : 1;
+    }
+    
     // Check for patch file argument
     if (optind >= argc) {
         fprintf(stderr, "Error: No patch file specified\n");
@@ -522,11 +564,17 @@ int main(int argc, char* argv[]) {
     
     const char* patch_filename = argv[optind];
     
-    // Load patch
+    // Load patch - the library is mapped, not read, however large it is
+    if (library_path && !dx7_library_open(&library, library_path)) {
+        return 1;
+    }
     dx7_patch_t patch;
-    if (load_patch(patch_filename, &patch) != 0) {
+    if (select_patch(&library, patch_filename, &patch) != 0) {
         return 1;
     }
+    if (!play_mode) {
+        dx7_library_close(&library); // The patch is a copy
+    }
     
     // Handle MIDI sending (no audio synthesis)
     if (midi_device >= 0) {
@@ -534,45 +582,61 @@ int main(int argc, char* argv[]) {
         return success ? 0 : 1;
     }
     
+    // Handle MIDI file rendering - the play mode engine, run offline
+    if (midi_file) {
+        if (!log_level_given) {
+            rt_log_set_level(RT_LOG_WARN); // Not every note
+        }
+        engine_config.sample_rate = sample_rate;
+        engine_config.channel = channel_given ? midi_channel : 0;
+        return dx7_render_midi_file(midi_file, &patch, &engine_config, output_filename);
+    }
+    
     // Handle real-time play mode
     if (play_mode) {
         printf("🎹 Starting real-time MIDI play mode...\n");
         
         // Initialize MIDI input system
-        if (!midi_input_initialize(&patch, midi_input_device, midi_channel)) {
+        engine_config.sample_rate = sample_rate;
+        engine_config.channel = midi_channel;
+        dx7_engine_t* engine = midi_input_initialize(&engine_config, &patch, midi_input_device);
+        if (!engine) {
             fprintf(stderr, "❌ Failed to initialize MIDI input system\n");
             return 1;
         }
         
+        // Program change 0 returns to the startup patch
+        midi_input_set_program(engine, 0, &patch);
+        
         // Open MIDI input device if specified
         if (midi_input_device >= 0) {
             void* input_handle = NULL;
             if (midi_platform_open_input_device(midi_input_device, &input_handle)) {
-                if (midi_platform_start_input(input_handle, NULL)) {
+                if (midi_platform_start_input(input_handle, engine)) {
                     printf("✅ MIDI input device %d connected\n", midi_input_device);
                 } else {
                     printf("❌ Failed to start MIDI input\n");
-                    midi_input_shutdown();
+                    midi_input_shutdown(engine);
                     return 1;
                 }
             } else {
                 printf("❌ Failed to open MIDI input device %d\n", midi_input_device);
-                midi_input_shutdown();
+                midi_input_shutdown(engine);
                 return 1;
             }
         }
         
         // Start play mode
-        if (!midi_input_start_play_mode()) {
+        if (!midi_input_start_play_mode(engine)) {
             fprintf(stderr, "❌ Failed to start play mode\n");
-            midi_input_shutdown();
+            midi_input_shutdown(engine);
             return 1;
         }
         
         printf("\n🎵 Real-time synthesis active!\n");
         printf("🎹 Patch: %s\n", patch.name);
         printf("🎛️ MIDI Channel: %d\n", midi_channel);
-        printf("🔊 Sample Rate: %d Hz\n", g_sample_rate);
+        printf("🔊 Sample Rate: %d Hz\n", sample_rate);
         printf("\n📋 Controls:\n");
         printf("   • Play notes on your MIDI controller\n");
         printf("   • Use mod wheel for LFO modulation\n");
@@ -580,6 +644,7 @@ int main(int argc, char* argv[]) {
         printf("   • Sustain pedal supported\n");
         printf("   • Press 's' + Enter for statistics\n");
         printf("   • Press 'v' + Enter for active voices\n");
+        printf("   • Type 'l <file>' + Enter to load another patch\n");
         printf("   • Press 'q' + Enter to quit\n\n");
         
         // Interactive loop
@@ -588,6 +653,9 @@ int main(int argc, char* argv[]) {
             if (fgets(input, sizeof(input), stdin) != NULL) {
                 char command = input[0];
                 
+                // Free patches the audio thread has finished with
+                midi_input_collect_patches(engine);
+                
                 switch (command) {
                     case 'q':
                     case 'Q':
@@ -596,19 +664,40 @@ int main(int argc, char* argv[]) {
                         
                     case 's':
                     case 'S':
-                        print_midi_stats();
+                        print_midi_stats(engine);
                         break;
                         
                     case 'v':
                     case 'V':
-                        print_active_voices();
+                        print_active_voices(engine);
+                        break;
+                        
+                    case 'l':
+                    case 'L': {
+                        // Swapped in at the next audio block; held notes keep
+                        // sounding with the patch they started with
+                        char* filename = input + 1;
+                        filename += strspn(filename, " \t");
+                        filename[strcspn(filename, "\r\n")] = '\0';
+                        dx7_patch_t loaded;
+                        if (*filename == '\0') {
+                            printf("❓ Usage: l <patch_file or library voice>\n");
+                        } else if (select_patch(&library, filename, &loaded) == 0) {
+                            if (midi_input_set_patch(engine, &loaded)) {
+                                printf("🎹 Patch: %s\n", loaded.name);
+                            } else {
+                                printf("❌ Failed to allocate patch\n");
+                            }
+                        }
                         break;
+                    }
                         
                     case 'h':
                     case 'H':
                         printf("\n📋 Commands:\n");
                         printf("   s - Show statistics\n");
                         printf("   v - Show active voices\n");
+                        printf("   l <file> - Load a patch (or a library voice name / #index)\n");
                         printf("   h - Show this help\n");
                         printf("   q - Quit\n\n");
                         break;
@@ -624,7 +713,8 @@ int main(int argc, char* argv[]) {
         
         cleanup_play_mode:
         // Cleanup
-        midi_input_shutdown();
+        midi_input_shutdown(engine);
+        dx7_library_close(&library);
         printf("✅ Play mode stopped\n");
         return 0;
     }
@@ -635,79 +725,74 @@ int main(int argc, char* argv[]) {
     if (midi_note > 127) midi_note = 127;
     
     // Setup audio output
-    SF_INFO sf_info;
-    sf_info.samplerate = g_sample_rate;
-    sf_info.channels = 1; // Mono
-    sf_info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
-    
-    SNDFILE* sf = sf_open(output_filename, SFM_WRITE, &sf_info);
-    if (!sf) {
-        fprintf(stderr, "Error: Cannot create output file '%s'\n", output_filename);
-        fprintf(stderr, "libsndfile error: %s\n", sf_strerror(sf));
+    dx7_wav_stream_t stream;
+    if (!dx7_wav_stream_open(&stream, output_filename, sample_rate)) {
         return 1;
     }
     
     // Initialize voice
     voice_state_t voice;
     double vel_normalized = (double)velocity / 127.0;
-    init_operators(&voice, &patch, midi_note, vel_normalized);
-    
-    // Calculate buffer size
-    int target_samples;
-    int max_buffer_size;
+    init_operators(&voice, &patch, midi_note, vel_normalized, sample_rate, engine_config.control_rate,
+                   dx7_sine_kernel_fn(engine_config.sine_kernel));
     
     if (use_loop_mode) {
-        target_samples = calculate_perfect_loop_samples(&patch, loop_cycles);
-        // Allow extra buffer space for zero crossing search (up to 2x target)
-        max_buffer_size = target_samples * 2;
-    } else {
-        target_samples = (int)(duration * g_sample_rate);
-        max_buffer_size = target_samples;
-    }
-    
-    // Synthesis loop
-    float* buffer = malloc(max_buffer_size * sizeof(float));
-    if (!buffer) {
-        fprintf(stderr, "Error: Cannot allocate audio buffer\n");
-        sf_close(sf);
-        return 1;
-    }
-    
-    int actual_samples;
-    if (use_loop_mode) {
-        // Use zero-crossing detection for perfect loops
-        actual_samples = find_zero_crossing_loop_end(&voice, &patch, target_samples, buffer, max_buffer_size);
-        duration = (double)actual_samples / g_sample_rate; // Update duration for display
-    } else {
-        // Standard synthesis
-        for (int i = 0; i < target_samples; i++) {
-            double sample = process_operators(&voice, &patch);
+        // Only the search windows are rendered to place the loop, then the
+        // note is rendered again from the start, streaming just the loop
+        dx7_loop_t loop;
+        if (!dx7_find_loop(&voice, &patch, loop_cycles, &loop)) {
+            fprintf(stderr, "Error: Cannot allocate audio buffer\n");
+            dx7_wav_stream_close(&stream);
+            return 1;
+        }
+        if (loop.lfo_period > 0.0) {
+            printf("LFO: %.3f Hz (%s), %.1f samples per cycle, looping %d cycles\n",
+                   sample_rate / loop.lfo_period, dx7_lfo_wave_name(patch.lfo_wave), loop.lfo_period, loop_cycles);
+        } else {
+            printf("No audible LFO, using a 1 second loop\n");
+        }
+        printf("Loop: samples %lld-%lld, %lld samples (%.3f seconds)\n",
+               (long long)loop.start, (long long)loop.end - 1, (long long)(loop.end - loop.start),
+               (double)(loop.end - loop.start) / sample_rate);
+        duration = (double)(loop.end - loop.start) / sample_rate; // Update duration for display
+        
+        float* chunk;
+        for (int64_t done = 0; done < loop.end && (chunk = dx7_wav_stream_chunk(&stream)); ) {
+            int frames = DX7_WAV_CHUNK_FRAMES;
+            if (loop.end - done < frames) frames = (int)(loop.end - done);
+            dx7_render_note(&voice, &patch, chunk, frames);
             
-            // Apply gentle limiting to prevent clipping
-            if (sample > 1.0) sample = 1.0;
-            if (sample < -1.0) sample = -1.0;
+            // Drop everything before the loop start
+            int skip = done < loop.start ? (int)(loop.start - done < frames ? loop.start - done : frames) : 0;
+            if (skip > 0) {
+                memmove(chunk, chunk + skip, (size_t)(frames - skip) * sizeof(float));
+            }
+            dx7_wav_stream_submit(&stream, frames - skip);
+            done += frames;
+        }
+    } else {
+        // Standard synthesis, one block at a time into fixed-size chunks;
+        // each full chunk is written while the next one renders
+        int64_t total_samples = (int64_t)(duration * sample_rate);
+        float* chunk;
+        
+        for (int64_t done = 0; done < total_samples && (chunk = dx7_wav_stream_chunk(&stream)); ) {
+            int chunk_frames = DX7_WAV_CHUNK_FRAMES;
+            if (total_samples - done < chunk_frames) chunk_frames = (int)(total_samples - done);
             
-            buffer[i] = (float)sample * 0.8f; // Scale down slightly for headroom
+            dx7_render_note(&voice, &patch, chunk, chunk_frames);
+            dx7_wav_stream_submit(&stream, chunk_frames);
+            done += chunk_frames;
         }
-        actual_samples = target_samples;
     }
     
-    // Write to file
-    sf_count_t written = sf_write_float(sf, buffer, actual_samples);
-    if (written != actual_samples) {
-        fprintf(stderr, "Error: Could not write all samples to file\n");
-        free(buffer);
-        sf_close(sf);
+    if (!dx7_wav_stream_close(&stream)) {
         return 1;
     }
     
-    // Cleanup
-    free(buffer);
-    sf_close(sf);
-    
     printf("Successfully created %s\n", output_filename);
     if (use_loop_mode) {
-        printf("Perfect loop with zero crossings: loops seamlessly!\n");
+        printf("Perfect loop: the end matches the start sample and slope, loops seamlessly!\n");
     }
     return 0;
 }
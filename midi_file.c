@@ -0,0 +1,426 @@
+// clock_gettime under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include "midi_input.h"
+#include "rt_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Standard MIDI File renderer
+// A type 0 or 1 file is read whole, every track's events are merged into
+// one list ordered by tick (then track, then position in the track), and
+// each tick is turned into a sample position through the tempo map. The
+// events are then fed to the play mode voice engine at those positions,
+// rendering the audio in between on this thread as fast as it will go,
+// and the result is streamed to a WAV file. Once the last event has
+// played, held notes are released and the render runs on until every
+// voice has died away (at most MIDI_FILE_TAIL_SECONDS).
+
+#define MIDI_FILE_TAIL_SECONDS  10.0
+#define MIDI_FILE_TAIL_FRAMES   1024        // Silence checks in the tail
+#define MIDI_FILE_TEMPO_DEFAULT 500000      // Microseconds per quarter (120 BPM)
+
+typedef enum {
+    SMF_EVENT_CHANNEL,      // Note, controller, program, pressure or bend
+    SMF_EVENT_TEMPO
+} smf_event_kind_t;
+
+typedef struct {
+    uint64_t tick;
+    uint32_t sequence;      // Track, then order within it - keeps sorting stable
+    uint8_t kind;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+    uint32_t tempo;         // Microseconds per quarter note (tempo events)
+    int64_t frame;          // Sample position, from the tempo map
+} smf_event_t;
+
+typedef struct {
+    smf_event_t* events;
+    int count;
+    int capacity;
+    int format;
+    int tracks;
+    int division;           // Ticks per quarter note, or SMPTE when negative
+    int skipped;            // SysEx and other events the engine doesn't take
+} smf_song_t;
+
+static bool add_event(smf_song_t* song, const smf_event_t* event) {
+    if (song->count == song->capacity) {
+        int capacity = song->capacity ? song->capacity * 2 : 1024;
+        smf_event_t* grown = (smf_event_t*)realloc(song->events, (size_t)capacity * sizeof(smf_event_t));
+        if (!grown) {
+            return false;
+        }
+        song->events = grown;
+        song->capacity = capacity;
+    }
+    // Events are added track by track, so the count orders equal ticks
+    song->events[song->count] = *event;
+    song->events[song->count].sequence = (uint32_t)song->count;
+    song->count++;
+    return true;
+}
+
+static uint32_t read_be(const uint8_t* data, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// Variable-length quantity, false if it runs past end or over 4 bytes
+static bool read_vlq(const uint8_t** data, const uint8_t* end, uint32_t* value) {
+    *value = 0;
+    for (int i = 0; i < 4 && *data < end; i++) {
+        uint8_t byte = *(*data)++;
+        *value = (*value << 7) | (byte & 0x7F);
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Data bytes after a channel status byte
+static int channel_data_bytes(uint8_t status) {
+    uint8_t type = status & 0xF0;
+    return (type == MIDI_PROGRAM_CHANGE || type == MIDI_CHANNEL_PRESSURE) ? 1 : 2;
+}
+
+static bool parse_track(smf_song_t* song, const uint8_t* data, const uint8_t* end) {
+    uint64_t tick = 0;
+    uint8_t running_status = 0;
+
+    while (data < end) {
+        uint32_t delta;
+        if (!read_vlq(&data, end, &delta) || data >= end) {
+            return false;
+        }
+        tick += delta;
+
+        uint8_t status = *data;
+        if (status & 0x80) {
+            data++;
+        } else if (running_status) {
+            status = running_status;    // Running status - data starts here
+        } else {
+            return false;
+        }
+
+        smf_event_t event = { .tick = tick };
+
+        if (status == 0xFF) {
+            // Meta event: type, length, data
+            running_status = 0;
+            if (data >= end) return false;
+            uint8_t type = *data++;
+            uint32_t length;
+            if (!read_vlq(&data, end, &length) || length > (uint32_t)(end - data)) {
+                return false;
+            }
+            if (type == 0x51 && length == 3) {
+                event.kind = SMF_EVENT_TEMPO;
+                event.tempo = read_be(data, 3);
+                if (event.tempo > 0 && !add_event(song, &event)) {
+                    return false;
+                }
+            } else if (type == 0x2F) {
+                return true; // End of track
+            }
+            data += length;
+        } else if (status == 0xF0 || status == 0xF7) {
+            // SysEx (or an escape) - skipped
+            running_status = 0;
+            uint32_t length;
+            if (!read_vlq(&data, end, &length) || length > (uint32_t)(end - data)) {
+                return false;
+            }
+            data += length;
+            song->skipped++;
+        } else if (status >= 0xF0) {
+            return false; // No other system messages belong in a file
+        } else {
+            running_status = status;
+            int bytes = channel_data_bytes(status);
+            if (end - data < bytes) {
+                return false;
+            }
+            event.kind = SMF_EVENT_CHANNEL;
+            event.status = status;
+            event.data1 = data[0] & 0x7F;
+            event.data2 = bytes == 2 ? data[1] & 0x7F : 0;
+            data += bytes;
+
+            uint8_t type = status & 0xF0;
+            if (type == MIDI_POLYPHONIC_PRESSURE) {
+                song->skipped++;
+            } else if (!add_event(song, &event)) {
+                return false;
+            }
+        }
+    }
+    return true; // Missing end of track - tolerated
+}
+
+static int compare_events(const void* a, const void* b) {
+    const smf_event_t* x = (const smf_event_t*)a;
+    const smf_event_t* y = (const smf_event_t*)b;
+    if (x->tick != y->tick) return x->tick < y->tick ? -1 : 1;
+    return x->sequence < y->sequence ? -1 : (x->sequence > y->sequence);
+}
+
+// Sample position of every event. Tempo changes are honoured from any
+// track, as type 1 files normally keep them in the first
+static void apply_tempo_map(smf_song_t* song, int sample_rate) {
+    double seconds_per_tick;
+    bool smpte = song->division < 0;
+    if (smpte) {
+        int fps = -(int8_t)(song->division >> 8);
+        double frames = fps == 29 ? 30000.0 / 1001.0 : (double)fps;
+        seconds_per_tick = 1.0 / (frames * (song->division & 0xFF));
+    } else {
+        seconds_per_tick = MIDI_FILE_TEMPO_DEFAULT / 1e6 / song->division;
+    }
+
+    uint64_t base_tick = 0;
+    double base_seconds = 0.0;
+    for (int i = 0; i < song->count; i++) {
+        smf_event_t* event = &song->events[i];
+        double seconds = base_seconds + (double)(event->tick - base_tick) * seconds_per_tick;
+        event->frame = (int64_t)(seconds * sample_rate + 0.5);
+
+        if (event->kind == SMF_EVENT_TEMPO && !smpte) {
+            base_tick = event->tick;
+            base_seconds = seconds;
+            seconds_per_tick = event->tempo / 1e6 / song->division;
+        }
+    }
+}
+
+static bool load_song(const char* path, smf_song_t* song) {
+    memset(song, 0, sizeof(smf_song_t));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "❌ Cannot open MIDI file '%s'\n", path);
+        return false;
+    }
+    uint8_t* data = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (uint8_t*)malloc((size_t)size + 1);
+    }
+    bool read = data && fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    if (!read) {
+        fprintf(stderr, "❌ Cannot read MIDI file '%s'\n", path);
+        free(data);
+        return false;
+    }
+
+    const uint8_t* end = data + size;
+    const uint8_t* chunk = data;
+    uint32_t header_length = size >= 8 ? read_be(data + 4, 4) : 0;
+    bool ok = size >= 14 && memcmp(data, "MThd", 4) == 0 && header_length >= 6 &&
+              (uint64_t)header_length <= (uint64_t)size - 8;
+    if (ok) {
+        song->format = (int)read_be(data + 8, 2);
+        song->tracks = (int)read_be(data + 10, 2);
+        song->division = (int16_t)read_be(data + 12, 2);
+        ok = song->format <= 1 && song->division != 0 &&
+             (song->division > 0 || (song->division & 0xFF) != 0);
+        if (!ok) {
+            fprintf(stderr, "❌ '%s': only type 0 and 1 MIDI files can be rendered\n", path);
+        }
+        chunk = data + 8 + header_length;
+    } else {
+        fprintf(stderr, "❌ '%s' is not a Standard MIDI File\n", path);
+    }
+
+    // Tracks are the MTrk chunks; anything else is skipped
+    int track = 0;
+    while (ok && end - chunk >= 8) {
+        uint32_t length = read_be(chunk + 4, 4);
+        const uint8_t* body = chunk + 8;
+        if (length > (uint32_t)(end - body)) {
+            fprintf(stderr, "❌ '%s': chunk runs past the end of the file\n", path);
+            ok = false;
+            break;
+        }
+        if (memcmp(chunk, "MTrk", 4) == 0) {
+            if (!parse_track(song, body, body + length)) {
+                fprintf(stderr, "❌ '%s': track %d is corrupt or truncated\n", path, track + 1);
+                ok = false;
+                break;
+            }
+            track++;
+        }
+        chunk = body + length;
+    }
+    free(data);
+    if (ok && track == 0) {
+        fprintf(stderr, "❌ '%s' has no tracks\n", path);
+        ok = false;
+    }
+
+    if (!ok) {
+        free(song->events);
+        song->events = NULL;
+        return false;
+    }
+    song->tracks = track;
+    qsort(song->events, (size_t)song->count, sizeof(smf_event_t), compare_events);
+    return true;
+}
+
+// Output side of the render: the stream's current chunk, filled in order
+typedef struct {
+    dx7_engine_t* engine;
+    dx7_wav_stream_t stream;
+    float* chunk;
+    int fill;
+    int64_t frames;             // Rendered so far
+    int64_t clipped;
+    bool failed;
+} render_output_t;
+
+// Clamp a finished chunk to full scale (16-bit PCM would wrap) and hand it
+// to the writer
+static void submit_chunk(render_output_t* output) {
+    for (int i = 0; i < output->fill; i++) {
+        float sample = output->chunk[i];
+        if (sample > 1.0f || sample < -1.0f) {
+            output->chunk[i] = sample > 1.0f ? 1.0f : -1.0f;
+            output->clipped++;
+        }
+    }
+    dx7_wav_stream_submit(&output->stream, output->fill);
+    output->chunk = NULL;
+    output->fill = 0;
+}
+
+// Render until frame, in pieces that fit the chunks
+static void render_until(render_output_t* output, int64_t frame) {
+    while (output->frames < frame && !output->failed) {
+        if (!output->chunk) {
+            output->chunk = dx7_wav_stream_chunk(&output->stream);
+            if (!output->chunk) {
+                output->failed = true;
+                return;
+            }
+        }
+        int64_t frames = frame - output->frames;
+        if (frames > DX7_WAV_CHUNK_FRAMES - output->fill) frames = DX7_WAV_CHUNK_FRAMES - output->fill;
+
+        dx7_engine_render(output->engine, output->chunk + output->fill, (int)frames);
+        output->fill += (int)frames;
+        output->frames += frames;
+        if (output->fill == DX7_WAV_CHUNK_FRAMES) {
+            submit_chunk(output);
+        }
+    }
+}
+
+// Render a type 0/1 MIDI file through the polyphonic engine with patch on
+// program 0, on an engine of its own. The config's channel 1-16 plays
+// only that channel, 0 every channel
+int dx7_render_midi_file(const char* midi_path, const dx7_patch_t* patch, const dx7_engine_config_t* config,
+                         const char* output_path) {
+    smf_song_t song;
+    if (!load_song(midi_path, &song)) {
+        return 1;
+    }
+    apply_tempo_map(&song, config->sample_rate);
+
+    render_output_t output = {0};
+    output.engine = dx7_engine_create(config, patch);
+    if (!output.engine) {
+        free(song.events);
+        return 1;
+    }
+    midi_input_set_program(output.engine, 0, patch);
+
+    if (!dx7_wav_stream_open(&output.stream, output_path, config->sample_rate)) {
+        dx7_engine_destroy(output.engine);
+        free(song.events);
+        return 1;
+    }
+
+    // Messages from the engine are printed by the logger thread
+    rt_log_start();
+
+    printf("🎼 Rendering %s: format %d, %d tracks, %d events\n", midi_path, song.format, song.tracks, song.count);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Notes still down per channel and key, released after the last event
+    uint8_t held[16][128] = {{0}};
+    int peak_voices = 0;
+
+    for (int i = 0; i < song.count && !output.failed; i++) {
+        const smf_event_t* event = &song.events[i];
+        render_until(&output, event->frame);
+        if (event->kind != SMF_EVENT_CHANNEL) {
+            continue;
+        }
+
+        uint8_t type = event->status & 0xF0;
+        uint8_t event_channel = event->status & 0x0F;
+        if (type == MIDI_NOTE_ON && event->data2 > 0) {
+            if (held[event_channel][event->data1] < 255) held[event_channel][event->data1]++;
+        } else if (type == MIDI_NOTE_OFF || type == MIDI_NOTE_ON) {
+            if (held[event_channel][event->data1] > 0) held[event_channel][event->data1]--;
+        }
+        midi_handle_message(output.engine, event->status, event->data1, event->data2);
+        if (dx7_engine_voice_count(output.engine) > peak_voices) {
+            peak_voices = dx7_engine_voice_count(output.engine);
+        }
+    }
+
+    // Let go of anything still held, then play out the releases
+    for (int ch = 0; ch < 16; ch++) {
+        midi_handle_message(output.engine, (uint8_t)(MIDI_CONTROL_CHANGE | ch), MIDI_CC_SUSTAIN_PEDAL, 0);
+        for (int note = 0; note < 128; note++) {
+            if (held[ch][note]) {
+                midi_handle_message(output.engine, (uint8_t)(MIDI_NOTE_OFF | ch), (uint8_t)note, 0);
+            }
+        }
+    }
+    int64_t tail_end = output.frames + (int64_t)(MIDI_FILE_TAIL_SECONDS * config->sample_rate);
+    while (dx7_engine_voice_count(output.engine) > 0 && output.frames < tail_end && !output.failed) {
+        int64_t frame = output.frames + MIDI_FILE_TAIL_FRAMES;
+        render_until(&output, frame < tail_end ? frame : tail_end);
+    }
+    if (output.fill > 0 && !output.failed) {
+        submit_chunk(&output);
+    }
+
+    bool written = dx7_wav_stream_close(&output.stream) && !output.failed;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint32_t notes = dx7_engine_notes_played(output.engine);
+    dx7_engine_destroy(output.engine);
+    rt_log_stop();
+    free(song.events);
+    if (!written) {
+        return 1;
+    }
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    double audio_seconds = (double)output.frames / config->sample_rate;
+    printf("✅ Rendered %.1f s of audio to %s in %.3f s - %.1fx realtime (%u notes, up to %d voices)\n",
+           audio_seconds, output_path, seconds, seconds > 0.0 ? audio_seconds / seconds : 0.0,
+           notes, peak_voices);
+    if (output.clipped > 0) {
+        printf("⚠️ %lld samples clipped - lower the velocity or CC 7 volume in the file\n",
+               (long long)output.clipped);
+    }
+    if (song.skipped > 0) {
+        printf("⚠️ %d SysEx/aftertouch events skipped\n", song.skipped);
+    }
+    return 0;
+}
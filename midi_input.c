@@ -1,19 +1,116 @@
 #include "midi_input.h"
 #include "MacAudioOutput.h"
+#include "rt_log.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <time.h>
 #include <unistd.h>
 
-// Global MIDI system instance
-midi_input_system_t g_midi_system = {0};
+// What print_midi_stats() and print_active_voices() show, copied by the
+// audio thread between blocks so the control thread never walks live lists
+typedef struct {
+    int16_t index;
+    uint8_t midi_note;
+    uint8_t velocity;
+    uint8_t channel;
+    bool sustain_held;
+} voice_status_t;
 
-// External sample rate from main
-extern int g_sample_rate;
+typedef struct {
+    int voice_count;
+    uint32_t notes_played;
+    uint32_t voice_steals;
+    midi_controllers_t controllers;
+    voice_status_t* voices;  // voice_count entries, oldest note-on first
+} engine_status_t;
+
+#define STATUS_TIMEOUT_MS 250    // Longest wait for the audio thread's copy
+
+// Engine instance - nothing outside this file touches the fields
+struct dx7_engine {
+    dx7_engine_config_t config;
+    dx7_sine_fn_t sine_fn;   // Voices' sine kernel, from config.sine_kernel
+    bool active;
+    bool play_mode;
+    
+    // MIDI thread -> audio thread. Voices and controllers are only touched
+    // by the audio thread, which applies each event at its frame offset
+    midi_queue_t event_queue;
+    uint64_t block_time;     // Arrival-clock time the last audio block started
+    
+    // Patches - the control thread publishes, the audio thread picks them
+    // up at the start of each block. Neither side ever waits on the other
+    _Atomic(midi_patch_t*) pending_patch;
+    _Atomic(midi_patch_t*) programs[MIDI_PROGRAM_COUNT];
+    atomic_uint_least64_t patch_epoch;   // Bumped as patches are retired
+    atomic_uint_least64_t audio_epoch;   // Epoch the audio thread last saw
+    midi_patch_t* patch_list;            // Control thread: every allocation
+    pthread_mutex_t patch_lock;          // Serialises publishing and reclamation
+    uint32_t next_patch_id;
+    
+    // Audio thread's view of the patches
+    midi_patch_t* patch;                 // Patch new notes start with
+    uint32_t pending_id;                 // Id of pending_patch when last checked
+    midi_patch_t* patches_in_use;        // Held by voices or current
+    
+    // A patch's LFO for one sub-block, read by every voice of the patch
+    double lfo_values[MIDI_RENDER_MAX_FRAMES + 1];
+    
+    // Voice management - voices[] points into one cache-aligned allocation
+    poly_voice_t* voices;
+    int max_voices;
+    int voice_count;
+    int16_t free_head;                  // Free voices, singly linked
+    int16_t lru_head;                   // Active voices, oldest note-on first -
+    int16_t lru_tail;                   // the head is the one to steal
+    int16_t note_voice[16][128];        // Voice playing [channel][note], -1 if none
+    
+    // SIMD render path - lane i mirrors voices[i]
+    voice_bank_t voice_bank;
+    bool use_voice_bank;
+    
+    // Worker threads: each renders a share of the voices into its own
+    // MIDI_RENDER_MAX_FRAMES slice of worker_mix, summed by the audio thread
+    render_pool_t render_pool;
+    float* worker_mix;
+    int16_t* active_voices;  // Scalar path snapshot of the active list
+    render_job_t render_job;
+    
+    // MIDI state
+    midi_parser_state_t parser;
+    midi_controllers_t controllers;
+    double smoothed_gain;    // Volume x expression reached by the last audio block
+    bool pitch_bend_dirty;   // Bend changed - recompute each patch's ratio next block
+    uint8_t current_channel; // 0-15 (MIDI channels 1-16)
+    bool omni;               // Every channel (config channel 0)
+    bool offline;            // No MIDI or audio devices - rendering to a file
+    
+    // Audio output handle
+    void* audio_output_handle;
+    
+    // Statistics
+    uint32_t notes_played;
+    uint32_t voice_steals;
+    atomic_uint midi_errors;    // MIDI thread
+    
+    // Status requested by the control thread, served by the audio thread
+    engine_status_t status;
+    atomic_uint status_requested;
+    atomic_uint status_served;
+};
 
 // MIDI input callback for threading
 static void midi_input_callback(const uint8_t *data, size_t length, uint64_t timestamp, void *context);
+static void release_voice_envelopes(dx7_engine_t* engine, poly_voice_t* voice);
+static void render_voices(dx7_engine_t* engine, float* output_buffer, int frame_count);
+static void reset_voice_lists(dx7_engine_t* engine);
+static void unindex_voice(dx7_engine_t* engine, int index);
+static void free_voice(dx7_engine_t* engine, int index);
+static void sync_patches(dx7_engine_t* engine);
+static void patch_release(dx7_engine_t* engine, midi_patch_t* patch);
+static void free_patches(dx7_engine_t* engine);
+static void capture_status(dx7_engine_t* engine);
 
 // Get current time in microseconds
 static uint64_t get_time_microseconds(void) {
@@ -22,115 +119,485 @@ static uint64_t get_time_microseconds(void) {
     return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-// Initialize MIDI input system
-bool midi_input_initialize(const dx7_patch_t* patch, int input_device, int channel) {
-    if (g_midi_system.active) {
-        printf("MIDI input system already active\n");
+// Default configuration: 48 kHz, DEFAULT_POLYPHONY voices rendered on the
+// calling thread, the build-time control rate and sine kernel, best voice
+// bank kernel, MIDI channel 1
+void dx7_engine_default_config(dx7_engine_config_t* config) {
+    config->sample_rate = DX7_DEFAULT_SAMPLE_RATE;
+    config->control_rate = DX7_CONTROL_RATE;
+    config->sine_kernel = DX7_SINE_KERNEL;
+    config->polyphony = DEFAULT_POLYPHONY;
+    config->render_threads = 1;
+    config->use_voice_bank = true;
+    config->voice_bank_isa = VOICE_BANK_ISA_AUTO;
+    config->channel = 1;
+}
+
+// Size of the voice pool
+bool dx7_engine_config_set_polyphony(dx7_engine_config_t* config, int voices) {
+    if (voices < 1 || voices > MAX_POLYPHONY) {
         return false;
     }
-    
-    // Initialize mutex
-    if (pthread_mutex_init(&g_midi_system.voice_mutex, NULL) != 0) {
-        printf("❌ Failed to initialize voice mutex\n");
+    config->polyphony = voices;
+    return true;
+}
+
+// Envelope/LFO update interval: a power of two from 1 to DX7_BLOCK_SIZE
+bool dx7_engine_config_set_control_rate(dx7_engine_config_t* config, int samples) {
+    if (!dx7_control_rate_valid(samples)) {
         return false;
     }
-    
-    // Initialize MIDI platform
-    if (!midi_platform_initialize()) {
-        printf("❌ Failed to initialize MIDI platform\n");
-        pthread_mutex_destroy(&g_midi_system.voice_mutex);
+    config->control_rate = samples;
+    return true;
+}
+
+// Threads sharing the voice rendering, including the audio thread
+bool dx7_engine_config_set_render_threads(dx7_engine_config_t* config, int threads) {
+    if (threads == 0) {
+        threads = render_pool_cpu_count();
+    }
+    if (threads < 1 || threads > RENDER_POOL_MAX_THREADS + 1) {
         return false;
     }
+    config->render_threads = threads;
+    return true;
+}
+
+// Voice engine shared by play mode and offline rendering: voice pool,
+// patch, controllers, voice bank and render workers
+static dx7_engine_t* engine_create(const dx7_engine_config_t* config, const dx7_patch_t* patch) {
+    if (config->sample_rate <= 0 || config->polyphony < 1 || config->polyphony > MAX_POLYPHONY ||
+        !dx7_control_rate_valid(config->control_rate) || !dx7_sine_kernel_fn(config->sine_kernel) ||
+        config->channel < 0 || config->channel > 16) {
+        printf("❌ Invalid engine configuration\n");
+        return NULL;
+    }
+    
+    // Cache-line aligned like the voices, for the atomics the threads share
+    dx7_engine_t* engine = NULL;
+    if (posix_memalign((void**)&engine, 64, sizeof(dx7_engine_t)) != 0) {
+        printf("❌ Failed to allocate engine\n");
+        return NULL;
+    }
+    memset(engine, 0, sizeof(dx7_engine_t));
+    engine->config = *config;
+    engine->sine_fn = dx7_sine_kernel_fn(config->sine_kernel);
+    pthread_mutex_init(&engine->patch_lock, NULL);
+    
+    // Event queue from the MIDI thread to the audio thread
+    midi_queue_init(&engine->event_queue);
+    
+    // Voice pool - every voice is allocated up front, nothing on note-on
+    void* pool = NULL;
+    if (posix_memalign(&pool, 64, (size_t)config->polyphony * sizeof(poly_voice_t)) != 0) {
+        printf("❌ Failed to allocate %d voices\n", config->polyphony);
+        pthread_mutex_destroy(&engine->patch_lock);
+        free(engine);
+        return NULL;
+    }
+    memset(pool, 0, (size_t)config->polyphony * sizeof(poly_voice_t));
+    engine->voices = (poly_voice_t*)pool;
+    engine->max_voices = config->polyphony;
     
-    // Copy patch
-    if (patch) {
-        memcpy(&g_midi_system.current_patch, patch, sizeof(dx7_patch_t));
+    engine->status.voices = (voice_status_t*)malloc((size_t)config->polyphony * sizeof(voice_status_t));
+    if (!engine->status.voices) {
+        printf("❌ Failed to allocate %d voices\n", config->polyphony);
+        free(engine->voices);
+        pthread_mutex_destroy(&engine->patch_lock);
+        free(engine);
+        return NULL;
     }
     
+    // Build the patch's note tables and pick it up straight away - the
+    // audio thread isn't running yet
+    dx7_patch_t initial = {0};
+    if (!midi_input_set_patch(engine, patch ? patch : &initial)) {
+        printf("❌ Failed to allocate patch\n");
+        free(engine->status.voices);
+        free(engine->voices);
+        pthread_mutex_destroy(&engine->patch_lock);
+        free(engine);
+        return NULL;
+    }
+    sync_patches(engine);
+    
     // Initialize controllers to default values
-    memset(&g_midi_system.controllers, 0, sizeof(midi_controllers_t));
-    g_midi_system.controllers.volume = 1.0f;       // CC 7 = 127
-    g_midi_system.controllers.expression = 1.0f;   // CC 11 = 127
-    g_midi_system.controllers.controllers[7] = 1.0f;   // Volume
-    g_midi_system.controllers.controllers[11] = 1.0f;  // Expression
+    memset(&engine->controllers, 0, sizeof(midi_controllers_t));
+    engine->controllers.volume = 1.0f;       // CC 7 = 127
+    engine->controllers.expression = 1.0f;   // CC 11 = 127
+    engine->smoothed_gain = 1.0;
+    engine->pitch_bend_dirty = false;
+    engine->controllers.controllers[7] = 1.0f;   // Volume
+    engine->controllers.controllers[11] = 1.0f;  // Expression
+    
+    // Initialize parser and voice lists
+    memset(&engine->parser, 0, sizeof(midi_parser_state_t));
+    reset_voice_lists(engine);
     
-    // Initialize parser
-    memset(&g_midi_system.parser, 0, sizeof(midi_parser_state_t));
+    // Set channel (convert from 1-16 to 0-15, 0 = every channel)
+    engine->omni = config->channel == 0;
+    engine->current_channel = (config->channel - 1) & 0x0F;
     
-    // Set channel (convert from 1-16 to 0-15)
-    g_midi_system.current_channel = (channel - 1) & 0x0F;
+    // Set up the SIMD voice bank (falls back to per-voice rendering)
+    engine->use_voice_bank = false;
+    if (config->use_voice_bank) {
+        engine->use_voice_bank = voice_bank_init(&engine->voice_bank, engine->max_voices,
+                                                 config->voice_bank_isa, config->sample_rate,
+                                                 config->control_rate);
+    }
+    
+    // Render workers, with their mix buffers allocated up front
+    int workers = config->render_threads - 1;
+    if (workers > RENDER_POOL_MAX_THREADS) workers = RENDER_POOL_MAX_THREADS;
+    void* mix = NULL;
+    if (posix_memalign(&mix, 64, (size_t)(workers > 0 ? workers : 1) * MIDI_RENDER_MAX_FRAMES * sizeof(float)) != 0) {
+        mix = NULL;
+    }
+    engine->worker_mix = (float*)mix;
+    engine->active_voices = (int16_t*)malloc((size_t)engine->max_voices * sizeof(int16_t));
+    if (!mix || !engine->active_voices) {
+        workers = 0;
+    }
+    render_pool_init(&engine->render_pool, workers);
+    if (engine->render_pool.worker_count > 0) {
+        printf("✅ Voice rendering on %d threads\n", engine->render_pool.worker_count + 1);
+    }
+    return engine;
+}
+
+// Free the engine and everything it holds (nothing may be rendering)
+void dx7_engine_destroy(dx7_engine_t* engine) {
+    if (!engine) {
+        return;
+    }
+    render_pool_free(&engine->render_pool);
+    free(engine->worker_mix);
+    free(engine->active_voices);
+    
+    if (engine->use_voice_bank) {
+        voice_bank_free(&engine->voice_bank);
+    }
+    free(engine->voices);
+    free(engine->status.voices);
+    
+    free_patches(engine);
+    pthread_mutex_destroy(&engine->patch_lock);
+    free(engine);
+}
+
+// Initialize MIDI input system
+dx7_engine_t* midi_input_initialize(const dx7_engine_config_t* config, const dx7_patch_t* patch, int input_device) {
+    dx7_engine_t* engine = engine_create(config, patch);
+    if (!engine) {
+        return NULL;
+    }
+    
+    // Initialize MIDI platform
+    if (!midi_platform_initialize()) {
+        printf("❌ Failed to initialize MIDI platform\n");
+        dx7_engine_destroy(engine);
+        return NULL;
+    }
     
     // Store input device index for potential use
     if (input_device >= 0) {
-        printf("🎹 MIDI input device %d configured for channel %d\n", input_device, channel);
+        printf("🎹 MIDI input device %d configured for channel %d\n", input_device, config->channel);
         // Note: actual device opening is done separately in main.c
     }
     
-    // Initialize audio output
-    g_midi_system.audio_output_handle = audio_output_initialize(g_sample_rate);
-    if (!g_midi_system.audio_output_handle) {
+    // Initialize audio output - its callback renders this engine
+    engine->audio_output_handle = audio_output_initialize(config->sample_rate, engine);
+    if (!engine->audio_output_handle) {
         printf("❌ Failed to initialize audio output\n");
         midi_platform_shutdown();
-        pthread_mutex_destroy(&g_midi_system.voice_mutex);
-        return false;
+        dx7_engine_destroy(engine);
+        return NULL;
     }
     
-    // Set MIDI input callback
+    // Set MIDI input callback - the engine is passed as the input's context
     midi_platform_set_input_callback(midi_input_callback);
     
-    g_midi_system.active = true;
-    printf("✅ MIDI input system initialized (channel %d)\n", channel);
+    engine->active = true;
+    printf("✅ MIDI input system initialized (channel %d, %d voices)\n", config->channel, engine->max_voices);
     
-    return true;
+    return engine;
+}
+
+// Start an engine without MIDI or audio devices, for rendering to a file
+// on the calling thread
+dx7_engine_t* dx7_engine_create(const dx7_engine_config_t* config, const dx7_patch_t* patch) {
+    dx7_engine_t* engine = engine_create(config, patch);
+    if (!engine) {
+        return NULL;
+    }
+    
+    // The engine runs as in play mode; the caller is its audio thread
+    engine->offline = true;
+    engine->active = true;
+    engine->play_mode = true;
+    return engine;
+}
+
+// Render frame_count frames of whatever is sounding (offline only)
+void dx7_engine_render(dx7_engine_t* engine, float* output_buffer, int frame_count) {
+    sync_patches(engine);
+    memset(output_buffer, 0, frame_count * sizeof(float));
+    render_voices(engine, output_buffer, frame_count);
 }
 
-// Shutdown MIDI input system
-void midi_input_shutdown(void) {
-    if (!g_midi_system.active) {
+int dx7_engine_sample_rate(const dx7_engine_t* engine) {
+    return engine->config.sample_rate;
+}
+
+int dx7_engine_voice_count(const dx7_engine_t* engine) {
+    return engine->voice_count;
+}
+
+uint32_t dx7_engine_notes_played(const dx7_engine_t* engine) {
+    return engine->notes_played;
+}
+
+// Shutdown MIDI input system and free the engine
+void midi_input_shutdown(dx7_engine_t* engine) {
+    if (!engine) {
         return;
     }
     
     // Stop play mode if active
-    if (g_midi_system.play_mode) {
-        midi_input_stop_play_mode();
+    if (engine->play_mode) {
+        midi_input_stop_play_mode(engine);
     }
     
-    // Release all voices
-    pthread_mutex_lock(&g_midi_system.voice_mutex);
-    release_all_voices();
-    pthread_mutex_unlock(&g_midi_system.voice_mutex);
+    // Release all voices (audio is stopped, so nothing else touches them)
+    release_all_voices(engine);
     
     // Shutdown audio output
-    if (g_midi_system.audio_output_handle) {
-        audio_output_shutdown(g_midi_system.audio_output_handle);
-        g_midi_system.audio_output_handle = NULL;
+    if (engine->audio_output_handle) {
+        audio_output_shutdown(engine->audio_output_handle);
+        engine->audio_output_handle = NULL;
     }
     
     // Shutdown MIDI platform
     midi_platform_shutdown();
     
-    // Cleanup mutex
-    pthread_mutex_destroy(&g_midi_system.voice_mutex);
-    
-    // Clear system state
-    memset(&g_midi_system, 0, sizeof(midi_input_system_t));
+    // Audio is stopped, so the workers are idle
+    dx7_engine_destroy(engine);
     
     printf("✅ MIDI input system shutdown\n");
 }
 
+// Patch lifetime
+// The control thread compiles a patch into a fresh midi_patch_t and
+// publishes it with one atomic store; the audio thread picks it up at the
+// start of its next block and never waits. A patch that is no longer
+// published is retired at the current epoch. The audio thread records the
+// epoch it saw as each block starts, so once that has passed the retire
+// epoch it can no longer reach the patch through a slot, and once the last
+// voice playing it has finished (refs == 0) it is freed.
+
+// Compile a patch into a new unpublished midi_patch_t (patch_lock held)
+static midi_patch_t* patch_create(dx7_engine_t* engine, const dx7_patch_t* patch) {
+    midi_patch_t* created = (midi_patch_t*)calloc(1, sizeof(midi_patch_t));
+    if (!created) {
+        return NULL;
+    }
+    compile_patch(patch, engine->config.sample_rate, &created->compiled);
+    created->id = ++engine->next_patch_id;
+    atomic_init(&created->refs, 0);
+    created->next = engine->patch_list;
+    engine->patch_list = created;
+    return created;
+}
+
+static bool patch_published(dx7_engine_t* engine, const midi_patch_t* patch) {
+    if (atomic_load_explicit(&engine->pending_patch, memory_order_relaxed) == patch) {
+        return true;
+    }
+    for (int i = 0; i < MIDI_PROGRAM_COUNT; i++) {
+        if (atomic_load_explicit(&engine->programs[i], memory_order_relaxed) == patch) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Retire unpublished patches and free those the audio thread is done with
+// (patch_lock held)
+static void collect_patches_locked(dx7_engine_t* engine) {
+    uint64_t audio_epoch = atomic_load_explicit(&engine->audio_epoch, memory_order_acquire);
+    
+    for (midi_patch_t** link = &engine->patch_list; *link; ) {
+        midi_patch_t* patch = *link;
+        if (patch->retired_epoch == 0) {
+            if (!patch_published(engine, patch)) {
+                patch->retired_epoch = atomic_fetch_add_explicit(&engine->patch_epoch, 1,
+                                                                 memory_order_release) + 1;
+            }
+        } else if (audio_epoch >= patch->retired_epoch &&
+                   atomic_load_explicit(&patch->refs, memory_order_acquire) == 0) {
+            *link = patch->next;
+            free(patch);
+            continue;
+        }
+        link = &patch->next;
+    }
+}
+
+// Patch new notes start with from the next block on
+bool midi_input_set_patch(dx7_engine_t* engine, const dx7_patch_t* patch) {
+    pthread_mutex_lock(&engine->patch_lock);
+    midi_patch_t* created = patch_create(engine, patch);
+    if (created) {
+        atomic_store_explicit(&engine->pending_patch, created, memory_order_release);
+        collect_patches_locked(engine);
+    }
+    pthread_mutex_unlock(&engine->patch_lock);
+    return created != NULL;
+}
+
+// Patch a program change selects
+bool midi_input_set_program(dx7_engine_t* engine, int program, const dx7_patch_t* patch) {
+    if (program < 0 || program >= MIDI_PROGRAM_COUNT) {
+        return false;
+    }
+    
+    pthread_mutex_lock(&engine->patch_lock);
+    midi_patch_t* created = patch ? patch_create(engine, patch) : NULL;
+    if (created || !patch) {
+        atomic_store_explicit(&engine->programs[program], created, memory_order_release);
+        collect_patches_locked(engine);
+    }
+    pthread_mutex_unlock(&engine->patch_lock);
+    return created || !patch;
+}
+
+// Fill a run of program slots, e.g. from a bank dump. Every patch is
+// compiled before the first slot is published, so a program change during
+// the load sees either the old bank or the new one for each slot
+bool midi_input_set_programs(dx7_engine_t* engine, int first, const dx7_patch_t* patches, int count) {
+    if (first < 0 || count < 0 || first + count > MIDI_PROGRAM_COUNT) {
+        return false;
+    }
+    
+    midi_patch_t* created[MIDI_PROGRAM_COUNT];
+    bool ok = true;
+    
+    pthread_mutex_lock(&engine->patch_lock);
+    for (int i = 0; i < count && ok; i++) {
+        created[i] = patch_create(engine, &patches[i]);
+        ok = created[i] != NULL;
+    }
+    if (ok) {
+        for (int i = 0; i < count; i++) {
+            atomic_store_explicit(&engine->programs[first + i], created[i], memory_order_release);
+        }
+    }
+    // Anything created for a failed load is unpublished and goes here too
+    collect_patches_locked(engine);
+    pthread_mutex_unlock(&engine->patch_lock);
+    return ok;
+}
+
+void midi_input_collect_patches(dx7_engine_t* engine) {
+    pthread_mutex_lock(&engine->patch_lock);
+    collect_patches_locked(engine);
+    pthread_mutex_unlock(&engine->patch_lock);
+}
+
+// Free every patch once nothing can hold one any more (shutdown)
+static void free_patches(dx7_engine_t* engine) {
+    pthread_mutex_lock(&engine->patch_lock);
+    for (midi_patch_t* patch = engine->patch_list, *next; patch; patch = next) {
+        next = patch->next;
+        free(patch);
+    }
+    engine->patch_list = NULL;
+    engine->patch = NULL;
+    engine->patches_in_use = NULL;
+    pthread_mutex_unlock(&engine->patch_lock);
+}
+
+// Bend ratio over a patch's range at the current wheel position
+static double patch_bend_ratio(const dx7_engine_t* engine, const midi_patch_t* patch) {
+    return pow(2.0, engine->controllers.pitch_bend * patch->compiled.patch.pitch_bend_range / 12.0);
+}
+
+// Audio thread: take a reference, listing the patch for rendering. A patch
+// coming into use picks up the LFO where the current one is, so new notes
+// carry on from it, then runs its own until its last voice ends
+static void patch_acquire(dx7_engine_t* engine, midi_patch_t* patch) {
+    if (atomic_fetch_add_explicit(&patch->refs, 1, memory_order_relaxed) == 0) {
+        patch->in_use_next = engine->patches_in_use;
+        engine->patches_in_use = patch;
+        if (engine->patch) {
+            patch->lfo = engine->patch->lfo;
+        } else {
+            dx7_lfo_reset(&patch->lfo, 0);
+        }
+        patch->pitch_bend = patch_bend_ratio(engine, patch);
+        patch->smoothed_bend = patch->pitch_bend;
+    }
+}
+
+// Audio thread: drop a reference - the control thread may free the patch
+// as soon as the count reaches zero, so it is unlisted first
+static void patch_release(dx7_engine_t* engine, midi_patch_t* patch) {
+    if (atomic_load_explicit(&patch->refs, memory_order_relaxed) == 1) {
+        for (midi_patch_t** link = &engine->patches_in_use; *link; link = &(*link)->in_use_next) {
+            if (*link == patch) {
+                *link = patch->in_use_next;
+                break;
+            }
+        }
+    }
+    atomic_fetch_sub_explicit(&patch->refs, 1, memory_order_release);
+}
+
+// Audio thread: switch the patch new notes start with
+static void select_patch(dx7_engine_t* engine, midi_patch_t* patch) {
+    if (patch == engine->patch) {
+        return;
+    }
+    patch_acquire(engine, patch);
+    if (engine->patch) {
+        patch_release(engine, engine->patch);
+    }
+    engine->patch = patch;
+}
+
+// Audio thread, once per block: publish the epoch we have reached, then
+// pick up a newly set patch
+static void sync_patches(dx7_engine_t* engine) {
+    uint64_t epoch = atomic_load_explicit(&engine->patch_epoch, memory_order_acquire);
+    atomic_store_explicit(&engine->audio_epoch, epoch, memory_order_release);
+    
+    midi_patch_t* pending = atomic_load_explicit(&engine->pending_patch, memory_order_acquire);
+    if (pending && pending->id != engine->pending_id) {
+        engine->pending_id = pending->id;
+        select_patch(engine, pending);
+    }
+}
+
 // Start play mode
-bool midi_input_start_play_mode(void) {
-    if (!g_midi_system.active || g_midi_system.play_mode) {
+bool midi_input_start_play_mode(dx7_engine_t* engine) {
+    if (!engine->active || engine->play_mode) {
         return false;
     }
     
+    // Messages from the MIDI and audio threads are printed by the logger thread
+    rt_log_start();
+    
+    // Event offsets in the first block are measured from now
+    engine->block_time = get_time_microseconds();
+    
     // Start audio output
-    if (!audio_output_start(g_midi_system.audio_output_handle)) {
+    if (!audio_output_start(engine->audio_output_handle)) {
         printf("❌ Failed to start audio output\n");
+        rt_log_stop();
         return false;
     }
     
-    g_midi_system.play_mode = true;
+    engine->play_mode = true;
     printf("🎹 Play mode started - ready for MIDI input!\n");
     printf("💡 Play some notes on your MIDI controller\n");
     
@@ -138,61 +605,83 @@ bool midi_input_start_play_mode(void) {
 }
 
 // Stop play mode
-void midi_input_stop_play_mode(void) {
-    if (!g_midi_system.play_mode) {
+void midi_input_stop_play_mode(dx7_engine_t* engine) {
+    if (!engine->play_mode) {
         return;
     }
     
-    g_midi_system.play_mode = false;
+    engine->play_mode = false;
     
     // Stop audio output
-    if (g_midi_system.audio_output_handle) {
-        audio_output_stop(g_midi_system.audio_output_handle);
+    if (engine->audio_output_handle) {
+        audio_output_stop(engine->audio_output_handle);
     }
     
-    // Release all voices
-    pthread_mutex_lock(&g_midi_system.voice_mutex);
-    release_all_voices();
-    pthread_mutex_unlock(&g_midi_system.voice_mutex);
+    // The audio thread has stopped: discard undelivered events and voices
+    midi_event_t event;
+    while (midi_queue_pop(&engine->event_queue, &event)) {
+    }
+    release_all_voices(engine);
+    
+    // Print whatever is still queued before our own output
+    rt_log_stop();
     
     printf("🎹 Play mode stopped\n");
 }
 
 // MIDI input callback (called from MIDI thread)
 static void midi_input_callback(const uint8_t *data, size_t length, uint64_t timestamp, void *context) {
-    (void)timestamp;
-    (void)context;
+    (void)timestamp; // Platform host time - stamped below on the same clock as the audio blocks
+    dx7_engine_t* engine = (dx7_engine_t*)context;
     
-    if (!g_midi_system.active || !g_midi_system.play_mode) {
+    if (!engine->active || !engine->play_mode) {
         return;
     }
     
+    // Messages completed by this packet are stamped with its arrival time
+    engine->parser.timestamp = get_time_microseconds();
+    
     // Parse each byte
     for (size_t i = 0; i < length; i++) {
-        midi_parse_byte(data[i]);
+        midi_parse_byte(engine, data[i]);
     }
 }
 
 // Parse MIDI byte with running status support
-void midi_parse_byte(uint8_t byte) {
-    midi_parser_state_t* parser = &g_midi_system.parser;
+void midi_parse_byte(dx7_engine_t* engine, uint8_t byte) {
+    midi_parser_state_t* parser = &engine->parser;
     
     if (byte & 0x80) {
         // Status byte
         if (byte == 0xF0) {
-            // Start of SysEx
+            // Start of SysEx - streamed into the receiver as it arrives
+            if (parser->in_sysex) {
+                atomic_fetch_add_explicit(&engine->midi_errors, 1, memory_order_relaxed); // Previous one never ended
+            }
             parser->in_sysex = true;
-            parser->sysex_length = 0;
+            parser->running_status = 0;
+            dx7_sysex_receiver_start(&parser->sysex);
             return;
         } else if (byte == 0xF7) {
             // End of SysEx
-            parser->in_sysex = false;
+            if (parser->in_sysex) {
+                parser->in_sysex = false;
+                midi_handle_sysex(engine, dx7_sysex_receiver_end(&parser->sysex));
+            }
             return;
         } else if (byte >= 0xF8) {
-            // Real-time messages - ignore for now
+            // Real-time messages - ignore for now (may arrive mid-SysEx)
             return;
         }
         
+        if (parser->in_sysex) {
+            // Any other status byte cuts the SysEx short
+            parser->in_sysex = false;
+            dx7_sysex_receiver_end(&parser->sysex);
+            atomic_fetch_add_explicit(&engine->midi_errors, 1, memory_order_relaxed);
+            rt_log(RT_LOG_WARN, "⚠️ SysEx: interrupted by status 0x%02X\n", byte);
+        }
+        
         // Regular status byte
         parser->running_status = byte;
         parser->data_bytes_received = 0;
@@ -211,16 +700,13 @@ void midi_parse_byte(uint8_t byte) {
     } else {
         // Data byte
         if (parser->in_sysex) {
-            // Store SysEx data
-            if (parser->sysex_length < sizeof(parser->sysex_buffer)) {
-                parser->sysex_buffer[parser->sysex_length++] = byte;
-            }
+            dx7_sysex_receiver_byte(&parser->sysex, byte);
             return;
         }
         
         if (parser->running_status == 0) {
             // No running status - ignore orphaned data byte
-            g_midi_system.midi_errors++;
+            atomic_fetch_add_explicit(&engine->midi_errors, 1, memory_order_relaxed);
             return;
         }
         
@@ -233,7 +719,7 @@ void midi_parse_byte(uint8_t byte) {
             uint8_t data1 = parser->data_bytes_needed > 0 ? parser->data_buffer[0] : 0;
             uint8_t data2 = parser->data_bytes_needed > 1 ? parser->data_buffer[1] : 0;
             
-            midi_handle_message(parser->running_status, data1, data2);
+            midi_queue_message(engine, parser->running_status, data1, data2);
             
             // Reset for next message (keep running status)
             parser->data_bytes_received = 0;
@@ -241,43 +727,99 @@ void midi_parse_byte(uint8_t byte) {
     }
 }
 
-// Handle complete MIDI message
-void midi_handle_message(uint8_t status, uint8_t data1, uint8_t data2) {
+// A SysEx message has ended (MIDI thread). Voice dumps are unpacked and
+// compiled here, never on the audio thread, which picks them up through
+// the atomic patch slots: a single voice becomes the current patch, a
+// 32-voice bank fills programs 0-31
+void midi_handle_sysex(dx7_engine_t* engine, dx7_sysex_result_t result) {
+    midi_parser_state_t* parser = &engine->parser;
+    
+    switch (result) {
+        case DX7_SYSEX_VOICE:
+            dx7_vced_to_patch(dx7_sysex_receiver_voice(&parser->sysex, 0), &parser->sysex_bank[0]);
+            if (midi_input_set_patch(engine, &parser->sysex_bank[0])) {
+                rt_log(RT_LOG_INFO, "📥 SysEx: voice received\n");
+            }
+            break;
+            
+        case DX7_SYSEX_BANK:
+            for (int i = 0; i < DX7_VMEM_VOICES; i++) {
+                dx7_vmem_to_patch(dx7_sysex_receiver_voice(&parser->sysex, i), &parser->sysex_bank[i]);
+            }
+            if (midi_input_set_programs(engine, 0, parser->sysex_bank, DX7_VMEM_VOICES)) {
+                rt_log(RT_LOG_INFO, "📥 SysEx: %d-voice bank received (programs 0-%d)\n",
+                       DX7_VMEM_VOICES, DX7_VMEM_VOICES - 1);
+            }
+            break;
+            
+        case DX7_SYSEX_BAD_CHECKSUM:
+            atomic_fetch_add_explicit(&engine->midi_errors, 1, memory_order_relaxed);
+            rt_log(RT_LOG_WARN, "⚠️ SysEx: voice dump checksum mismatch - ignored\n");
+            break;
+            
+        case DX7_SYSEX_BAD_LENGTH:
+            atomic_fetch_add_explicit(&engine->midi_errors, 1, memory_order_relaxed);
+            rt_log(RT_LOG_WARN, "⚠️ SysEx: voice dump has the wrong length - ignored\n");
+            break;
+            
+        case DX7_SYSEX_IGNORED:
+            break;
+    }
+}
+
+// Pass a complete message to the audio thread (MIDI thread)
+void midi_queue_message(dx7_engine_t* engine, uint8_t status, uint8_t data1, uint8_t data2) {
+    // Only respond to our channel (or omni mode)
+    if (!engine->omni && (status & 0x0F) != engine->current_channel) {
+        return;
+    }
+    
+    midi_event_t event = {
+        .timestamp = engine->parser.timestamp,
+        .status = status,
+        .data1 = data1,
+        .data2 = data2
+    };
+    midi_queue_push(&engine->event_queue, &event);
+}
+
+// Handle complete MIDI message (audio thread)
+void midi_handle_message(dx7_engine_t* engine, uint8_t status, uint8_t data1, uint8_t data2) {
     uint8_t msg_type = status & 0xF0;
     uint8_t channel = status & 0x0F;
     
     // Only respond to our channel (or omni mode)
-    if (channel != g_midi_system.current_channel) {
+    if (!engine->omni && channel != engine->current_channel) {
         return;
     }
     
     switch (msg_type) {
         case MIDI_NOTE_ON:
             if (data2 > 0) {
-                handle_note_on(channel, data1, data2);
+                handle_note_on(engine, channel, data1, data2);
             } else {
-                handle_note_off(channel, data1, data2);
+                handle_note_off(engine, channel, data1, data2);
             }
             break;
             
         case MIDI_NOTE_OFF:
-            handle_note_off(channel, data1, data2);
+            handle_note_off(engine, channel, data1, data2);
             break;
             
         case MIDI_CONTROL_CHANGE:
-            handle_control_change(channel, data1, data2);
+            handle_control_change(engine, channel, data1, data2);
             break;
             
         case MIDI_PITCH_BEND:
-            handle_pitch_bend(channel, (uint16_t)data1 | ((uint16_t)data2 << 7));
+            handle_pitch_bend(engine, channel, (uint16_t)data1 | ((uint16_t)data2 << 7));
             break;
             
         case MIDI_PROGRAM_CHANGE:
-            handle_program_change(channel, data1);
+            handle_program_change(engine, channel, data1);
             break;
             
         case MIDI_CHANNEL_PRESSURE:
-            handle_channel_pressure(channel, data1);
+            handle_channel_pressure(engine, channel, data1);
             break;
             
         default:
@@ -287,194 +829,258 @@ void midi_handle_message(uint8_t status, uint8_t data1, uint8_t data2) {
 }
 
 // Handle note on
-void handle_note_on(uint8_t channel, uint8_t note, uint8_t velocity) {
+void handle_note_on(dx7_engine_t* engine, uint8_t channel, uint8_t note, uint8_t velocity) {
     if (note > 127 || velocity == 0) {
         return;
     }
     
-    pthread_mutex_lock(&g_midi_system.voice_mutex);
+    // A key can only own one voice - release the previous one rather than
+    // leave it ringing without a note-off
+    poly_voice_t* previous = find_voice(engine, note, channel);
+    if (previous) {
+        if (engine->controllers.sustain_pedal) {
+            previous->sustain_held = true;
+        } else {
+            release_voice_envelopes(engine, previous);
+        }
+    }
     
-    int voice_index = allocate_voice(note, velocity, channel);
+    int voice_index = allocate_voice(engine, note, velocity, channel);
     if (voice_index >= 0) {
-        g_midi_system.notes_played++;
-        printf("🎵 Note ON: %d vel:%d (voice %d)\n", note, velocity, voice_index);
+        engine->notes_played++;
+        rt_log(RT_LOG_INFO, "🎵 Note ON: %d vel:%d (voice %d)\n", note, velocity, voice_index);
     }
-    
-    pthread_mutex_unlock(&g_midi_system.voice_mutex);
 }
 
 // Handle note off
-void handle_note_off(uint8_t channel, uint8_t note, uint8_t velocity) {
+void handle_note_off(dx7_engine_t* engine, uint8_t channel, uint8_t note, uint8_t velocity) {
     (void)velocity; // Velocity ignored for note off
     
-    pthread_mutex_lock(&g_midi_system.voice_mutex);
-    
-    poly_voice_t* voice = find_voice(note, channel);
+    poly_voice_t* voice = find_voice(engine, note, channel);
     if (voice) {
-        if (g_midi_system.controllers.sustain_pedal) {
+        if (engine->controllers.sustain_pedal) {
             // Mark for sustain release
             voice->sustain_held = true;
         } else {
             // Release immediately
-            for (int i = 0; i < MAX_OPERATORS; i++) {
-                trigger_release(&voice->synth_voice.operators[i].env, 
-                              &g_midi_system.current_patch.operators[i],
-                              voice->synth_voice.operators[i].rate_scale);
-            }
+            release_voice_envelopes(engine, voice);
         }
-        printf("🎵 Note OFF: %d\n", note);
+        
+        // The key is up - a later note-off for it must not find this voice
+        unindex_voice(engine, (int)(voice - engine->voices));
+        rt_log(RT_LOG_INFO, "🎵 Note OFF: %d\n", note);
     }
-    
-    pthread_mutex_unlock(&g_midi_system.voice_mutex);
 }
 
 // Handle control change
-void handle_control_change(uint8_t channel, uint8_t controller, uint8_t value) {
+void handle_control_change(dx7_engine_t* engine, uint8_t channel, uint8_t controller, uint8_t value) {
     (void)channel;
     
     // Store raw value
     if (controller < 128) {
-        g_midi_system.controllers.controllers[controller] = midi_to_float(value);
+        engine->controllers.controllers[controller] = midi_to_float(value);
     }
     
     // Handle specific controllers
     switch (controller) {
         case MIDI_CC_MODWHEEL:
-            g_midi_system.controllers.mod_wheel = midi_to_float(value);
-            printf("🎛️ Mod Wheel: %.2f\n", g_midi_system.controllers.mod_wheel);
+            engine->controllers.mod_wheel = midi_to_float(value);
+            rt_log(RT_LOG_INFO, "🎛️ Mod Wheel: %.2f\n", engine->controllers.mod_wheel);
             break;
             
         case MIDI_CC_BREATH:
-            g_midi_system.controllers.breath = midi_to_float(value);
+            engine->controllers.breath = midi_to_float(value);
             break;
             
         case MIDI_CC_FOOT:
-            g_midi_system.controllers.foot = midi_to_float(value);
+            engine->controllers.foot = midi_to_float(value);
             break;
             
         case MIDI_CC_VOLUME:
-            g_midi_system.controllers.volume = midi_to_float(value);
-            printf("🔊 Volume: %.2f\n", g_midi_system.controllers.volume);
+            engine->controllers.volume = midi_to_float(value);
+            rt_log(RT_LOG_INFO, "🔊 Volume: %.2f\n", engine->controllers.volume);
             break;
             
         case MIDI_CC_EXPRESSION:
-            g_midi_system.controllers.expression = midi_to_float(value);
+            engine->controllers.expression = midi_to_float(value);
             break;
             
         case MIDI_CC_PAN:
-            g_midi_system.controllers.pan = midi_to_bipolar(value);
+            engine->controllers.pan = midi_to_bipolar(value);
             break;
             
         case MIDI_CC_SUSTAIN_PEDAL:
-            g_midi_system.controllers.sustain_pedal = (value >= 64);
-            printf("🦶 Sustain: %s\n", g_midi_system.controllers.sustain_pedal ? "ON" : "OFF");
+            engine->controllers.sustain_pedal = (value >= 64);
+            rt_log(RT_LOG_INFO, "🦶 Sustain: %s\n", engine->controllers.sustain_pedal ? "ON" : "OFF");
             
             // If sustain released, release all sustained notes
-            if (!g_midi_system.controllers.sustain_pedal) {
-                pthread_mutex_lock(&g_midi_system.voice_mutex);
-                for (int i = 0; i < MAX_VOICES; i++) {
-                    poly_voice_t* voice = &g_midi_system.voices[i];
-                    if (voice->active && voice->sustain_held) {
+            if (!engine->controllers.sustain_pedal) {
+                for (int i = engine->lru_head; i >= 0; i = engine->voices[i].next) {
+                    poly_voice_t* voice = &engine->voices[i];
+                    if (voice->sustain_held) {
                         voice->sustain_held = false;
-                        for (int op = 0; op < MAX_OPERATORS; op++) {
-                            trigger_release(&voice->synth_voice.operators[op].env,
-                                          &g_midi_system.current_patch.operators[op],
-                                          voice->synth_voice.operators[op].rate_scale);
-                        }
+                        release_voice_envelopes(engine, voice);
                     }
                 }
-                pthread_mutex_unlock(&g_midi_system.voice_mutex);
             }
             break;
             
         case MIDI_CC_PORTAMENTO:
-            g_midi_system.controllers.portamento = (value >= 64);
+            engine->controllers.portamento = (value >= 64);
             break;
             
         case MIDI_CC_ALL_SOUND_OFF:
         case MIDI_CC_ALL_NOTES_OFF:
-            pthread_mutex_lock(&g_midi_system.voice_mutex);
-            release_all_voices();
-            pthread_mutex_unlock(&g_midi_system.voice_mutex);
-            printf("🔇 All notes off\n");
+            release_all_voices(engine);
+            rt_log(RT_LOG_INFO, "🔇 All notes off\n");
             break;
             
         case MIDI_CC_ALL_CONTROLLERS_OFF:
             // Reset all controllers except volume and expression
-            memset(&g_midi_system.controllers, 0, sizeof(midi_controllers_t));
-            g_midi_system.controllers.volume = 1.0f;
-            g_midi_system.controllers.expression = 1.0f;
+            memset(&engine->controllers, 0, sizeof(midi_controllers_t));
+            engine->controllers.volume = 1.0f;
+            engine->controllers.expression = 1.0f;
+            engine->pitch_bend_dirty = true;
             break;
             
         default:
             // Placeholder for other controllers
-            printf("🎛️ CC %d: %d\n", controller, value);
+            rt_log(RT_LOG_INFO, "🎛️ CC %d: %d\n", controller, value);
             break;
     }
 }
 
 // Handle pitch bend
-void handle_pitch_bend(uint8_t channel, uint16_t bend_value) {
+void handle_pitch_bend(dx7_engine_t* engine, uint8_t channel, uint16_t bend_value) {
     (void)channel;
     
     // Convert 14-bit pitch bend to -1.0 to +1.0
     float bend = ((float)bend_value - 8192.0f) / 8192.0f;
-    g_midi_system.controllers.pitch_bend = bend;
+    engine->controllers.pitch_bend = bend;
+    
+    // Ratio is worked out once, at the next block - see render_voices()
+    engine->pitch_bend_dirty = true;
     
-    printf("🎵 Pitch Bend: %.3f\n", bend);
+    rt_log(RT_LOG_DEBUG, "🎵 Pitch Bend: %.3f\n", bend);
 }
 
 // Handle program change
-void handle_program_change(uint8_t channel, uint8_t program) {
+void handle_program_change(dx7_engine_t* engine, uint8_t channel, uint8_t program) {
     (void)channel;
-    printf("🎛️ Program Change: %d\n", program);
-    // TODO: Load different patch based on program number
+    midi_patch_t* patch = atomic_load_explicit(&engine->programs[program & 0x7F], memory_order_acquire);
+    if (!patch) {
+        rt_log(RT_LOG_WARN, "⚠️ Program Change: %d is empty\n", program);
+        return;
+    }
+    select_patch(engine, patch);
+    rt_log(RT_LOG_INFO, "🎛️ Program Change: %d\n", program);
 }
 
 // Handle channel pressure
-void handle_channel_pressure(uint8_t channel, uint8_t pressure) {
+void handle_channel_pressure(dx7_engine_t* engine, uint8_t channel, uint8_t pressure) {
+    (void)engine;
     (void)channel;
-    printf("🎵 Channel Pressure: %d\n", pressure);
+    rt_log(RT_LOG_DEBUG, "🎵 Channel Pressure: %d\n", pressure);
     // TODO: Apply pressure to all active voices
 }
 
-// Allocate voice for new note
-int allocate_voice(uint8_t midi_note, uint8_t velocity, uint8_t channel) {
-    // First, try to find an inactive voice
-    for (int i = 0; i < MAX_VOICES; i++) {
-        if (!g_midi_system.voices[i].active) {
-            poly_voice_t* voice = &g_midi_system.voices[i];
-            
-            // Initialize voice
-            voice->active = true;
-            voice->midi_note = midi_note;
-            voice->velocity = velocity;
-            voice->channel = channel;
-            voice->note_on_time = get_time_microseconds();
-            voice->sustain_held = false;
-            
-            // Initialize synthesis voice
-            init_operators(&voice->synth_voice, &g_midi_system.current_patch, 
-                          midi_note, (double)velocity / 127.0);
-            
-            g_midi_system.voice_count++;
-            return i;
-        }
+// Voice lists
+// Every voice is on exactly one list: the free list or the LRU list of
+// active voices in note-on order. note_voice[][] maps a held key to its
+// voice, so note-on, note-off and stealing never scan the voice array.
+
+static void lru_remove(dx7_engine_t* engine, int index) {
+    poly_voice_t* voice = &engine->voices[index];
+    
+    if (voice->prev >= 0) {
+        engine->voices[voice->prev].next = voice->next;
+    } else {
+        engine->lru_head = voice->next;
+    }
+    if (voice->next >= 0) {
+        engine->voices[voice->next].prev = voice->prev;
+    } else {
+        engine->lru_tail = voice->prev;
+    }
+    voice->prev = voice->next = -1;
+}
+
+static void lru_append(dx7_engine_t* engine, int index) {
+    poly_voice_t* voice = &engine->voices[index];
+    
+    voice->prev = engine->lru_tail;
+    voice->next = -1;
+    if (engine->lru_tail >= 0) {
+        engine->voices[engine->lru_tail].next = (int16_t)index;
+    } else {
+        engine->lru_head = (int16_t)index;
+    }
+    engine->lru_tail = (int16_t)index;
+}
+
+// Drop a voice from the key index if it still owns its key
+static void unindex_voice(dx7_engine_t* engine, int index) {
+    poly_voice_t* voice = &engine->voices[index];
+    int16_t* slot = &engine->note_voice[voice->channel & 0x0F][voice->midi_note & 0x7F];
+    if (*slot == index) {
+        *slot = -1;
+    }
+}
+
+// Every voice free, no keys held
+static void reset_voice_lists(dx7_engine_t* engine) {
+    int count = engine->max_voices;
+    for (int i = 0; i < count; i++) {
+        engine->voices[i].prev = -1;
+        engine->voices[i].next = (int16_t)(i + 1 < count ? i + 1 : -1);
     }
+    engine->free_head = 0;
+    engine->lru_head = -1;
+    engine->lru_tail = -1;
+    memset(engine->note_voice, 0xFF, sizeof(engine->note_voice));
+}
+
+// Return a finished voice to the free list
+static void free_voice(dx7_engine_t* engine, int index) {
+    poly_voice_t* voice = &engine->voices[index];
     
-    // No free voices - steal oldest voice
-    int oldest_voice = 0;
-    uint64_t oldest_time = g_midi_system.voices[0].note_on_time;
+    lru_remove(engine, index);
+    unindex_voice(engine, index);
+    voice->active = false;
+    voice->sustain_held = false;
+    patch_release(engine, voice->patch);
+    voice->patch = NULL;
+    voice->next = engine->free_head;
+    engine->free_head = (int16_t)index;
     
-    for (int i = 1; i < MAX_VOICES; i++) {
-        if (g_midi_system.voices[i].note_on_time < oldest_time) {
-            oldest_time = g_midi_system.voices[i].note_on_time;
-            oldest_voice = i;
-        }
+    if (engine->use_voice_bank) {
+        voice_bank_clear_lane(&engine->voice_bank, index);
+    }
+    engine->voice_count--;
+}
+
+// Allocate voice for new note
+int allocate_voice(dx7_engine_t* engine, uint8_t midi_note, uint8_t velocity, uint8_t channel) {
+    int index = engine->free_head;
+    
+    if (index >= 0) {
+        // Pop a free voice
+        engine->free_head = engine->voices[index].next;
+        engine->voice_count++;
+    } else {
+        // No free voices - steal the oldest note
+        index = engine->lru_head;
+        lru_remove(engine, index);
+        unindex_voice(engine, index);
+        patch_release(engine, engine->voices[index].patch);
+        
+        engine->voice_steals++;
+        rt_log(RT_LOG_DEBUG, "🔄 Voice steal: voice %d\n", index);
     }
     
-    // Steal the oldest voice
-    poly_voice_t* voice = &g_midi_system.voices[oldest_voice];
+    poly_voice_t* voice = &engine->voices[index];
+    
+    // Initialize voice
     voice->active = true;
     voice->midi_note = midi_note;
     voice->velocity = velocity;
@@ -482,128 +1088,344 @@ int allocate_voice(uint8_t midi_note, uint8_t velocity, uint8_t channel) {
     voice->note_on_time = get_time_microseconds();
     voice->sustain_held = false;
     
-    // Re-initialize synthesis voice
-    init_operators(&voice->synth_voice, &g_midi_system.current_patch,
-                  midi_note, (double)velocity / 127.0);
+    // The voice plays this patch to the end, whatever is selected later
+    voice->patch = engine->patch;
+    patch_acquire(engine, voice->patch);
     
-    g_midi_system.voice_steals++;
-    printf("🔄 Voice steal: voice %d\n", oldest_voice);
+    // Initialize synthesis voice
+    init_operators_compiled(&voice->synth_voice, &voice->patch->compiled,
+                            midi_note, (double)velocity / 127.0, engine->config.control_rate, engine->sine_fn);
+    if (engine->use_voice_bank) {
+        voice_bank_load_voice(&engine->voice_bank, index, &voice->synth_voice,
+                              &voice->patch->compiled.patch, voice->patch->id);
+    }
     
-    return oldest_voice;
+    lru_append(engine, index);
+    engine->note_voice[channel & 0x0F][midi_note & 0x7F] = (int16_t)index;
+    
+    return index;
+}
+
+// Find the voice holding a key
+poly_voice_t* find_voice(dx7_engine_t* engine, uint8_t midi_note, uint8_t channel) {
+    int index = engine->note_voice[channel & 0x0F][midi_note & 0x7F];
+    return index >= 0 ? &engine->voices[index] : NULL;
 }
 
-// Find voice by note and channel
-poly_voice_t* find_voice(uint8_t midi_note, uint8_t channel) {
-    for (int i = 0; i < MAX_VOICES; i++) {
-        poly_voice_t* voice = &g_midi_system.voices[i];
-        if (voice->active && voice->midi_note == midi_note && voice->channel == channel) {
-            return voice;
+// Release all voices
+void release_all_voices(dx7_engine_t* engine) {
+    for (int i = 0; i < engine->max_voices; i++) {
+        engine->voices[i].active = false;
+        engine->voices[i].sustain_held = false;
+        if (engine->voices[i].patch) {
+            patch_release(engine, engine->voices[i].patch);
+            engine->voices[i].patch = NULL;
+        }
+        if (engine->use_voice_bank) {
+            voice_bank_clear_lane(&engine->voice_bank, i);
         }
     }
-    return NULL;
+    reset_voice_lists(engine);
+    engine->voice_count = 0;
 }
 
-// Release all voices
-void release_all_voices(void) {
-    for (int i = 0; i < MAX_VOICES; i++) {
-        g_midi_system.voices[i].active = false;
-        g_midi_system.voices[i].sustain_held = false;
+// Put every operator of a voice into its release stage
+static void release_voice_envelopes(dx7_engine_t* engine, poly_voice_t* voice) {
+    const dx7_patch_t* patch = &voice->patch->compiled.patch;
+    if (engine->use_voice_bank) {
+        voice_bank_release(&engine->voice_bank, (int)(voice - engine->voices), patch);
+        return;
+    }
+    
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        trigger_release(&voice->synth_voice.operators[op].env,
+                        &patch->operators[op],
+                        voice->synth_voice.operators[op].rate_scale);
     }
-    g_midi_system.voice_count = 0;
 }
 
-// Generate audio block (called by audio thread)
-void generate_audio_block(float* output_buffer, int frame_count, double sample_rate) {
-    // Use the sample rate parameter for any rate-dependent calculations
-    // For now, we use the global sample rate, but this parameter allows for runtime changes
-    (void)sample_rate; // Acknowledge parameter - could be used for future sample rate changes
+// Frame within the current block at which an event should take effect
+// Events are rendered one block late at their offset from the start of the
+// previous block, so the delay is a constant block length instead of
+// jittering between zero and one block
+static int event_frame_offset(uint64_t timestamp, uint64_t block_start,
+                              double sample_rate, int frame_count) {
+    if (timestamp <= block_start) {
+        return 0;
+    }
     
-    if (!g_midi_system.active || !g_midi_system.play_mode) {
+    double frames = (double)(timestamp - block_start) * sample_rate / 1000000.0;
+    if (frames >= (double)(frame_count - 1)) {
+        return frame_count - 1; // Block came late - squeeze in at the end
+    }
+    return (int)frames;
+}
+
+// Generate audio block (called by audio thread)
+// The block is split into sub-blocks at the frame offsets of queued MIDI
+// events, so each event is applied at the sample it was stamped for
+void generate_audio_block(dx7_engine_t* engine, float* output_buffer, int frame_count, double sample_rate) {
+    if (!engine->active || !engine->play_mode) {
         // Fill with silence
         memset(output_buffer, 0, frame_count * sizeof(float));
         return;
     }
     
+    uint64_t block_start = engine->block_time;
+    engine->block_time = get_time_microseconds();
+    
+    sync_patches(engine);
+    
     // Clear output buffer
     memset(output_buffer, 0, frame_count * sizeof(float));
     
-    pthread_mutex_lock(&g_midi_system.voice_mutex);
+    int position = 0;
+    midi_event_t event;
+    while (midi_queue_pop(&engine->event_queue, &event)) {
+        int offset = event_frame_offset(event.timestamp, block_start, sample_rate, frame_count);
+        if (offset > position) {
+            render_voices(engine, output_buffer + position, offset - position);
+            position = offset;
+        }
+        midi_handle_message(engine, event.status, event.data1, event.data2);
+    }
     
-    // Mix all active voices
-    for (int voice_idx = 0; voice_idx < MAX_VOICES; voice_idx++) {
-        poly_voice_t* voice = &g_midi_system.voices[voice_idx];
-        
-        if (!voice->active) {
-            continue;
+    if (position < frame_count) {
+        render_voices(engine, output_buffer + position, frame_count - position);
+    }
+    
+    // Status for the control thread, if it has asked since the last copy
+    unsigned requested = atomic_load_explicit(&engine->status_requested, memory_order_acquire);
+    if (requested != atomic_load_explicit(&engine->status_served, memory_order_relaxed)) {
+        capture_status(engine);
+        atomic_store_explicit(&engine->status_served, requested, memory_order_release);
+    }
+}
+
+// Render one scalar voice and mix it into output, true once it has finished
+static bool render_voice(poly_voice_t* voice, float* output_buffer, int frame_count,
+                         double master_gain, double master_step, const dx7_block_mod_t* mod) {
+    double voice_buffer[DX7_BLOCK_SIZE];
+    const dx7_patch_t* patch = &voice->patch->compiled.patch;
+    
+    // The patch's LFO, NULL when it key-syncs its own
+    const double* lfo_values = mod->lfo_values;
+    
+    // Velocity scaling (master gain is ramped per frame below)
+    double velocity_gain = (double)voice->velocity / 127.0;
+    
+    // Pitch bend ramps across the whole sub-block
+    double bend_step = (mod->pitch_bend - mod->pitch_bend_start) / frame_count;
+    
+    // Generate samples for this voice, stopping as soon as every carrier
+    // has died away - the rest of the sub-block would be silence
+    for (int start = 0; start < frame_count; start += DX7_BLOCK_SIZE) {
+        if (dx7_voice_live_ops(&voice->synth_voice, patch) == 0) {
+            return true;
         }
         
-        // Generate samples for this voice
-        for (int frame = 0; frame < frame_count; frame++) {
-            // Apply controllers to voice
-            apply_controllers_to_voice(voice);
-            
-            // Generate sample
-            double sample = process_operators(&voice->synth_voice, &g_midi_system.current_patch);
-            
-            // Apply master volume and expression
-            sample *= g_midi_system.controllers.volume;
-            sample *= g_midi_system.controllers.expression;
-            
-            // Apply velocity scaling
-            sample *= (double)voice->velocity / 127.0;
-            
-            // Mix into output buffer
-            output_buffer[frame] += (float)sample * 0.5f; // Scale to prevent clipping
-        }
+        int frames = frame_count - start;
+        if (frames > DX7_BLOCK_SIZE) frames = DX7_BLOCK_SIZE;
         
-        // Check if voice envelope has finished
-        bool voice_finished = true;
-        for (int op = 0; op < MAX_OPERATORS; op++) {
-            if (voice->synth_voice.operators[op].env.level > 0.001) {
-                voice_finished = false;
-                break;
-            }
-        }
+        dx7_block_mod_t chunk_mod = {
+            .lfo_values = lfo_values ? lfo_values + start / voice->synth_voice.control_rate : NULL,
+            .pitch_bend_start = mod->pitch_bend - bend_step * (frame_count - start),
+            .pitch_bend = mod->pitch_bend - bend_step * (frame_count - start - frames),
+            .mod_wheel = mod->mod_wheel
+        };
+        process_operators_block(&voice->synth_voice, patch, &chunk_mod, voice_buffer, frames);
         
-        if (voice_finished) {
-            voice->active = false;
-            g_midi_system.voice_count--;
+        // Mix into output buffer
+        for (int frame = 0; frame < frames; frame++) {
+            double gain = (master_gain - master_step * (frame_count - 1 - (start + frame))) * velocity_gain;
+            output_buffer[start + frame] += (float)(voice_buffer[frame] * gain) * 0.5f; // Scale to prevent clipping
         }
     }
     
-    pthread_mutex_unlock(&g_midi_system.voice_mutex);
+    return dx7_voice_live_ops(&voice->synth_voice, patch) == 0;
+}
+
+// Mix buffer a render job writes to - the audio thread mixes straight into
+// the output, pool threads into their private buffers
+static float* worker_mix_buffer(dx7_engine_t* engine, int worker) {
+    if (worker == 0) {
+        return engine->render_job.output;
+    }
+    return engine->worker_mix + (size_t)(worker - 1) * MIDI_RENDER_MAX_FRAMES;
+}
+
+// Render job: a contiguous slice of the active voice list
+static void render_voice_slice(int worker, int job, void* context) {
+    dx7_engine_t* engine = (dx7_engine_t*)context;
+    render_job_t* render = &engine->render_job;
+    int first = render->voice_count * job / render->job_count;
+    int end = render->voice_count * (job + 1) / render->job_count;
+    float* output = worker_mix_buffer(engine, worker);
+    
+    for (int i = first; i < end; i++) {
+        poly_voice_t* voice = &engine->voices[engine->active_voices[i]];
+        voice->finished = render_voice(voice, output, render->frame_count,
+                                       render->master_gain, render->master_step, &render->mod);
+    }
 }
 
-// Apply controllers to voice
-void apply_controllers_to_voice(poly_voice_t* voice) {
-    // Calculate pitch with bend
-    double base_freq = midi_note_to_frequency_with_bend(voice->midi_note, 
-                                                       g_midi_system.controllers.pitch_bend);
+// Render job: one group of voice bank lanes
+static void render_lane_group(int worker, int job, void* context) {
+    dx7_engine_t* engine = (dx7_engine_t*)context;
+    render_job_t* render = &engine->render_job;
+    voice_bank_render_lanes(&engine->voice_bank, render->patch, &render->controls, worker_mix_buffer(engine, worker), render->frame_count,
+                            job * VOICE_BANK_LANES, VOICE_BANK_LANES);
+}
+
+// Jobs to split this sub-block into, 1 = render on the audio thread alone
+static int render_job_count(dx7_engine_t* engine) {
+    int threads = engine->render_pool.worker_count + 1;
+    if (threads == 1) {
+        return 1;
+    }
     
-    // Apply pitch bend to all operators
-    for (int op = 0; op < MAX_OPERATORS; op++) {
-        operator_state_t* op_state = &voice->synth_voice.operators[op];
-        const dx7_operator_t* op_params = &g_midi_system.current_patch.operators[op];
+    // A handful of voices isn't worth waking the workers for
+    int jobs = engine->voice_count / MIDI_RENDER_MIN_VOICES_PER_JOB;
+    return jobs < threads ? (jobs < 1 ? 1 : jobs) : threads;
+}
+
+// Fan the current render job out over the pool and sum the worker buffers
+static void run_render_job(dx7_engine_t* engine, render_job_fn fn, int job_count, float* output_buffer, int frame_count) {
+    int workers = engine->render_pool.worker_count;
+    memset(engine->worker_mix, 0, (size_t)workers * MIDI_RENDER_MAX_FRAMES * sizeof(float));
+    
+    render_pool_run(&engine->render_pool, fn, engine, job_count);
+    
+    for (int worker = 1; worker <= workers; worker++) {
+        const float* mix = worker_mix_buffer(engine, worker);
+        for (int frame = 0; frame < frame_count; frame++) {
+            output_buffer[frame] += mix[frame];
+        }
+    }
+}
+
+// Mix every active voice into output (added to, not cleared)
+static void render_voices(dx7_engine_t* engine, float* output_buffer, int frame_count) {
+    // Longer spans than the worker and LFO buffers hold go in pieces
+    if (frame_count > MIDI_RENDER_MAX_FRAMES) {
+        render_voices(engine, output_buffer, MIDI_RENDER_MAX_FRAMES);
+        render_voices(engine, output_buffer + MIDI_RENDER_MAX_FRAMES, frame_count - MIDI_RENDER_MAX_FRAMES);
+        return;
+    }
+    
+    // Controllers are sampled once per sub-block. Volume and expression are
+    // smoothed with a linear ramp from the previous sub-block's value so CC
+    // changes don't click
+    double master_gain = (double)engine->controllers.volume *
+                         (double)engine->controllers.expression;
+    double master_start = engine->smoothed_gain;
+    double master_step = (master_gain - master_start) / frame_count;
+    engine->smoothed_gain = master_gain;
+    
+    render_job_t* render = &engine->render_job;
+    render->output = output_buffer;
+    render->frame_count = frame_count;
+    render->master_gain = master_gain;
+    render->master_step = master_step;
+    
+    // Pitch bend: one pow() per patch in use when the wheel has moved, then
+    // a ramp from the last sub-block's ratio that its voices apply as they render
+    if (engine->pitch_bend_dirty) {
+        for (midi_patch_t* in_use = engine->patches_in_use; in_use; in_use = in_use->in_use_next) {
+            in_use->pitch_bend = patch_bend_ratio(engine, in_use);
+        }
+        engine->pitch_bend_dirty = false;
+    }
+    
+    int job_count = render_job_count(engine);
+    
+    // One pass per patch in use - there is only one except while voices
+    // started before a patch change are still ringing. Each patch has its
+    // own LFO and bend range, so those voices finish as they started
+    for (midi_patch_t* in_use = engine->patches_in_use; in_use; in_use = in_use->in_use_next) {
+        render->patch = &in_use->compiled.patch;
+        render->mod = (dx7_block_mod_t){
+            .lfo_values = NULL,
+            .pitch_bend_start = in_use->smoothed_bend,
+            .pitch_bend = in_use->pitch_bend,
+            .mod_wheel = engine->controllers.mod_wheel
+        };
+        in_use->smoothed_bend = in_use->pitch_bend;
         
-        // Update frequency with pitch bend
-        op_state->freq = base_freq * op_params->freq_ratio;
+        // One LFO for every voice of a patch that doesn't restart it at each key
+        if (!render->patch->lfo_sync) {
+            dx7_lfo_render(&in_use->lfo, render->patch, engine->controllers.mod_wheel, engine->config.sample_rate,
+                           engine->config.control_rate, frame_count, engine->lfo_values);
+            render->mod.lfo_values = engine->lfo_values;
+        }
         
-        // Apply detune
-        double detune_factor = pow(2.0, (op_params->detune / 7.0) * 0.01);
-        op_state->freq *= detune_factor;
+        if (engine->use_voice_bank) {
+            render->controls = (voice_bank_controls_t){
+                .mod_wheel = engine->controllers.mod_wheel,
+                .lfo_values = render->mod.lfo_values,
+                .master_gain = master_gain,
+                .master_gain_start = master_start,
+                .pitch_bend = render->mod.pitch_bend,
+                .pitch_bend_start = render->mod.pitch_bend_start,
+                .patch_id = in_use->id
+            };
+            
+            if (job_count > 1) {
+                // Lane groups are claimed one at a time, so idle groups cost
+                // next to nothing and busy ones spread over the workers
+                run_render_job(engine, render_lane_group, engine->voice_bank.capacity / VOICE_BANK_LANES,
+                               output_buffer, frame_count);
+            } else {
+                voice_bank_render(&engine->voice_bank, render->patch, &render->controls, output_buffer, frame_count);
+            }
+        } else if (job_count > 1) {
+            // Snapshot the patch's voices so jobs can index them
+            int count = 0;
+            for (int voice_idx = engine->lru_head; voice_idx >= 0;
+                 voice_idx = engine->voices[voice_idx].next) {
+                if (engine->voices[voice_idx].patch == in_use) {
+                    engine->active_voices[count++] = (int16_t)voice_idx;
+                }
+            }
+            render->voice_count = count;
+            render->job_count = job_count;
+            
+            if (count > 0) {
+                run_render_job(engine, render_voice_slice, job_count, output_buffer, frame_count);
+            }
+        } else {
+            // Only the active list is walked, so a large pool costs nothing
+            // while it is mostly idle
+            for (int voice_idx = engine->lru_head; voice_idx >= 0; voice_idx = engine->voices[voice_idx].next) {
+                poly_voice_t* voice = &engine->voices[voice_idx];
+                if (voice->patch == in_use) {
+                    voice->finished = render_voice(voice, output_buffer, frame_count, master_gain, master_step,
+                                                   &render->mod);
+                }
+            }
+        }
     }
     
-    // Apply mod wheel to LFO amplitude (if LFO is active)
-    // This is done in the voice's LFO processing
+    // Reclaim voices whose envelopes have finished - this may drop patches
+    // from the in-use list, so it waits until every pass is done
+    for (int voice_idx = engine->lru_head, next; voice_idx >= 0; voice_idx = next) {
+        poly_voice_t* voice = &engine->voices[voice_idx];
+        next = voice->next;
+        bool finished = engine->use_voice_bank
+                      ? voice_bank_lane_finished(&engine->voice_bank, voice_idx, &voice->patch->compiled.patch)
+                      : voice->finished;
+        if (finished) {
+            free_voice(engine, voice_idx);
+        }
+    }
 }
 
-// Convert MIDI note to frequency with pitch bend
-double midi_note_to_frequency_with_bend(uint8_t midi_note, float pitch_bend) {
+double midi_note_to_frequency_with_bend(const dx7_engine_t* engine, uint8_t midi_note, float pitch_bend) {
     // Base frequency
     double freq = midi_note_to_frequency(midi_note);
     
-    // Apply pitch bend (±2 semitones by default)
-    double bend_semitones = pitch_bend * 2.0; // ±2 semitones range
+    // Apply pitch bend over the patch's range
+    double bend_semitones = pitch_bend * engine->patch->compiled.patch.pitch_bend_range;
     freq *= pow(2.0, bend_semitones / 12.0);
     
     return freq;
@@ -619,29 +1441,83 @@ float midi_to_bipolar(uint8_t midi_value) {
     return ((float)midi_value / 127.0f * 2.0f) - 1.0f;
 }
 
+// Copy the counters, controllers and active list into engine->status
+// (audio thread, between blocks)
+static void capture_status(dx7_engine_t* engine) {
+    engine_status_t* status = &engine->status;
+    status->notes_played = engine->notes_played;
+    status->voice_steals = engine->voice_steals;
+    status->controllers = engine->controllers;
+    
+    int count = 0;
+    for (int i = engine->lru_head; i >= 0 && count < engine->max_voices; i = engine->voices[i].next) {
+        const poly_voice_t* voice = &engine->voices[i];
+        status->voices[count++] = (voice_status_t){
+            .index = (int16_t)i,
+            .midi_note = voice->midi_note,
+            .velocity = voice->velocity,
+            .channel = voice->channel,
+            .sustain_held = voice->sustain_held
+        };
+    }
+    status->voice_count = count;
+}
+
+// Fill engine->status from the control thread. While play mode is running
+// the audio thread makes the copy at the end of its next block; otherwise
+// nothing else touches the voices and it is made here. False if the audio
+// thread didn't answer in time
+static bool request_status(dx7_engine_t* engine) {
+    if (engine->offline || !engine->play_mode) {
+        capture_status(engine);
+        return true;
+    }
+    unsigned request = atomic_fetch_add_explicit(&engine->status_requested, 1, memory_order_release) + 1;
+    for (int waited = 0; waited < STATUS_TIMEOUT_MS; waited++) {
+        if (atomic_load_explicit(&engine->status_served, memory_order_acquire) == request) {
+            return true;
+        }
+        usleep(1000);
+    }
+    printf("⚠️ Audio thread not responding - no status available\n");
+    return false;
+}
+
 // Print MIDI statistics
-void print_midi_stats(void) {
+void print_midi_stats(dx7_engine_t* engine) {
+    if (!request_status(engine)) {
+        return;
+    }
+    const engine_status_t* status = &engine->status;
     printf("\n🎹 MIDI System Statistics:\n");
-    printf("   Active voices: %d/%d\n", g_midi_system.voice_count, MAX_VOICES);
-    printf("   Notes played: %u\n", g_midi_system.notes_played);
-    printf("   Voice steals: %u\n", g_midi_system.voice_steals);
-    printf("   MIDI errors: %u\n", g_midi_system.midi_errors);
-    printf("   Channel: %d\n", g_midi_system.current_channel + 1);
-    printf("   Pitch bend: %.3f\n", g_midi_system.controllers.pitch_bend);
-    printf("   Mod wheel: %.3f\n", g_midi_system.controllers.mod_wheel);
-    printf("   Volume: %.3f\n", g_midi_system.controllers.volume);
-    printf("   Sustain: %s\n", g_midi_system.controllers.sustain_pedal ? "ON" : "OFF");
-}
-
-// Print active voices
-void print_active_voices(void) {
-    printf("\n🎵 Active Voices:\n");
-    for (int i = 0; i < MAX_VOICES; i++) {
-        poly_voice_t* voice = &g_midi_system.voices[i];
-        if (voice->active) {
-            printf("   [%d] Note:%d Vel:%d Ch:%d %s\n", 
-                   i, voice->midi_note, voice->velocity, voice->channel + 1,
-                   voice->sustain_held ? "(sustained)" : "");
-        }
+    printf("   Active voices: %d/%d\n", status->voice_count, engine->max_voices);
+    printf("   Notes played: %u\n", status->notes_played);
+    printf("   Voice steals: %u\n", status->voice_steals);
+    printf("   MIDI errors: %u\n", atomic_load_explicit(&engine->midi_errors, memory_order_relaxed));
+    printf("   MIDI events dropped: %u\n", midi_queue_dropped(&engine->event_queue));
+    printf("   Log messages dropped: %u\n", rt_log_dropped());
+    if (engine->omni) {
+        printf("   Channel: omni\n");
+    } else {
+        printf("   Channel: %d\n", engine->current_channel + 1);
+    }
+    printf("   Pitch bend: %.3f\n", status->controllers.pitch_bend);
+    printf("   Mod wheel: %.3f\n", status->controllers.mod_wheel);
+    printf("   Volume: %.3f\n", status->controllers.volume);
+    printf("   Sustain: %s\n", status->controllers.sustain_pedal ? "ON" : "OFF");
+}
+
+// Print active voices, oldest first
+void print_active_voices(dx7_engine_t* engine) {
+    if (!request_status(engine)) {
+        return;
+    }
+    const engine_status_t* status = &engine->status;
+    printf("\n🎵 Active Voices (%d/%d):\n", status->voice_count, engine->max_voices);
+    for (int i = 0; i < status->voice_count; i++) {
+        const voice_status_t* voice = &status->voices[i];
+        printf("   [%d] Note:%d Vel:%d Ch:%d %s\n", 
+               voice->index, voice->midi_note, voice->velocity, voice->channel + 1,
+               voice->sustain_held ? "(sustained)" : "");
     }
 }
@@ -3,8 +3,12 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include "dx7.h"
+#include "voice_bank.h"
+#include "midi_queue.h"
+#include "render_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,8 +40,16 @@ extern "C" {
 #define MIDI_CC_ALL_CONTROLLERS_OFF 121
 #define MIDI_CC_ALL_NOTES_OFF   123
 
-// Maximum polyphony
-#define MAX_VOICES              16
+// Polyphony - the voice pool is sized at startup (dx7_engine_config_set_polyphony)
+#define DEFAULT_POLYPHONY       16
+#define MAX_POLYPHONY           4096    // Voice links are int16_t
+
+// Multi-threaded rendering
+#define MIDI_RENDER_MAX_FRAMES  4096    // Worker mix buffer size (AUDIO_BUFFER_SIZE_MAXIMUM)
+#define MIDI_RENDER_MIN_VOICES_PER_JOB 4 // Fewer active voices render on the audio thread
+
+// Program change slots
+#define MIDI_PROGRAM_COUNT      128
 
 // MIDI input parser state
 typedef struct {
@@ -46,24 +58,50 @@ typedef struct {
     uint8_t data_bytes_received;
     uint8_t data_buffer[3];
     bool in_sysex;
-    uint8_t sysex_buffer[512];
-    size_t sysex_length;
+    dx7_sysex_receiver_t sysex;                  // Voice and bank dumps
+    dx7_patch_t sysex_bank[DX7_VMEM_VOICES];     // A received bank, unpacked
+    uint64_t timestamp;     // Arrival time of the packet being parsed (microseconds)
 } midi_parser_state_t;
 
+// Immutable compiled patch, shared by the audio thread and every voice
+// playing it. The control thread publishes it through pending_patch or a
+// program slot and never writes to it again. Once it is unpublished it is
+// retired at the current epoch, and freed when the audio thread has seen a
+// later epoch and no voice still holds it (midi_input_collect_patches)
+typedef struct midi_patch {
+    dx7_compiled_patch_t compiled;
+    uint32_t id;                     // Tags the voice bank lanes playing it
+    atomic_int refs;                 // Audio thread: voices + current patch
+    struct midi_patch* in_use_next;  // Audio thread: patches with refs > 0
+    dx7_lfo_t lfo;                   // Audio thread: LFO its voices share unless key-synced
+    double pitch_bend;               // Audio thread: bend ratio over this patch's range
+    double smoothed_bend;            // Audio thread: ratio reached by the last block
+    uint64_t retired_epoch;          // Control thread: 0 while published
+    struct midi_patch* next;         // Control thread: every allocation
+} midi_patch_t;
+
 // Voice state for polyphonic synthesis
+// Cache-line aligned so neighbouring voices in the pool never share a line
 typedef struct {
-    bool active;
+    _Alignas(64) bool active;
     uint8_t midi_note;
     uint8_t velocity;
     uint8_t channel;
+    midi_patch_t* patch;    // Patch at note-on, kept until the voice is freed
     voice_state_t synth_voice;
     uint64_t note_on_time;
     bool sustain_held;
+    bool finished;          // Set by a render worker, reclaimed by the audio thread
+    
+    // Intrusive list links (voice indices, -1 = none). A free voice is on
+    // the free list, an active one on the LRU list
+    int16_t prev;
+    int16_t next;
 } poly_voice_t;
 
 // MIDI controller values
 typedef struct {
-    float pitch_bend;       // -1.0 to +1.0 (±2 semitones by default)
+    float pitch_bend;       // -1.0 to +1.0 (± the patch's pitch bend range)
     float mod_wheel;        // 0.0 to 1.0 (CC 1)
     float breath;           // 0.0 to 1.0 (CC 2)
     float foot;             // 0.0 to 1.0 (CC 4)
@@ -77,73 +115,101 @@ typedef struct {
     float controllers[128]; // All CC values 0-127
 } midi_controllers_t;
 
-// MIDI input system state
+// The sub-block being rendered, shared with the render workers
 typedef struct {
-    bool active;
-    bool play_mode;
-    pthread_mutex_t voice_mutex;
-    
-    // Current patch
-    dx7_patch_t current_patch;
-    
-    // Voice management
-    poly_voice_t voices[MAX_VOICES];
-    int voice_count;
-    uint64_t voice_counter; // For voice stealing LRU
-    
-    // MIDI state
-    midi_parser_state_t parser;
-    midi_controllers_t controllers;
-    uint8_t current_channel; // 0-15 (MIDI channels 1-16)
-    
-    // Audio output handle
-    void* audio_output_handle;
-    
-    // Statistics
-    uint32_t notes_played;
-    uint32_t voice_steals;
-    uint32_t midi_errors;
-} midi_input_system_t;
-
-// Global system instance
-extern midi_input_system_t g_midi_system;
-
-// MIDI input system functions
-bool midi_input_initialize(const dx7_patch_t* patch, int input_device, int channel);
-void midi_input_shutdown(void);
-bool midi_input_start_play_mode(void);
-void midi_input_stop_play_mode(void);
+    float* output;          // Audio thread's buffer (worker 0 mixes straight in)
+    int frame_count;
+    const dx7_patch_t* patch; // Patch of this pass - bank lanes tagged with controls.patch_id
+    double master_gain;
+    double master_step;
+    dx7_block_mod_t mod;    // The patch's LFO (NULL values when key-synced) and pitch bend ramp
+    voice_bank_controls_t controls;
+    int voice_count;        // Scalar path: entries of active_voices[] (voices of the patch) to render
+    int job_count;
+} render_job_t;
+
+// Engine instances
+// An engine owns everything one synth needs: its sample rate, voice pool,
+// controllers, patches, render workers and event queue. Every function
+// takes the engine explicitly and instances share no mutable state, so
+// any number can render at once on different threads, each at its own
+// sample rate, control rate and sine kernel. The sine, LFO and algorithm
+// tables are read-only and shared (dx7_sine_init() and dx7_lfo_init() must
+// have run).
+typedef struct dx7_engine dx7_engine_t;
+
+// Fixed for the life of an engine
+typedef struct dx7_engine_config {
+    int sample_rate;                 // Hz
+    int control_rate;                // Samples between envelope and LFO updates
+    dx7_sine_kernel_t sine_kernel;   // Scalar voices' sine (the voice bank has its own)
+    int polyphony;                   // Voice pool size, 1-MAX_POLYPHONY
+    int render_threads;              // Threads sharing the voices, including the audio thread
+    bool use_voice_bank;             // SIMD voice bank (falls back to per-voice rendering)
+    voice_bank_isa_t voice_bank_isa;
+    int channel;                     // MIDI channel 1-16, 0 = every channel
+} dx7_engine_config_t;
+
+void dx7_engine_default_config(dx7_engine_config_t* config);
+bool dx7_engine_config_set_polyphony(dx7_engine_config_t* config, int voices);
+bool dx7_engine_config_set_control_rate(dx7_engine_config_t* config, int samples);
+bool dx7_engine_config_set_render_threads(dx7_engine_config_t* config, int threads); // 0 = one per core
+
+// Offline engine, without MIDI or audio devices - the caller is its audio
+// thread: events go to midi_handle_message() and audio comes from
+// dx7_engine_render(). NULL if it couldn't be set up
+dx7_engine_t* dx7_engine_create(const dx7_engine_config_t* config, const dx7_patch_t* patch);
+void dx7_engine_destroy(dx7_engine_t* engine);
+void dx7_engine_render(dx7_engine_t* engine, float* output_buffer, int frame_count);
+int dx7_engine_sample_rate(const dx7_engine_t* engine);
+int dx7_engine_voice_count(const dx7_engine_t* engine);
+uint32_t dx7_engine_notes_played(const dx7_engine_t* engine);
+
+// Play mode engine, driven by CoreMIDI and the audio unit
+dx7_engine_t* midi_input_initialize(const dx7_engine_config_t* config, const dx7_patch_t* patch, int input_device);
+void midi_input_shutdown(dx7_engine_t* engine);
+bool midi_input_start_play_mode(dx7_engine_t* engine);
+void midi_input_stop_play_mode(dx7_engine_t* engine);
+
+// Patch changes (any thread but the audio thread) - compiled here, then
+// swapped in without blocking the audio thread. Voices already sounding
+// finish with the patch they started with
+bool midi_input_set_patch(dx7_engine_t* engine, const dx7_patch_t* patch);
+bool midi_input_set_program(dx7_engine_t* engine, int program, const dx7_patch_t* patch); // NULL empties the slot
+bool midi_input_set_programs(dx7_engine_t* engine, int first, const dx7_patch_t* patches, int count);
+void midi_input_collect_patches(dx7_engine_t* engine);                                    // Free retired patches
 
 // MIDI message parsing
-void midi_parse_byte(uint8_t byte);
-void midi_handle_message(uint8_t status, uint8_t data1, uint8_t data2);
+void midi_parse_byte(dx7_engine_t* engine, uint8_t byte);
+void midi_handle_sysex(dx7_engine_t* engine, dx7_sysex_result_t result);                      // MIDI thread
+void midi_queue_message(dx7_engine_t* engine, uint8_t status, uint8_t data1, uint8_t data2);   // MIDI thread
+void midi_handle_message(dx7_engine_t* engine, uint8_t status, uint8_t data1, uint8_t data2);  // Audio thread
 
 // Voice management
-int allocate_voice(uint8_t midi_note, uint8_t velocity, uint8_t channel);
-void release_voice(uint8_t midi_note, uint8_t channel);
-void release_all_voices(void);
-poly_voice_t* find_voice(uint8_t midi_note, uint8_t channel);
+int allocate_voice(dx7_engine_t* engine, uint8_t midi_note, uint8_t velocity, uint8_t channel);
+void release_all_voices(dx7_engine_t* engine);
+poly_voice_t* find_voice(dx7_engine_t* engine, uint8_t midi_note, uint8_t channel);
 
 // MIDI message handlers
-void handle_note_on(uint8_t channel, uint8_t note, uint8_t velocity);
-void handle_note_off(uint8_t channel, uint8_t note, uint8_t velocity);
-void handle_control_change(uint8_t channel, uint8_t controller, uint8_t value);
-void handle_pitch_bend(uint8_t channel, uint16_t bend_value);
-void handle_program_change(uint8_t channel, uint8_t program);
-void handle_channel_pressure(uint8_t channel, uint8_t pressure);
+void handle_note_on(dx7_engine_t* engine, uint8_t channel, uint8_t note, uint8_t velocity);
+void handle_note_off(dx7_engine_t* engine, uint8_t channel, uint8_t note, uint8_t velocity);
+void handle_control_change(dx7_engine_t* engine, uint8_t channel, uint8_t controller, uint8_t value);
+void handle_pitch_bend(dx7_engine_t* engine, uint8_t channel, uint16_t bend_value);
+void handle_program_change(dx7_engine_t* engine, uint8_t channel, uint8_t program);
+void handle_channel_pressure(dx7_engine_t* engine, uint8_t channel, uint8_t pressure);
 
 // Audio generation (called by audio output thread)
-void generate_audio_block(float* output_buffer, int frame_count, double sample_rate);
+void generate_audio_block(dx7_engine_t* engine, float* output_buffer, int frame_count, double sample_rate);
 
 // Utility functions
-double midi_note_to_frequency_with_bend(uint8_t midi_note, float pitch_bend);
+double midi_note_to_frequency_with_bend(const dx7_engine_t* engine, uint8_t midi_note, float pitch_bend);
 float midi_to_float(uint8_t midi_value); // Convert 0-127 to 0.0-1.0
 float midi_to_bipolar(uint8_t midi_value); // Convert 0-127 to -1.0-1.0
-void apply_controllers_to_voice(poly_voice_t* voice);
 
 // Statistics and debugging
-void print_midi_stats(void);
-void print_active_voices(void);
+// Control thread - the audio thread copies what they show between blocks
+void print_midi_stats(dx7_engine_t* engine);
+void print_active_voices(dx7_engine_t* engine);
 
 #ifdef __cplusplus
 }
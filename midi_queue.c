@@ -0,0 +1,43 @@
+#include "midi_queue.h"
+
+void midi_queue_init(midi_queue_t* queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->dropped, 0);
+}
+
+// Indices run freely and wrap at 2^32; head - tail is the fill level
+bool midi_queue_push(midi_queue_t* queue, const midi_event_t* event) {
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head - tail >= MIDI_QUEUE_SIZE) {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    queue->events[head & (MIDI_QUEUE_SIZE - 1)] = *event;
+
+    // Publish the slot to the consumer
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool midi_queue_pop(midi_queue_t* queue, midi_event_t* event) {
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (tail == head) {
+        return false;
+    }
+
+    *event = queue->events[tail & (MIDI_QUEUE_SIZE - 1)];
+
+    // Hand the slot back to the producer
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+unsigned midi_queue_dropped(const midi_queue_t* queue) {
+    return atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+#ifndef MIDI_QUEUE_H
+#define MIDI_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Wait-free single-producer/single-consumer ring of channel messages
+// The MIDI thread pushes complete messages as they are parsed; the audio
+// thread drains the ring every block and applies each event at the frame
+// its timestamp maps to. Neither side ever
+// blocks: a full ring drops the event and counts it.
+
+// Capacity in events (power of two)
+#define MIDI_QUEUE_SIZE 1024
+
+typedef struct {
+    uint64_t timestamp;   // Arrival time in microseconds (monotonic clock)
+    uint8_t status;       // Status byte including channel
+    uint8_t data1;
+    uint8_t data2;
+} midi_event_t;
+
+typedef struct {
+    // Producer and consumer indices on separate cache lines
+    _Alignas(64) atomic_uint head;   // Next slot to write (MIDI thread)
+    _Alignas(64) atomic_uint tail;   // Next slot to read (audio thread)
+    _Alignas(64) atomic_uint dropped; // Events lost to a full ring
+    midi_event_t events[MIDI_QUEUE_SIZE];
+} midi_queue_t;
+
+void midi_queue_init(midi_queue_t* queue);
+bool midi_queue_push(midi_queue_t* queue, const midi_event_t* event);  // Producer only
+bool midi_queue_pop(midi_queue_t* queue, midi_event_t* event);         // Consumer only
+unsigned midi_queue_dropped(const midi_queue_t* queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIDI_QUEUE_H
@@ -0,0 +1,333 @@
+// mkdir and clock_gettime under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include "dx7.h"
+#include "render_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Multisample batch renderer
+// Every patch x note x velocity combination is one job on the render pool.
+// Threads claim jobs one at a time from a shared counter, so a thread that
+// finishes early takes the next job instead of idling. Each job renders
+// and writes its own WAV with its own voice state, so the output doesn't
+// depend on the thread count or order. Patches are decoded and compiled
+// once up front. The SFZ mappings are written afterwards, one per patch.
+// Looped samples run from note-on to the loop end, with the loop points
+// found by each job going into the SFZ.
+
+// SFZ / sample directory name length
+#define PREFIX_LENGTH 128
+
+typedef struct {
+    const dx7_multisample_spec_t* spec;
+    const dx7_compiled_patch_t* compiled;   // One per patch
+    char (*names)[PREFIX_LENGTH];           // Sample directory per patch
+    const char* output_dir;
+    float** buffers;                        // One chunk per worker
+    dx7_loop_t* loops;                      // One per job, NULL without loops
+    int notes;                              // Notes per patch
+    atomic_int failed;
+} multisample_context_t;
+
+// "lo:hi" or "lo:hi:step", MIDI notes
+bool dx7_parse_note_range(const char* text, dx7_multisample_spec_t* spec) {
+    char* end;
+    long low = strtol(text, &end, 10);
+    if (*end != ':') return false;
+    long high = strtol(end + 1, &end, 10);
+    long step = 1;
+    if (*end == ':') {
+        step = strtol(end + 1, &end, 10);
+    }
+    if (*end != '\0' || low < 0 || high > 127 || low > high || step < 1) {
+        return false;
+    }
+    spec->note_low = (int)low;
+    spec->note_high = (int)high;
+    spec->note_step = (int)step;
+    return true;
+}
+
+// "v1,v2,..." strictly rising, 1-127. Each layer plays at its velocity
+// and covers the velocities above the layer below it
+bool dx7_parse_velocity_layers(const char* text, dx7_multisample_spec_t* spec) {
+    int count = 0;
+    const char* c = text;
+    while (*c) {
+        char* end;
+        long velocity = strtol(c, &end, 10);
+        if (end == c || velocity < 1 || velocity > 127 || count == DX7_MULTISAMPLE_MAX_LAYERS ||
+            (count > 0 && velocity <= spec->velocities[count - 1])) {
+            return false;
+        }
+        spec->velocities[count++] = (int)velocity;
+        if (*end == ',') end++;
+        else if (*end != '\0') return false;
+        c = end;
+    }
+    if (count == 0) {
+        return false;
+    }
+    spec->velocity_count = count;
+    return true;
+}
+
+static int note_at(const dx7_multisample_spec_t* spec, int index) {
+    return spec->note_low + index * spec->note_step;
+}
+
+static void sample_path(const multisample_context_t* context, int patch, int note, int velocity,
+                        char* path, size_t size) {
+    snprintf(path, size, "%s/%s/n%03d_v%03d.wav", context->output_dir, context->names[patch], note, velocity);
+}
+
+// Job: render and write one patch/note/velocity
+static void multisample_job(int worker, int job, void* context) {
+    multisample_context_t* batch = (multisample_context_t*)context;
+    const dx7_multisample_spec_t* spec = batch->spec;
+
+    int layers = spec->velocity_count;
+    int patch = job / (batch->notes * layers);
+    int note = note_at(spec, (job / layers) % batch->notes);
+    int velocity = spec->velocities[job % layers];
+    const dx7_compiled_patch_t* compiled = &batch->compiled[patch];
+
+    char path[4096];
+    sample_path(batch, patch, note, velocity, path, sizeof(path));
+
+    SF_INFO sf_info = {0};
+    sf_info.samplerate = spec->sample_rate;
+    sf_info.channels = 1; // Mono
+    sf_info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+    SNDFILE* sf = sf_open(path, SFM_WRITE, &sf_info);
+    if (!sf) {
+        fprintf(stderr, "❌ Cannot create '%s'\n", path);
+        atomic_fetch_add(&batch->failed, 1);
+        return;
+    }
+
+    // Played as the key is mapped; the patch transpose shifts what sounds
+    int played = note + compiled->patch.transpose;
+    if (played < 0) played = 0;
+    if (played > 127) played = 127;
+
+    voice_state_t voice;
+    init_operators_compiled(&voice, compiled, played, (double)velocity / 127.0, spec->control_rate,
+                            dx7_sine_kernel_fn(spec->sine_kernel));
+
+    int64_t total_samples = (int64_t)(spec->duration * spec->sample_rate);
+    if (batch->loops) {
+        dx7_loop_t* loop = &batch->loops[job];
+        if (!dx7_find_loop(&voice, &compiled->patch, spec->loop_cycles, loop)) {
+            fprintf(stderr, "❌ Cannot allocate loop search buffers for '%s'\n", path);
+            atomic_fetch_add(&batch->failed, 1);
+            sf_close(sf);
+            return;
+        }
+        total_samples = loop->end;
+    }
+
+    float* chunk = batch->buffers[worker];
+    for (int64_t done = 0; done < total_samples; ) {
+        int frames = DX7_WAV_CHUNK_FRAMES;
+        if (total_samples - done < frames) frames = (int)(total_samples - done);
+        dx7_render_note(&voice, &compiled->patch, chunk, frames);
+        if (sf_write_float(sf, chunk, frames) != frames) {
+            fprintf(stderr, "❌ Cannot write '%s'\n", path);
+            atomic_fetch_add(&batch->failed, 1);
+            break;
+        }
+        done += frames;
+    }
+    sf_close(sf);
+}
+
+// One SFZ per patch: each sample covers the keys nearest to it and the
+// velocities from the layer below up to its own
+static bool write_sfz(const multisample_context_t* context, int patch) {
+    const dx7_multisample_spec_t* spec = context->spec;
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.sfz", context->output_dir, context->names[patch]);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "❌ Cannot create '%s'\n", path);
+        return false;
+    }
+
+    fprintf(file, "// DX7 %s - %d notes x %d velocity layers\n\n",
+            context->compiled[patch].patch.name, context->notes, spec->velocity_count);
+    fprintf(file, "<control>\ndefault_path=%s/\n\n<group>\nloop_mode=%s\n\n", context->names[patch],
+            context->loops ? "loop_continuous" : "no_loop");
+
+    for (int n = 0; n < context->notes; n++) {
+        int note = note_at(spec, n);
+        int low_key = n == 0 ? spec->note_low : note_at(spec, n - 1) + spec->note_step / 2 + 1;
+        int high_key = n == context->notes - 1 ? spec->note_high : note + spec->note_step / 2;
+
+        for (int v = 0; v < spec->velocity_count; v++) {
+            int low_velocity = v == 0 ? 1 : spec->velocities[v - 1] + 1;
+            int high_velocity = v == spec->velocity_count - 1 ? 127 : spec->velocities[v];
+            fprintf(file, "<region> sample=n%03d_v%03d.wav lokey=%d hikey=%d pitch_keycenter=%d "
+                    "lovel=%d hivel=%d", note, spec->velocities[v], low_key, high_key, note,
+                    low_velocity, high_velocity);
+            if (context->loops) {
+                // SFZ loop ends are inclusive
+                const dx7_loop_t* loop = &context->loops[((int64_t)patch * context->notes + n) * spec->velocity_count + v];
+                fprintf(file, " loop_start=%lld loop_end=%lld", (long long)loop->start, (long long)loop->end - 1);
+            }
+            fprintf(file, "\n");
+        }
+    }
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+// Name for a patch's SFZ and sample directory: the input file's name, with
+// the voice number added for files holding several voices
+static void patch_prefix(const char* path, int voice, int count, char* prefix, size_t size) {
+    char stem[PREFIX_LENGTH - 12]; // Room for _NN
+    dx7_path_stem(path, stem, sizeof(stem));
+    if (count == 1) {
+        snprintf(prefix, size, "%s", stem);
+    } else {
+        snprintf(prefix, size, "%s_%02d", stem, voice + 1);
+    }
+}
+
+// Render every note and velocity layer of every voice in the inputs (.patch
+// or .syx files, directories searched) to output_dir, with one SFZ per
+// voice. Returns the number of samples that failed, -1 if none could start
+int dx7_render_multisamples(const char* const* inputs, int input_count, const char* output_dir,
+                            const dx7_multisample_spec_t* spec, int threads) {
+    int file_count;
+    char** paths = dx7_list_patch_files(inputs, input_count, &file_count);
+    if (!paths) {
+        fprintf(stderr, "❌ No .syx or .patch files to render\n");
+        return -1;
+    }
+
+    // Decode and compile every voice once
+    dx7_compiled_patch_t* compiled = NULL;
+    char (*names)[PREFIX_LENGTH] = NULL;
+    int patch_count = 0;
+    for (int f = 0; f < file_count; f++) {
+        dx7_patch_t* voices;
+        int count = dx7_decode_patch_file(paths[f], &voices, NULL);
+        if (count <= 0) {
+            continue;
+        }
+        dx7_compiled_patch_t* grown = (dx7_compiled_patch_t*)realloc(compiled, (size_t)(patch_count + count) * sizeof(dx7_compiled_patch_t));
+        char (*grown_names)[PREFIX_LENGTH] = realloc(names, (size_t)(patch_count + count) * sizeof(*names));
+        if (grown) compiled = grown;
+        if (grown_names) names = grown_names;
+        if (!grown || !grown_names) {
+            free(voices);
+            break;
+        }
+        for (int v = 0; v < count; v++) {
+            compile_patch(&voices[v], spec->sample_rate, &compiled[patch_count]);
+            patch_prefix(paths[f], v, count, names[patch_count], sizeof(names[patch_count]));
+            patch_count++;
+        }
+        free(voices);
+    }
+    dx7_free_patch_files(paths, file_count);
+
+    int notes = (spec->note_high - spec->note_low) / spec->note_step + 1;
+    int64_t job_count = (int64_t)patch_count * notes * spec->velocity_count;
+    if (patch_count == 0 || job_count > INT32_MAX) {
+        fprintf(stderr, "❌ %s\n", patch_count == 0 ? "No voices could be read" : "Too many samples for one batch");
+        free(compiled);
+        free(names);
+        return -1;
+    }
+
+    if (mkdir(output_dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "❌ Cannot create output directory '%s'\n", output_dir);
+        free(compiled);
+        free(names);
+        return -1;
+    }
+    char directory[4096];
+    for (int p = 0; p < patch_count; p++) {
+        snprintf(directory, sizeof(directory), "%s/%s", output_dir, names[p]);
+        if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+            fprintf(stderr, "❌ Cannot create output directory '%s'\n", directory);
+            free(compiled);
+            free(names);
+            return -1;
+        }
+    }
+
+    render_pool_t pool;
+    threads = render_pool_start(&pool, threads, (int)job_count);
+
+    multisample_context_t context = {
+        .spec = spec,
+        .compiled = compiled,
+        .names = names,
+        .output_dir = output_dir,
+        .buffers = (float**)calloc((size_t)threads, sizeof(float*)),
+        .loops = spec->loop_cycles > 0 ? (dx7_loop_t*)calloc((size_t)job_count, sizeof(dx7_loop_t)) : NULL,
+        .notes = notes
+    };
+    atomic_init(&context.failed, 0);
+    bool allocated = context.buffers != NULL && (spec->loop_cycles == 0 || context.loops != NULL);
+    for (int i = 0; allocated && i < threads; i++) {
+        context.buffers[i] = (float*)malloc(DX7_WAV_CHUNK_FRAMES * sizeof(float));
+        allocated = context.buffers[i] != NULL;
+    }
+
+    int failed = -1;
+    if (allocated) {
+        printf("🎹 Rendering %lld %ssamples (%d voices x %d notes x %d velocity layers) on %d threads...\n",
+               (long long)job_count, context.loops ? "looped " : "", patch_count, notes, spec->velocity_count, threads);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        render_pool_run_all(&pool, multisample_job, &context, (int)job_count);
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        failed = atomic_load(&context.failed);
+        int sfz_failed = 0;
+        for (int p = 0; p < patch_count; p++) {
+            if (!write_sfz(&context, p)) sfz_failed++;
+        }
+
+        double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+        double audio_seconds = (double)job_count * spec->duration;
+        if (context.loops) {
+            audio_seconds = 0.0;
+            for (int64_t j = 0; j < job_count; j++) {
+                audio_seconds += (double)context.loops[j].end / spec->sample_rate;
+            }
+        }
+        printf("✅ Rendered %lld samples and %d SFZ files in %.3f s - %.1fx realtime\n",
+               (long long)job_count - failed, patch_count - sfz_failed, seconds,
+               seconds > 0.0 ? audio_seconds / seconds : 0.0);
+        if (failed > 0 || sfz_failed > 0) {
+            printf("⚠️ %d samples and %d SFZ files could not be written\n", failed, sfz_failed);
+        }
+        failed += sfz_failed;
+    } else {
+        fprintf(stderr, "❌ Cannot allocate render buffers\n");
+    }
+    render_pool_free(&pool);
+
+    for (int i = 0; context.buffers && i < threads; i++) {
+        free(context.buffers[i]);
+    }
+    free(context.buffers);
+    free(context.loops);
+    free(compiled);
+    free(names);
+    return failed;
+}
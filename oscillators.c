@@ -1,13 +1,4 @@
 #include "dx7.h"
-#include "midi_input.h"
-
-#define TWO_PI (2.0 * M_PI)
-
-// External global sample rate
-extern int g_sample_rate;
-
-// External MIDI system for mod wheel access
-extern midi_input_system_t g_midi_system;
 
 // Convert MIDI note to frequency
 double midi_note_to_frequency(int midi_note) {
@@ -65,19 +56,24 @@ double calculate_key_scaling(int midi_note, int break_point, int left_depth, int
     return scale;
 }
 
-void init_operators(voice_state_t* voice, const dx7_patch_t* patch, int midi_note, double velocity) {
+void init_operators(voice_state_t* voice, const dx7_patch_t* patch, int midi_note, double velocity,
+                    int sample_rate, int control_rate, dx7_sine_fn_t sine_fn) {
     voice->note_freq = midi_note_to_frequency(midi_note);
+    voice->sample_rate = sample_rate;
+    voice->control_rate = control_rate;
+    voice->sine_fn = sine_fn;
     voice->midi_note = midi_note;
     voice->velocity = velocity;
     voice->samples_played = 0;
-    voice->lfo_phase = 0.0;
+    dx7_lfo_reset(&voice->lfo, (uint32_t)midi_note);
+    voice->algorithm_fn = get_algorithm_kernel(patch->algorithm);
     
     for (int i = 0; i < MAX_OPERATORS; i++) {
         const dx7_operator_t* op = &patch->operators[i];
         operator_state_t* op_state = &voice->operators[i];
         
         // Initialize phase
-        op_state->phase = 0.0;
+        op_state->phase = 0;
         
         // Calculate base frequency with ratio and detune
         op_state->freq = voice->note_freq * op->freq_ratio;
@@ -101,77 +97,207 @@ void init_operators(voice_state_t* voice, const dx7_patch_t* patch, int midi_not
         op_state->rate_scale = key_distance * (op->key_rate_scaling / 7.0);
         
         // Initialize envelope
-        init_envelope(&op_state->env, op, op_state->rate_scale);
+        init_envelope(&op_state->env, op, op_state->rate_scale, sample_rate);
         
         op_state->output = 0.0;
     }
 }
 
-double process_operators(voice_state_t* voice, const dx7_patch_t* patch) {
-    double op_outputs[MAX_OPERATORS];
-    double op_levels[MAX_OPERATORS];
+// Control rates a voice can run at: a power of two from 1 to DX7_BLOCK_SIZE
+bool dx7_control_rate_valid(int samples) {
+    return samples >= 1 && samples <= DX7_BLOCK_SIZE && (samples & (samples - 1)) == 0;
+}
+
+// Render frame_count samples for one voice into output
+// Everything that is constant for the block (LFO speed, mod wheel, velocity
+// factors, level scaling) is computed once up front. Each DX7_BLOCK_SIZE chunk
+// then runs three passes over contiguous arrays: the LFO, each operator's
+// envelope and oscillator, and finally the algorithm.
+//
+// The LFO and envelopes run at the control rate: each control period
+// computes their values at its last sample, and the samples in between are
+// ramped linearly from the previous period. With a control rate of 1 this is
+// exactly per-sample evaluation.
+//
+// mod carries the shared LFO, already evaluated for this block, the pitch
+// bend ramp and the mod wheel. Pass NULL (offline render) to run the
+// voice's own LFO with no bend and the wheel at zero.
+void process_operators_block(voice_state_t* voice, const dx7_patch_t* patch, const dx7_block_mod_t* mod,
+                             double* output, int frame_count) {
+    double lfo_amp_mod[DX7_BLOCK_SIZE];
+    double lfo_pitch_factor[DX7_BLOCK_SIZE];
+    double op_outputs[DX7_BLOCK_SIZE][MAX_OPERATORS];
+    double op_levels[DX7_BLOCK_SIZE][MAX_OPERATORS];
+    const int control_rate = voice->control_rate;
+    const dx7_sine_fn_t sine_fn = voice->sine_fn;
+    const int lfo_wave = patch->lfo_wave;
+    const double* lfo_values = mod ? mod->lfo_values : NULL;
     
-    // Calculate LFO speed with simple mod wheel control
-    double lfo_speed = (double)patch->lfo_speed / 99.0 * 6.0; // Base speed (0-6 Hz)
+    // Pitch bend ratio, ramped across the call from the previous block's value
+    double bend_end = mod ? mod->pitch_bend : 1.0;
+    double bend_step = mod ? (mod->pitch_bend - mod->pitch_bend_start) / frame_count : 0.0;
     
-    // Get mod wheel value and apply simple multiplier
-    double mod_wheel = 0.0;
-    if (g_midi_system.active && g_midi_system.play_mode) {
-        mod_wheel = g_midi_system.controllers.mod_wheel;
+    // Own LFO only - its speed follows the mod wheel
+    uint32_t lfo_increment = 0;
+    if (!lfo_values) {
+        lfo_increment = dx7_lfo_increment(patch, mod ? mod->mod_wheel : 0.0, voice->sample_rate);
     }
     
-    // Simple mod wheel mapping: 0.1x to 3.0x speed
-    double speed_multiplier = 0.1 + (mod_wheel * 2.9);
-    lfo_speed *= speed_multiplier;
-    
-    // Update LFO - BACK TO ORIGINAL SIMPLE APPROACH
-    voice->lfo_phase += lfo_speed / g_sample_rate;
-    if (voice->lfo_phase >= 1.0) voice->lfo_phase -= 1.0;
+    // LFO depths, faded in over the patch's LFO delay
+    double amd_depth = (double)patch->lfo_amd / 99.0 * 0.5;
+    double pmd_depth = (double)patch->lfo_pmd / 99.0 * (patch->lfo_pitch_mod_sens / 7.0) * 0.1;
+    double lfo_delay = dx7_lfo_delay_samples(patch, voice->sample_rate);
     
-    // Generate simple LFO value - ORIGINAL APPROACH
-    double lfo_value = sin(TWO_PI * voice->lfo_phase);
+    // Phase increment per Hz for the 32-bit accumulators
+    double phase_per_hz = DX7_PHASE_SCALE / voice->sample_rate;
     
-    // Process each operator - BACK TO ORIGINAL
+    // Per-operator constants: output level and velocity sensitivity
+    double op_gain[MAX_OPERATORS];
+    double vel_factor[MAX_OPERATORS];
     for (int i = 0; i < MAX_OPERATORS; i++) {
         const dx7_operator_t* op = &patch->operators[i];
-        operator_state_t* op_state = &voice->operators[i];
-        
-        // Update envelope
-        double env_level = update_envelope(&op_state->env, op, op_state->rate_scale);
+        op_gain[i] = (double)op->output_level / 99.0;
+        vel_factor[i] = 1.0 - (1.0 - voice->velocity) * (op->key_vel_sens / 7.0);
+    }
+    
+    for (int start = 0; start < frame_count; start += DX7_BLOCK_SIZE) {
+        int frames = frame_count - start;
+        if (frames > DX7_BLOCK_SIZE) frames = DX7_BLOCK_SIZE;
         
-        // Calculate output level with velocity sensitivity and keyboard scaling
-        double vel_factor = 1.0 - (1.0 - voice->velocity) * (op->key_vel_sens / 7.0);
-        double total_level = (double)op->output_level / 99.0 * env_level * vel_factor * op_state->level_scale;
+        // LFO pass - amplitude and pitch modulation are shared by all operators
+        double lfo_value = lfo_values ? lfo_values[start / control_rate] : dx7_lfo_value(&voice->lfo, lfo_wave);
+        lfo_value *= dx7_lfo_delay_gain(lfo_delay, voice->samples_played + start);
+        double amp_start = 1.0 + lfo_value * amd_depth;
+        double pitch_start = patch->lfo_pmd > 0 ? pow(2.0, lfo_value * pmd_depth) : 1.0;
+        pitch_start *= bend_end - bend_step * (frame_count - start);
         
-        // Apply LFO amplitude modulation - ORIGINAL APPROACH
-        double lfo_amp_mod = 1.0 + (lfo_value * (double)patch->lfo_amd / 99.0 * 0.5);
-        total_level *= lfo_amp_mod;
+        for (int t = 0; t < frames; t += control_rate) {
+            int n = frames - t;
+            if (n > control_rate) n = control_rate;
+            
+            if (lfo_values) {
+                lfo_value = lfo_values[(start + t) / control_rate + 1];
+            } else {
+                lfo_value = dx7_lfo_advance(&voice->lfo, lfo_wave, lfo_increment * (uint32_t)n);
+            }
+            lfo_value *= dx7_lfo_delay_gain(lfo_delay, voice->samples_played + start + t + n);
+            double amp_end = 1.0 + lfo_value * amd_depth;
+            double pitch_end = patch->lfo_pmd > 0 ? pow(2.0, lfo_value * pmd_depth) : 1.0;
+            pitch_end *= bend_end - bend_step * (frame_count - (start + t + n));
+            
+            // Ramp towards the end value, landing on it exactly
+            double amp_step = (amp_end - amp_start) / n;
+            double pitch_step = (pitch_end - pitch_start) / n;
+            for (int k = 0; k < n; k++) {
+                lfo_amp_mod[t + k] = amp_end - amp_step * (n - 1 - k);
+                lfo_pitch_factor[t + k] = pitch_end - pitch_step * (n - 1 - k);
+            }
+            
+            amp_start = amp_end;
+            pitch_start = pitch_end;
+        }
         
-        op_levels[i] = total_level;
+        // Operator passes - envelope, level and oscillator for each frame.
+        // Operators that can't reach the output this chunk are skipped
+        uint8_t live = dx7_voice_live_ops(voice, patch);
+        for (int i = 0; i < MAX_OPERATORS; i++) {
+            const dx7_operator_t* op = &patch->operators[i];
+            operator_state_t* op_state = &voice->operators[i];
+            
+            if (!(live & (1u << i))) {
+                for (int f = 0; f < frames; f++) {
+                    op_outputs[f][i] = 0.0;
+                    op_levels[f][i] = 0.0;
+                }
+                op_state->output = 0.0;
+                continue;
+            }
+            
+            double freq = op_state->freq;
+            double level_gain = op_gain[i] * vel_factor[i] * op_state->level_scale;
+            uint32_t phase = op_state->phase;
+            double env_start = op_state->env.level;
+            
+            for (int t = 0; t < frames; t += control_rate) {
+                int n = frames - t;
+                if (n > control_rate) n = control_rate;
+                
+                double env_end = advance_envelope(&op_state->env, op, op_state->rate_scale, n);
+                double env_step = (env_end - env_start) / n;
+                
+                for (int k = 0; k < n; k++) {
+                    int f = t + k;
+                    double env_level = env_end - env_step * (n - 1 - k);
+                    
+                    op_levels[f][i] = level_gain * env_level * lfo_amp_mod[f];
+                    op_outputs[f][i] = sine_fn(phase);
+                    
+                    // Fixed-point accumulator wraps at one cycle on its own
+                    phase += (uint32_t)(uint64_t)(freq * lfo_pitch_factor[f] * phase_per_hz);
+                }
+                
+                env_start = env_end;
+            }
+            
+            op_state->phase = phase;
+            op_state->output = op_outputs[frames - 1][i] * op_levels[frames - 1][i]; // Stored for feedback
+        }
         
-        // Generate sine wave (raw output without level scaling)
-        op_outputs[i] = sin(TWO_PI * op_state->phase);
+        // Algorithm pass - routing and final mix
+        for (int f = 0; f < frames; f++) {
+            double feedback_value = op_outputs[f][0] * op_levels[f][0] * (double)patch->feedback / 7.0 * 0.1;
+            output[start + f] = voice->algorithm_fn(op_outputs[f], op_levels[f], feedback_value, sine_fn);
+        }
+    }
+    
+    voice->samples_played += frame_count;
+}
+
+// Render frames of a held note as file samples: limited to +-1.0 and
+// scaled by 0.8 for headroom, the same for every offline render
+void dx7_render_note(voice_state_t* voice, const dx7_patch_t* patch, float* output, int frame_count) {
+    double block[DX7_BLOCK_SIZE];
+    for (int start = 0; start < frame_count; start += DX7_BLOCK_SIZE) {
+        int frames = frame_count - start;
+        if (frames > DX7_BLOCK_SIZE) frames = DX7_BLOCK_SIZE;
         
-        // Update phase - ORIGINAL APPROACH
-        double freq_with_lfo = op_state->freq;
+        process_operators_block(voice, patch, NULL, block, frames);
         
-        // Apply LFO pitch modulation - ORIGINAL APPROACH
-        if (patch->lfo_pmd > 0) {
-            double pitch_mod = lfo_value * (double)patch->lfo_pmd / 99.0 * (patch->lfo_pitch_mod_sens / 7.0) * 0.1;
-            freq_with_lfo *= pow(2.0, pitch_mod);
+        for (int i = 0; i < frames; i++) {
+            double sample = block[i];
+            
+            // Apply gentle limiting to prevent clipping
+            if (sample > 1.0) sample = 1.0;
+            if (sample < -1.0) sample = -1.0;
+            
+            output[start + i] = (float)sample * 0.8f; // Scale down slightly for headroom
         }
+    }
+}
+
+// Operators of a voice that can reach the output (see dx7_algorithm_live_ops)
+// An operator is sounding unless its output level, velocity or key scaling
+// zeroes it, or its envelope has died away for good. 0 = the voice is silent
+uint8_t dx7_voice_live_ops(const voice_state_t* voice, const dx7_patch_t* patch) {
+    uint8_t sounding = 0;
+    for (int i = 0; i < MAX_OPERATORS; i++) {
+        const dx7_operator_t* op = &patch->operators[i];
+        const envelope_state_t* env = &voice->operators[i].env;
         
-        op_state->phase += freq_with_lfo / g_sample_rate;
-        if (op_state->phase >= 1.0) op_state->phase -= 1.0;
-        
-        op_state->output = op_outputs[i] * total_level; // Store scaled output for feedback
+        double vel_factor = 1.0 - (1.0 - voice->velocity) * (op->key_vel_sens / 7.0);
+        if (op->output_level == 0 || vel_factor * voice->operators[i].level_scale == 0.0) {
+            continue;
+        }
+        if (!envelope_is_silent(env->stage, env->level, env->rate)) {
+            sounding |= (uint8_t)(1u << i);
+        }
     }
-    
-    // Process algorithm routing and get final output
-    double feedback_value = voice->operators[0].output * (double)patch->feedback / 7.0 * 0.1;
-    double final_output = process_algorithm(op_outputs, op_levels, patch->algorithm, feedback_value);
-    
-    voice->samples_played++;
-    
-    return final_output;
+    return dx7_algorithm_live_ops(patch->algorithm, sounding);
+}
+
+// Render a single sample
+double process_operators(voice_state_t* voice, const dx7_patch_t* patch) {
+    double output;
+    process_operators_block(voice, patch, NULL, &output, 1);
+    return output;
 }
@@ -0,0 +1,480 @@
+// strdup, strcasecmp, directory walking and clock_gettime under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include "dx7.h"
+#include "render_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Bulk patch library conversion
+// Inputs are .syx files (32-voice banks or single voices) and text .patch
+// files, named one by one or as directories searched recursively. Each
+// input file is one job on the render pool: it is read, decoded and
+// written out on its own, so a library of any size converts in the memory
+// of a few banks per thread. Loose single voices going to .syx are packed
+// into banks of 32 in input order, one job per bank.
+
+#define CONVERT_FILES_PER_BANK DX7_VMEM_VOICES
+
+typedef struct {
+    char** paths;
+    int count;
+    int capacity;
+} convert_list_t;
+
+typedef struct {
+    const convert_list_t* inputs;
+    const int* jobs;           // Bank inputs, or the first of 32 loose files
+    int bank_jobs;             // Jobs [0, bank_jobs) convert one file each
+    int loose_count;           // Loose files for .syx output, in input order
+    const int* loose;
+    const char* output_dir;
+    dx7_convert_format_t format;
+    atomic_int files_written;
+    atomic_int voices;
+    atomic_int failed;
+} convert_context_t;
+
+static const char* format_names[] = { "syx", "patch", "vced" };
+
+int dx7_convert_format_from_name(const char* name) {
+    for (int i = 0; i <= DX7_CONVERT_VCED; i++) {
+        if (strcmp(name, format_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool has_extension(const char* path, const char* extension) {
+    const char* dot = strrchr(path, '.');
+    return dot && strcasecmp(dot + 1, extension) == 0;
+}
+
+static bool list_add(convert_list_t* list, const char* path) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+        char** paths = (char**)realloc(list->paths, (size_t)capacity * sizeof(char*));
+        if (!paths) {
+            return false;
+        }
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    char* copy = strdup(path);
+    if (!copy) {
+        return false;
+    }
+    list->paths[list->count++] = copy;
+    return true;
+}
+
+static void list_free(convert_list_t* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    memset(list, 0, sizeof(*list));
+}
+
+// Add a file, or every .syx and .patch file under a directory
+static void collect_inputs(convert_list_t* list, const char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        fprintf(stderr, "⚠️ Cannot read '%s'\n", path);
+        return;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        if (has_extension(path, "syx") || has_extension(path, "patch")) {
+            list_add(list, path);
+        } else {
+            fprintf(stderr, "⚠️ Skipping '%s' - not a .syx or .patch file\n", path);
+        }
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "⚠️ Cannot open directory '%s'\n", path);
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (stat(child, &info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode) || has_extension(child, "syx") || has_extension(child, "patch")) {
+            collect_inputs(list, child);
+        }
+    }
+    closedir(dir);
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// File name without directory or extension
+void dx7_path_stem(const char* path, char* stem, size_t size) {
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char* dot = strrchr(base, '.');
+    size_t length = dot ? (size_t)(dot - base) : strlen(base);
+    if (length >= size) length = size - 1;
+    memcpy(stem, base, length);
+    stem[length] = '\0';
+}
+
+// Every .syx and .patch file among the inputs, directories searched
+// recursively, sorted by path. Returns NULL when there are none
+char** dx7_list_patch_files(const char* const* inputs, int input_count, int* count) {
+    convert_list_t list = {0};
+    for (int i = 0; i < input_count; i++) {
+        collect_inputs(&list, inputs[i]);
+    }
+    *count = list.count;
+    if (list.count == 0) {
+        list_free(&list);
+        return NULL;
+    }
+    qsort(list.paths, (size_t)list.count, sizeof(char*), compare_paths);
+    return list.paths;
+}
+
+void dx7_free_patch_files(char** paths, int count) {
+    convert_list_t list = { paths, count, count };
+    list_free(&list);
+}
+
+// Decode every voice in an input file into a new array, -1 on failure.
+// records, if not NULL, gets a new array of the voices packed as VMEM:
+// bank voices are the file's own bytes, anything else is packed from the
+// decoded voice
+int dx7_decode_patch_file(const char* path, dx7_patch_t** voices, uint8_t** records) {
+    *voices = NULL;
+    if (records) *records = NULL;
+
+    if (has_extension(path, "patch")) {
+        *voices = (dx7_patch_t*)malloc(sizeof(dx7_patch_t));
+        if (records) *records = (uint8_t*)malloc(DX7_VMEM_VOICE_SIZE);
+        if (!*voices || (records && !*records) || read_patch_file(path, *voices, NULL) != 0) {
+            free(*voices);
+            *voices = NULL;
+            if (records) {
+                free(*records);
+                *records = NULL;
+            }
+            return -1;
+        }
+        if (records) dx7_patch_to_vmem(*voices, *records);
+        return 1;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "❌ Cannot open '%s'\n", path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // Every voice takes at least 128 bytes of the file, so this is enough room
+    int slots = size > 0 ? (int)(size / DX7_VMEM_VOICE_SIZE) : 0;
+    uint8_t* data = (uint8_t*)malloc(size > 0 ? (size_t)size : 1);
+    *voices = (dx7_patch_t*)malloc((size_t)(slots > 0 ? slots : 1) * sizeof(dx7_patch_t));
+    if (records) *records = (uint8_t*)malloc((size_t)(slots > 0 ? slots : 1) * DX7_VMEM_VOICE_SIZE);
+    int count = -1;
+    if (data && *voices && (!records || *records) && fread(data, 1, (size_t)size, file) == (size_t)size) {
+        count = dx7_sysex_decode(data, (size_t)size, *voices, records ? *records : NULL, slots);
+    }
+    fclose(file);
+    free(data);
+
+    if (count <= 0) {
+        fprintf(stderr, "❌ '%s' %s\n", path, count == 0 ? "holds no DX7 voices" : "is corrupt (length or checksum)");
+        free(*voices);
+        *voices = NULL;
+        if (records) {
+            free(*records);
+            *records = NULL;
+        }
+        return -1;
+    }
+    return count;
+}
+
+// Yamaha's INIT VOICE, for filling up a partial bank
+static void init_voice(dx7_patch_t* patch) {
+    memset(patch, 0, sizeof(dx7_patch_t));
+    strcpy(patch->name, "INIT VOICE");
+    patch->algorithm = 1;
+    patch->pitch_bend_range = 2;
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        dx7_operator_t* operator = &patch->operators[op];
+        operator->freq_ratio = 1.0;
+        operator->output_level = op == 0 ? 99 : 0;
+        operator->key_level_scale_break_point = 39;
+        for (int i = 0; i < ENVELOPE_STAGES; i++) {
+            operator->env_rates[i] = 99;
+            operator->env_levels[i] = i < 3 ? 99 : 0;
+        }
+    }
+    for (int i = 0; i < ENVELOPE_STAGES; i++) {
+        patch->pitch_env_rates[i] = 99;
+        patch->pitch_env_levels[i] = 50;
+    }
+}
+
+static bool write_file(const char* path, const void* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "❌ Cannot create '%s'\n", path);
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+// Write voices as 32-voice banks: name.syx, then name_2.syx ... for more
+static int write_banks(const char* output_dir, const char* stem, const dx7_patch_t* voices, int count) {
+    dx7_patch_t bank[DX7_VMEM_VOICES];
+    uint8_t dump[DX7_VMEM_DUMP_SIZE];
+    char path[4096];
+    int written = 0;
+
+    for (int first = 0, part = 1; first < count; first += DX7_VMEM_VOICES, part++) {
+        for (int i = 0; i < DX7_VMEM_VOICES; i++) {
+            if (first + i < count) {
+                bank[i] = voices[first + i];
+            } else {
+                init_voice(&bank[i]);
+            }
+        }
+        dx7_bank_to_sysex(bank, 0, dump);
+
+        if (part == 1) {
+            snprintf(path, sizeof(path), "%s/%s.syx", output_dir, stem);
+        } else {
+            snprintf(path, sizeof(path), "%s/%s_%d.syx", output_dir, stem, part);
+        }
+        if (!write_file(path, dump, sizeof(dump))) {
+            return -1;
+        }
+        written++;
+    }
+    return written;
+}
+
+// Write each voice to its own file: name.ext for a single voice, otherwise
+// name_01.ext, name_02.ext ...
+static int write_voices(const char* output_dir, const char* stem, dx7_convert_format_t format,
+                        const dx7_patch_t* voices, int count) {
+    char path[4096];
+    const char* extension = format == DX7_CONVERT_PATCH ? "patch" : "syx";
+
+    for (int i = 0; i < count; i++) {
+        if (count == 1) {
+            snprintf(path, sizeof(path), "%s/%s.%s", output_dir, stem, extension);
+        } else {
+            snprintf(path, sizeof(path), "%s/%s_%02d.%s", output_dir, stem, i + 1, extension);
+        }
+
+        bool ok;
+        if (format == DX7_CONVERT_PATCH) {
+            ok = write_patch_file(path, &voices[i]) == 0;
+        } else {
+            dx7_sysex_voice_t sysex;
+            ok = dx7_patch_to_sysex(&voices[i], &sysex, 0) && write_file(path, &sysex, sizeof(sysex));
+        }
+        if (!ok) {
+            return -1;
+        }
+    }
+    return count;
+}
+
+// Job: one input file converted on its own
+static void convert_file(convert_context_t* context, int input) {
+    const char* path = context->inputs->paths[input];
+    dx7_patch_t* voices;
+    int count = dx7_decode_patch_file(path, &voices, NULL);
+    if (count < 0) {
+        atomic_fetch_add(&context->failed, 1);
+        return;
+    }
+
+    char stem[256];
+    dx7_path_stem(path, stem, sizeof(stem));
+    int written = context->format == DX7_CONVERT_SYX
+                ? write_banks(context->output_dir, stem, voices, count)
+                : write_voices(context->output_dir, stem, context->format, voices, count);
+    free(voices);
+
+    if (written < 0) {
+        atomic_fetch_add(&context->failed, 1);
+        return;
+    }
+    atomic_fetch_add(&context->files_written, written);
+    atomic_fetch_add(&context->voices, count);
+}
+
+// Job: up to 32 loose voice files packed into bank_NNNN.syx
+static void convert_loose_bank(convert_context_t* context, int first) {
+    dx7_patch_t collected[DX7_VMEM_VOICES * 2];
+    int count = 0;
+    int end = first + CONVERT_FILES_PER_BANK;
+    if (end > context->loose_count) end = context->loose_count;
+
+    dx7_patch_t* pack = collected;
+    int capacity = DX7_VMEM_VOICES * 2;
+    for (int i = first; i < end; i++) {
+        dx7_patch_t* voices;
+        int found = dx7_decode_patch_file(context->inputs->paths[context->loose[i]], &voices, NULL);
+        if (found < 0) {
+            atomic_fetch_add(&context->failed, 1);
+            continue;
+        }
+        if (count + found > capacity) {
+            // A file with several single voices - rare, so grow off the stack
+            int grown = (count + found) * 2;
+            dx7_patch_t* bigger = (dx7_patch_t*)malloc((size_t)grown * sizeof(dx7_patch_t));
+            if (!bigger) {
+                free(voices);
+                atomic_fetch_add(&context->failed, 1);
+                continue;
+            }
+            memcpy(bigger, pack, (size_t)count * sizeof(dx7_patch_t));
+            if (pack != collected) free(pack);
+            pack = bigger;
+            capacity = grown;
+        }
+        memcpy(pack + count, voices, (size_t)found * sizeof(dx7_patch_t));
+        count += found;
+        free(voices);
+    }
+
+    if (count > 0) {
+        char stem[32];
+        snprintf(stem, sizeof(stem), "bank_%04d", first / CONVERT_FILES_PER_BANK + 1);
+        int written = write_banks(context->output_dir, stem, pack, count);
+        if (written < 0) {
+            atomic_fetch_add(&context->failed, 1);
+        } else {
+            atomic_fetch_add(&context->files_written, written);
+            atomic_fetch_add(&context->voices, count);
+        }
+    }
+    if (pack != collected) free(pack);
+}
+
+static void convert_job(int worker, int job, void* context) {
+    (void)worker;
+    convert_context_t* convert = (convert_context_t*)context;
+    if (job < convert->bank_jobs) {
+        convert_file(convert, convert->jobs[job]);
+    } else {
+        convert_loose_bank(convert, (job - convert->bank_jobs) * CONVERT_FILES_PER_BANK);
+    }
+}
+
+// Convert every input to format in output_dir on threads threads (0 = one
+// per core). Returns the number of inputs that failed, or -1 if nothing
+// could be converted at all
+int dx7_convert(const char* const* inputs, int input_count, const char* output_dir,
+                dx7_convert_format_t format, int threads) {
+    convert_list_t list = {0};
+    list.paths = dx7_list_patch_files(inputs, input_count, &list.count);
+    list.capacity = list.count;
+    if (list.count == 0) {
+        fprintf(stderr, "❌ No .syx or .patch files to convert\n");
+        return -1;
+    }
+
+    if (mkdir(output_dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "❌ Cannot create output directory '%s'\n", output_dir);
+        list_free(&list);
+        return -1;
+    }
+
+    // Banks convert file by file; for .syx output the loose single voices
+    // (text patches, single-voice dumps) are gathered 32 files to a bank
+    int* jobs = (int*)malloc((size_t)list.count * sizeof(int));
+    int* loose = (int*)malloc((size_t)list.count * sizeof(int));
+    if (!jobs || !loose) {
+        free(jobs);
+        free(loose);
+        list_free(&list);
+        return -1;
+    }
+
+    convert_context_t context = {
+        .inputs = &list,
+        .jobs = jobs,
+        .loose = loose,
+        .output_dir = output_dir,
+        .format = format
+    };
+    for (int i = 0; i < list.count; i++) {
+        bool bank_file = false;
+        if (format != DX7_CONVERT_SYX) {
+            bank_file = true;
+        } else if (has_extension(list.paths[i], "syx")) {
+            struct stat info;
+            bank_file = stat(list.paths[i], &info) == 0 && info.st_size >= DX7_VMEM_DUMP_SIZE;
+        }
+        if (bank_file) {
+            jobs[context.bank_jobs++] = i;
+        } else {
+            loose[context.loose_count++] = i;
+        }
+    }
+    int loose_banks = (context.loose_count + CONVERT_FILES_PER_BANK - 1) / CONVERT_FILES_PER_BANK;
+    int job_count = context.bank_jobs + loose_banks;
+    atomic_init(&context.files_written, 0);
+    atomic_init(&context.voices, 0);
+    atomic_init(&context.failed, 0);
+
+    render_pool_t pool;
+    int running = render_pool_start(&pool, threads, job_count);
+
+    printf("🔄 Converting %d files to %s on %d threads...\n", list.count, format_names[format], running);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Files are claimed one at a time, so slow files don't hold up a thread's
+    // share of the rest
+    render_pool_run_all(&pool, convert_job, &context, job_count);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    render_pool_free(&pool);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    int voices = atomic_load(&context.voices);
+    int failed = atomic_load(&context.failed);
+    double banks = (double)voices / DX7_VMEM_VOICES;
+
+    printf("✅ Converted %d voices (%.1f banks) into %d files in %.3f s - %.1f banks/s\n",
+           voices, banks, atomic_load(&context.files_written), seconds,
+           seconds > 0.0 ? banks / seconds : 0.0);
+    if (failed > 0) {
+        printf("⚠️ %d files could not be converted\n", failed);
+    }
+
+    free(jobs);
+    free(loose);
+    list_free(&list);
+    return failed;
+}
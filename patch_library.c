@@ -0,0 +1,370 @@
+// mmap, open and clock_gettime under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include "dx7.h"
+#include "render_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Patch library
+// Voices are stored exactly as a bulk dump packs them, so opening a library
+// is one mmap plus a header check, and fetching a voice is one
+// dx7_vmem_to_patch(). Two voices with identical parameters are the same
+// sound whatever they are called, so the canonical hash covers everything
+// but the name and building keeps only the first of each.
+
+#define VMEM_NAME_OFFSET 118
+#define VMEM_NAME_LENGTH 10
+
+// FNV-1a over the sound parameters of a packed voice (the name is ignored)
+uint64_t dx7_vmem_hash(const uint8_t* vmem) {
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < VMEM_NAME_OFFSET; i++) {
+        hash = (hash ^ vmem[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Lookup form of a name: at most 10 characters as the DX7 stores them,
+// upper case, underscores as spaces, trailing spaces dropped
+static int name_key(const char* name, size_t length, char* key) {
+    int used = 0;
+    for (size_t i = 0; i < length && i < VMEM_NAME_LENGTH && name[i]; i++) {
+        char c = name[i] == '_' ? ' ' : (char)toupper((unsigned char)name[i]);
+        key[used++] = c;
+    }
+    while (used > 0 && key[used - 1] == ' ') used--;
+    key[used] = '\0';
+    return used;
+}
+
+static uint32_t name_hash(const char* key) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = key; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    return hash;
+}
+
+static const uint8_t* library_record(const dx7_library_t* library, int index) {
+    return library->records + (size_t)index * DX7_VMEM_VOICE_SIZE;
+}
+
+// Building
+
+typedef struct {
+    char** paths;
+    uint8_t** records;      // Per file: its voices, packed
+    int* counts;            // Per file: voices, -1 if it couldn't be read
+} build_context_t;
+
+// Job: decode one input file into packed voices - a bank's own bytes, so
+// nothing the patch format doesn't model is lost or merged in the dedupe
+static void build_job(int worker, int job, void* context) {
+    (void)worker;
+    build_context_t* build = (build_context_t*)context;
+
+    dx7_patch_t* voices;
+    uint8_t* records;
+    int count = dx7_decode_patch_file(build->paths[job], &voices, &records);
+    build->counts[job] = count;
+    build->records[job] = records;
+    free(voices);
+}
+
+static uint32_t table_size(uint32_t count) {
+    uint32_t slots = 16;
+    while (slots < count * 2) slots <<= 1;
+    return slots;
+}
+
+// Build a library from .syx/.patch files and directories. Inputs are read
+// in parallel, then merged in sorted path order so the result doesn't
+// depend on the thread count. Returns the number of voices written, -1 on
+// failure
+int dx7_library_build(const char* const* inputs, int input_count, const char* path, int threads) {
+    int file_count;
+    char** paths = dx7_list_patch_files(inputs, input_count, &file_count);
+    if (!paths) {
+        fprintf(stderr, "❌ No .syx or .patch files to build a library from\n");
+        return -1;
+    }
+
+    build_context_t build = {
+        .paths = paths,
+        .records = (uint8_t**)calloc((size_t)file_count, sizeof(uint8_t*)),
+        .counts = (int*)calloc((size_t)file_count, sizeof(int))
+    };
+    if (!build.records || !build.counts) {
+        free(build.records);
+        free(build.counts);
+        dx7_free_patch_files(paths, file_count);
+        return -1;
+    }
+
+    render_pool_t pool;
+    render_pool_start(&pool, threads, file_count);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    render_pool_run_all(&pool, build_job, &build, file_count);
+    render_pool_free(&pool);
+
+    // Merge, keeping the first voice with each set of parameters
+    size_t total = 0;
+    int failed = 0;
+    for (int i = 0; i < file_count; i++) {
+        if (build.counts[i] < 0) failed++;
+        else total += (size_t)build.counts[i];
+    }
+
+    uint32_t dedupe_slots = table_size((uint32_t)total);
+    uint32_t index_slots = table_size((uint32_t)total);
+    size_t records_size = total * DX7_VMEM_VOICE_SIZE;
+    size_t hashes_size = total * sizeof(uint64_t);
+
+    uint8_t* records = (uint8_t*)malloc(records_size ? records_size : 1);
+    uint64_t* hashes = (uint64_t*)malloc(hashes_size ? hashes_size : 1);
+    int32_t* dedupe = (int32_t*)malloc((size_t)dedupe_slots * sizeof(int32_t));
+    dx7_library_slot_t* index = (dx7_library_slot_t*)calloc(index_slots, sizeof(dx7_library_slot_t));
+
+    int written = -1;
+    uint32_t kept = 0;
+    int duplicates = 0;
+    if (records && hashes && dedupe && index) {
+        memset(dedupe, 0xFF, (size_t)dedupe_slots * sizeof(int32_t));
+
+        for (int file = 0; file < file_count; file++) {
+            for (int v = 0; v < build.counts[file]; v++) {
+                const uint8_t* record = build.records[file] + (size_t)v * DX7_VMEM_VOICE_SIZE;
+                uint64_t hash = dx7_vmem_hash(record);
+
+                // Identical parameters are a duplicate; equal hashes alone aren't
+                uint32_t slot = (uint32_t)hash & (dedupe_slots - 1);
+                bool duplicate = false;
+                while (dedupe[slot] >= 0) {
+                    const uint8_t* other = records + (size_t)dedupe[slot] * DX7_VMEM_VOICE_SIZE;
+                    if (hashes[dedupe[slot]] == hash && memcmp(other, record, VMEM_NAME_OFFSET) == 0) {
+                        duplicate = true;
+                        break;
+                    }
+                    slot = (slot + 1) & (dedupe_slots - 1);
+                }
+                if (duplicate) {
+                    duplicates++;
+                    continue;
+                }
+                dedupe[slot] = (int32_t)kept;
+                memcpy(records + (size_t)kept * DX7_VMEM_VOICE_SIZE, record, DX7_VMEM_VOICE_SIZE);
+                hashes[kept] = hash;
+
+                // Name index - the first voice with a name answers for it
+                char key[VMEM_NAME_LENGTH + 1];
+                name_key((const char*)record + VMEM_NAME_OFFSET, VMEM_NAME_LENGTH, key);
+                uint32_t h = name_hash(key);
+                uint32_t probe = h & (index_slots - 1);
+                bool taken = false;
+                while (index[probe].voice != 0) {
+                    if (index[probe].name_hash == h) {
+                        char other[VMEM_NAME_LENGTH + 1];
+                        const uint8_t* named = records + (size_t)(index[probe].voice - 1) * DX7_VMEM_VOICE_SIZE;
+                        name_key((const char*)named + VMEM_NAME_OFFSET, VMEM_NAME_LENGTH, other);
+                        if (strcmp(key, other) == 0) {
+                            taken = true;
+                            break;
+                        }
+                    }
+                    probe = (probe + 1) & (index_slots - 1);
+                }
+                if (!taken) {
+                    index[probe].name_hash = h;
+                    index[probe].voice = kept + 1;
+                }
+                kept++;
+            }
+        }
+
+        // Written under a temporary name so a reader never maps half a file
+        dx7_library_header_t header = {
+            .magic = DX7_LIBRARY_MAGIC,
+            .version = DX7_LIBRARY_VERSION,
+            .voice_count = kept,
+            .index_slots = index_slots,
+            .records_offset = sizeof(dx7_library_header_t)
+        };
+        header.hashes_offset = header.records_offset + (uint64_t)kept * DX7_VMEM_VOICE_SIZE;
+        header.index_offset = header.hashes_offset + (uint64_t)kept * sizeof(uint64_t);
+
+        char temp[4096];
+        snprintf(temp, sizeof(temp), "%s.tmp", path);
+        FILE* file = fopen(temp, "wb");
+        if (file) {
+            bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                      fwrite(records, DX7_VMEM_VOICE_SIZE, kept, file) == kept &&
+                      fwrite(hashes, sizeof(uint64_t), kept, file) == kept &&
+                      fwrite(index, sizeof(dx7_library_slot_t), index_slots, file) == index_slots;
+            if (fclose(file) != 0) ok = false;
+            if (ok && rename(temp, path) == 0) {
+                written = (int)kept;
+            } else {
+                remove(temp);
+            }
+        }
+        if (written < 0) {
+            fprintf(stderr, "❌ Cannot write library '%s'\n", path);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (written >= 0) {
+        printf("✅ Library %s: %d voices from %d files (%d duplicates skipped) in %.3f s\n",
+               path, written, file_count - failed, duplicates, seconds);
+    }
+    if (failed > 0) {
+        printf("⚠️ %d files could not be read\n", failed);
+    }
+
+    for (int i = 0; i < file_count; i++) {
+        free(build.records[i]);
+    }
+    free(build.records);
+    free(build.counts);
+    free(records);
+    free(hashes);
+    free(dedupe);
+    free(index);
+    dx7_free_patch_files(paths, file_count);
+    return written;
+}
+
+// Reading
+
+bool dx7_library_open(dx7_library_t* library, const char* path) {
+    memset(library, 0, sizeof(*library));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open library '%s'\n", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(dx7_library_header_t)) {
+        fprintf(stderr, "Error: '%s' is not a patch library\n", path);
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map library '%s'\n", path);
+        return false;
+    }
+
+    // Check the header describes a file of exactly this size
+    const dx7_library_header_t* header = (const dx7_library_header_t*)map;
+    uint64_t voices = header->voice_count;
+    uint64_t slots = header->index_slots;
+    bool valid = memcmp(header->magic, DX7_LIBRARY_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == DX7_LIBRARY_VERSION &&
+                 slots >= 2 * voices && (slots & (slots - 1)) == 0 &&
+                 header->records_offset == sizeof(dx7_library_header_t) &&
+                 header->hashes_offset == header->records_offset + voices * DX7_VMEM_VOICE_SIZE &&
+                 header->index_offset == header->hashes_offset + voices * sizeof(uint64_t) &&
+                 header->index_offset + slots * sizeof(dx7_library_slot_t) == size;
+
+    // Every index slot is empty or names a voice, and at least one is empty
+    // so a lookup always ends
+    if (valid) {
+        const dx7_library_slot_t* index = (const dx7_library_slot_t*)((const uint8_t*)map + header->index_offset);
+        uint64_t empty = 0;
+        for (uint64_t i = 0; i < slots && valid; i++) {
+            empty += index[i].voice == 0;
+            valid = index[i].voice <= voices;
+        }
+        valid = valid && empty > 0;
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: '%s' is not a version %d patch library\n", path, DX7_LIBRARY_VERSION);
+        munmap(map, size);
+        return false;
+    }
+
+    library->map = map;
+    library->size = size;
+    library->header = header;
+    library->records = (const uint8_t*)map + header->records_offset;
+    library->hashes = (const uint64_t*)((const uint8_t*)map + header->hashes_offset);
+    library->index = (const dx7_library_slot_t*)((const uint8_t*)map + header->index_offset);
+    return true;
+}
+
+void dx7_library_close(dx7_library_t* library) {
+    if (library->map) {
+        munmap(library->map, library->size);
+    }
+    memset(library, 0, sizeof(*library));
+}
+
+int dx7_library_count(const dx7_library_t* library) {
+    return library->header ? (int)library->header->voice_count : 0;
+}
+
+// Voice index for a name (case and '_' vs ' ' don't matter), -1 if none
+int dx7_library_find(const dx7_library_t* library, const char* name) {
+    if (!library->header || library->header->voice_count == 0) {
+        return -1;
+    }
+
+    char key[VMEM_NAME_LENGTH + 1];
+    name_key(name, strlen(name), key);
+    uint32_t h = name_hash(key);
+    uint32_t mask = library->header->index_slots - 1;
+
+    // Bounded by the table size as well as the empty slot open() checked for
+    uint32_t probe = h & mask;
+    for (uint32_t n = 0; n <= mask && library->index[probe].voice != 0; n++, probe = (probe + 1) & mask) {
+        const dx7_library_slot_t* slot = &library->index[probe];
+        if (slot->name_hash != h) {
+            continue;
+        }
+        char other[VMEM_NAME_LENGTH + 1];
+        name_key((const char*)library_record(library, (int)slot->voice - 1) + VMEM_NAME_OFFSET,
+                 VMEM_NAME_LENGTH, other);
+        if (strcmp(key, other) == 0) {
+            return (int)slot->voice - 1;
+        }
+    }
+    return -1;
+}
+
+// Voice index for "#n" (0-based) or a name, -1 if none
+int dx7_library_select(const dx7_library_t* library, const char* selector) {
+    if (selector[0] == '#') {
+        char* end;
+        long index = strtol(selector + 1, &end, 10);
+        if (*end != '\0' || end == selector + 1 || index < 0 || index >= dx7_library_count(library)) {
+            return -1;
+        }
+        return (int)index;
+    }
+    return dx7_library_find(library, selector);
+}
+
+bool dx7_library_get(const dx7_library_t* library, int index, dx7_patch_t* patch) {
+    if (index < 0 || index >= dx7_library_count(library)) {
+        return false;
+    }
+    dx7_vmem_to_patch(library_record(library, index), patch);
+    return true;
+}
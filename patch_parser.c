@@ -0,0 +1,421 @@
+// strcasecmp and clock_gettime under -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include "dx7.h"
+#include "render_pool.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+// Text patch parser
+// A .patch file is "KEY = VALUE" lines, "OPn" lines opening each operator's
+// section, blank lines and # comments. The file is read in one go and
+// scanned once: each key is looked up by binary search in a sorted table
+// that says where its value goes and what range it has, so adding a
+// parameter is one table row. Numbers are parsed in place. Unknown keys,
+// malformed lines and out-of-range values (clamped) are reported as
+// file:line and counted, never silently taken.
+
+typedef enum {
+    KEY_VOICE,      // Field of dx7_patch_t
+    KEY_OPERATOR    // Field of the current OPn's dx7_operator_t
+} key_scope_t;
+
+typedef enum {
+    KEY_INT,
+    KEY_RATIO,      // double; min/max in hundredths
+    KEY_NAME
+} key_type_t;
+
+typedef struct {
+    const char* name;
+    uint8_t scope;
+    uint16_t offset;
+    uint8_t type;
+    int16_t min;
+    int16_t max;
+} patch_key_t;
+
+#define VOICE(field) KEY_VOICE, offsetof(dx7_patch_t, field)
+#define OPERATOR(field) KEY_OPERATOR, offsetof(dx7_operator_t, field)
+
+// Sorted by name (strcmp order) for the binary search
+static const patch_key_t patch_keys[] = {
+    { "ALGORITHM",                   VOICE(algorithm),                         KEY_INT,   1, 32 },
+    { "AMP_MOD_SENS",                OPERATOR(amp_mod_sens),                   KEY_INT,   0, 3 },
+    { "DETUNE",                      OPERATOR(detune),                         KEY_INT,  -7, 7 },
+    { "ENV_ATTACK",                  OPERATOR(env_rates[ENV_ATTACK]),          KEY_INT,   0, 99 },
+    { "ENV_DECAY1",                  OPERATOR(env_rates[ENV_DECAY1]),          KEY_INT,   0, 99 },
+    { "ENV_DECAY2",                  OPERATOR(env_rates[ENV_DECAY2]),          KEY_INT,   0, 99 },
+    { "ENV_LEVEL1",                  OPERATOR(env_levels[ENV_ATTACK]),         KEY_INT,   0, 99 },
+    { "ENV_LEVEL2",                  OPERATOR(env_levels[ENV_DECAY1]),         KEY_INT,   0, 99 },
+    { "ENV_LEVEL3",                  OPERATOR(env_levels[ENV_DECAY2]),         KEY_INT,   0, 99 },
+    { "ENV_LEVEL4",                  OPERATOR(env_levels[ENV_RELEASE]),        KEY_INT,   0, 99 },
+    { "ENV_RELEASE",                 OPERATOR(env_rates[ENV_RELEASE]),         KEY_INT,   0, 99 },
+    { "FEEDBACK",                    VOICE(feedback),                          KEY_INT,   0, 7 },
+    { "FREQ_RATIO",                  OPERATOR(freq_ratio),                     KEY_RATIO, 50, 3199 },
+    { "KEY_LEVEL_SCALE_BREAK_POINT", OPERATOR(key_level_scale_break_point),    KEY_INT,   0, 99 },
+    { "KEY_LEVEL_SCALE_LEFT_CURVE",  OPERATOR(key_level_scale_left_curve),     KEY_INT,   0, 3 },
+    { "KEY_LEVEL_SCALE_LEFT_DEPTH",  OPERATOR(key_level_scale_left_depth),     KEY_INT,   0, 99 },
+    { "KEY_LEVEL_SCALE_RIGHT_CURVE", OPERATOR(key_level_scale_right_curve),    KEY_INT,   0, 3 },
+    { "KEY_LEVEL_SCALE_RIGHT_DEPTH", OPERATOR(key_level_scale_right_depth),    KEY_INT,   0, 99 },
+    { "KEY_RATE_SCALING",            OPERATOR(key_rate_scaling),               KEY_INT,   0, 7 },
+    { "KEY_VEL_SENS",                OPERATOR(key_vel_sens),                   KEY_INT,   0, 7 },
+    { "LFO_AMD",                     VOICE(lfo_amd),                           KEY_INT,   0, 99 },
+    { "LFO_DELAY",                   VOICE(lfo_delay),                         KEY_INT,   0, 99 },
+    { "LFO_PITCH_MOD_SENS",          VOICE(lfo_pitch_mod_sens),                KEY_INT,   0, 7 },
+    { "LFO_PMD",                     VOICE(lfo_pmd),                           KEY_INT,   0, 99 },
+    { "LFO_SPEED",                   VOICE(lfo_speed),                         KEY_INT,   0, 99 },
+    { "LFO_SYNC",                    VOICE(lfo_sync),                          KEY_INT,   0, 1 },
+    { "LFO_WAVE",                    VOICE(lfo_wave),                          KEY_INT,   0, 5 },
+    { "NAME",                        VOICE(name),                              KEY_NAME,  0, 0 },
+    { "OSC_MODE",                    OPERATOR(osc_mode),                       KEY_INT,   0, 1 },
+    { "OSC_SYNC",                    OPERATOR(osc_sync),                       KEY_INT,   0, 1 },
+    { "OUTPUT_LEVEL",                OPERATOR(output_level),                   KEY_INT,   0, 99 },
+    { "PITCH_BEND_RANGE",            VOICE(pitch_bend_range),                  KEY_INT,   0, 12 },
+    { "PITCH_ENV_LEVEL1",            VOICE(pitch_env_levels[0]),               KEY_INT,   0, 99 },
+    { "PITCH_ENV_LEVEL2",            VOICE(pitch_env_levels[1]),               KEY_INT,   0, 99 },
+    { "PITCH_ENV_LEVEL3",            VOICE(pitch_env_levels[2]),               KEY_INT,   0, 99 },
+    { "PITCH_ENV_LEVEL4",            VOICE(pitch_env_levels[3]),               KEY_INT,   0, 99 },
+    { "PITCH_ENV_RATE1",             VOICE(pitch_env_rates[0]),                KEY_INT,   0, 99 },
+    { "PITCH_ENV_RATE2",             VOICE(pitch_env_rates[1]),                KEY_INT,   0, 99 },
+    { "PITCH_ENV_RATE3",             VOICE(pitch_env_rates[2]),                KEY_INT,   0, 99 },
+    { "PITCH_ENV_RATE4",             VOICE(pitch_env_rates[3]),                KEY_INT,   0, 99 },
+    { "TRANSPOSE",                   VOICE(transpose),                         KEY_INT, -24, 24 },
+};
+
+#define PATCH_KEY_COUNT ((int)(sizeof(patch_keys) / sizeof(patch_keys[0])))
+
+// Longest number accepted - more digits than any parameter needs
+#define MAX_NUMBER_DIGITS 15
+
+static const patch_key_t* find_key(const char* key, size_t length) {
+    int low = 0, high = PATCH_KEY_COUNT - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        const char* name = patch_keys[mid].name;
+        int cmp = strncmp(key, name, length);
+        if (cmp == 0) {
+            cmp = name[length] ? -1 : 0; // The key is a prefix of the name
+        }
+        if (cmp == 0) return &patch_keys[mid];
+        if (cmp < 0) high = mid - 1;
+        else low = mid + 1;
+    }
+    return NULL;
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// [+-]digits[.digits], the whole token - false for anything else
+static bool parse_number(const char* text, size_t length, bool fraction, double* value) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i++] == '-';
+    }
+
+    uint64_t mantissa = 0;
+    uint64_t scale = 1;
+    int digits = 0;
+    bool point = false;
+    for (; i < length; i++) {
+        if (is_digit(text[i])) {
+            if (++digits > MAX_NUMBER_DIGITS) return false;
+            mantissa = mantissa * 10 + (uint64_t)(text[i] - '0');
+            if (point) scale *= 10;
+        } else if (text[i] == '.' && fraction && !point) {
+            point = true;
+        } else {
+            return false;
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    // Both exact, so the quotient is the correctly rounded value
+    *value = (double)mantissa / (double)scale;
+    if (negative) *value = -*value;
+    return true;
+}
+
+static void report(const char* source, int line, const char* problem, const char* text, size_t length) {
+    fprintf(stderr, "⚠️ %s:%d: %s '%.*s'\n", source, line, problem, (int)length, text);
+}
+
+// Store one value, clamping it into the key's range
+static bool set_value(const patch_key_t* key, void* base, const char* text, size_t length,
+                      const char* source, int line, dx7_patch_issues_t* issues) {
+    char* field = (char*)base + key->offset;
+
+    if (key->type == KEY_NAME) {
+        size_t used = length < MAX_PATCH_NAME - 1 ? length : MAX_PATCH_NAME - 1;
+        memcpy(field, text, used);
+        field[used] = '\0';
+        return true;
+    }
+
+    double value;
+    if (!parse_number(text, length, key->type == KEY_RATIO, &value)) {
+        report(source, line, key->type == KEY_RATIO ? "not a number:" : "not an integer:", text, length);
+        issues->malformed++;
+        return false;
+    }
+
+    double scale = key->type == KEY_RATIO ? 100.0 : 1.0;
+    double min = key->min / scale, max = key->max / scale;
+    if (value < min || value > max) {
+        fprintf(stderr, "⚠️ %s:%d: %s = %.*s is outside %g..%g - clamped\n",
+                source, line, key->name, (int)length, text, min, max);
+        issues->out_of_range++;
+        value = value < min ? min : max;
+    }
+
+    if (key->type == KEY_RATIO) {
+        *(double*)field = value;
+    } else {
+        *(int*)field = (int)value;
+    }
+    return true;
+}
+
+// Parse a text patch held in memory. source names it in the messages.
+// Returns the number of problems found (also counted into issues)
+int dx7_parse_patch(const char* text, size_t length, const char* source,
+                    dx7_patch_t* patch, dx7_patch_issues_t* issues) {
+    dx7_patch_issues_t found = {0};
+
+    // Defaults for anything the file leaves out
+    memset(patch, 0, sizeof(dx7_patch_t));
+    strcpy(patch->name, "INIT VOICE");
+    patch->algorithm = 1;
+    patch->pitch_bend_range = 2;
+
+    // -1 before any OPn line, -2 after an invalid one (already reported)
+    int current_operator = -1;
+    const char* end = text + length;
+    int line_number = 0;
+
+    for (const char* line = text; line < end; ) {
+        const char* line_end = memchr(line, '\n', (size_t)(end - line));
+        if (!line_end) line_end = end;
+        const char* next = line_end + 1;
+        line_number++;
+
+        const char* c = line;
+        while (c < line_end && is_space(*c)) c++;
+        const char* stop = line_end;
+        while (stop > c && is_space(stop[-1])) stop--;
+
+        // Blank lines and comments
+        if (c == stop || *c == '#') {
+            line = next;
+            continue;
+        }
+
+        // The key: everything up to a space or '='
+        const char* key = c;
+        while (c < stop && !is_space(*c) && *c != '=') c++;
+        size_t key_length = (size_t)(c - key);
+
+        const char* rest = c;
+        while (rest < stop && is_space(*rest)) rest++;
+
+        // Operator section header
+        if (key_length > 2 && key[0] == 'O' && key[1] == 'P' && (rest == stop || *rest == '#')) {
+            double number;
+            if (parse_number(key + 2, key_length - 2, false, &number)) {
+                current_operator = (int)number - 1;
+                if (current_operator < 0 || current_operator >= MAX_OPERATORS) {
+                    report(source, line_number, "no such operator:", key, key_length);
+                    found.out_of_range++;
+                    current_operator = -2;
+                }
+                line = next;
+                continue;
+            }
+        }
+
+        c = rest;
+        if (c == stop || *c != '=') {
+            report(source, line_number, "expected KEY = VALUE, got", line, (size_t)(stop - line));
+            found.malformed++;
+            line = next;
+            continue;
+        }
+        c++;
+        while (c < stop && is_space(*c)) c++;
+
+        // The value is one word; anything after it is ignored, and said so
+        const char* value = c;
+        while (c < stop && !is_space(*c)) c++;
+        size_t value_length = (size_t)(c - value);
+        while (c < stop && is_space(*c)) c++;
+
+        const patch_key_t* entry = find_key(key, key_length);
+        if (!entry) {
+            report(source, line_number, "unknown key", key, key_length);
+            found.unknown_keys++;
+        } else if (value_length == 0) {
+            report(source, line_number, "no value for", key, key_length);
+            found.malformed++;
+        } else if (entry->scope == KEY_OPERATOR && current_operator == -1) {
+            report(source, line_number, "operator parameter before any OPn line:", key, key_length);
+            found.malformed++;
+        } else if (entry->scope == KEY_VOICE || current_operator >= 0) {
+            void* base = entry->scope == KEY_VOICE ? (void*)patch : (void*)&patch->operators[current_operator];
+            if (set_value(entry, base, value, value_length, source, line_number, &found) &&
+                c < stop && *c != '#') {
+                report(source, line_number, "ignoring text after the value:", c, (size_t)(stop - c));
+                found.malformed++;
+            }
+        }
+
+        line = next;
+    }
+
+    if (issues) {
+        issues->unknown_keys += found.unknown_keys;
+        issues->out_of_range += found.out_of_range;
+        issues->malformed += found.malformed;
+    }
+    return found.unknown_keys + found.out_of_range + found.malformed;
+}
+
+// Read and parse a text patch without announcing it (problems still go
+// to stderr). Returns -1 if the file can't be read
+int read_patch_file(const char* filename, dx7_patch_t* patch, dx7_patch_issues_t* issues) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open patch file '%s'\n", filename);
+        return -1;
+    }
+
+    char* text = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        text = (char*)malloc((size_t)size + 1);
+    }
+    if (!text || fread(text, 1, (size_t)size, file) != (size_t)size) {
+        fprintf(stderr, "Error: Cannot read patch file '%s'\n", filename);
+        free(text);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    dx7_parse_patch(text, (size_t)size, filename, patch, issues);
+    free(text);
+    return 0;
+}
+
+typedef struct {
+    const char* const* paths;
+    dx7_patch_t* patches;
+    dx7_patch_issues_t* issues;
+    atomic_int loaded;
+} load_context_t;
+
+static void load_job(int worker, int job, void* context) {
+    (void)worker;
+    load_context_t* load = (load_context_t*)context;
+
+    dx7_patch_issues_t* issues = &load->issues[job];
+    memset(issues, 0, sizeof(*issues));
+    if (read_patch_file(load->paths[job], &load->patches[job], issues) == 0) {
+        atomic_fetch_add_explicit(&load->loaded, 1, memory_order_relaxed);
+    } else {
+        issues->unreadable = true;
+    }
+}
+
+// Load count text patches on threads threads (0 = one per core) into
+// patches[], with each file's problems in issues[]. Returns how many files
+// could be read
+int dx7_load_patch_files(const char* const* paths, int count, dx7_patch_t* patches,
+                         dx7_patch_issues_t* issues, int threads) {
+    load_context_t load = {
+        .paths = paths,
+        .patches = patches,
+        .issues = issues
+    };
+    atomic_init(&load.loaded, 0);
+
+    render_pool_t pool;
+    render_pool_start(&pool, threads, count);
+    render_pool_run_all(&pool, load_job, &load, count);
+    render_pool_free(&pool);
+
+    return atomic_load(&load.loaded);
+}
+
+// Check every .patch file among the inputs (directories are searched).
+// Returns the number of files with problems, -1 if there was nothing to check
+int dx7_check_patches(const char* const* inputs, int input_count, int threads) {
+    int file_count;
+    char** paths = dx7_list_patch_files(inputs, input_count, &file_count);
+    int count = 0;
+    if (paths) {
+        // Banks are binary and checked by their checksums instead
+        for (int i = 0; i < file_count; i++) {
+            const char* dot = strrchr(paths[i], '.');
+            if (dot && strcasecmp(dot + 1, "patch") == 0) {
+                char* path = paths[count];
+                paths[count++] = paths[i];
+                paths[i] = path;
+            }
+        }
+    }
+    if (count == 0) {
+        fprintf(stderr, "❌ No .patch files to check\n");
+        dx7_free_patch_files(paths, file_count);
+        return -1;
+    }
+
+    dx7_patch_t* patches = (dx7_patch_t*)malloc((size_t)count * sizeof(dx7_patch_t));
+    dx7_patch_issues_t* issues = (dx7_patch_issues_t*)malloc((size_t)count * sizeof(dx7_patch_issues_t));
+    if (!patches || !issues) {
+        free(patches);
+        free(issues);
+        dx7_free_patch_files(paths, file_count);
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int loaded = dx7_load_patch_files((const char* const*)paths, count, patches, issues, threads);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    dx7_patch_issues_t total = {0};
+    int bad_files = count - loaded;
+    for (int i = 0; i < count; i++) {
+        total.unknown_keys += issues[i].unknown_keys;
+        total.out_of_range += issues[i].out_of_range;
+        total.malformed += issues[i].malformed;
+        if (!issues[i].unreadable &&
+            issues[i].unknown_keys + issues[i].out_of_range + issues[i].malformed > 0) {
+            bad_files++;
+        }
+    }
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s Checked %d patches in %.3f s (%.0f patches/s)\n", bad_files ? "⚠️" : "✅",
+           count, seconds, seconds > 0.0 ? count / seconds : 0.0);
+    if (bad_files) {
+        printf("   %d files with problems: %d unknown keys, %d out of range, %d malformed, %d unreadable\n",
+               bad_files, total.unknown_keys, total.out_of_range, total.malformed, count - loaded);
+    }
+
+    free(patches);
+    free(issues);
+    dx7_free_patch_files(paths, file_count);
+    return bad_files;
+}
@@ -0,0 +1,212 @@
+#ifdef __linux__
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include "render_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread/qos.h>
+#endif
+
+// Idle backoff: spin, then yield, then nap
+#define RENDER_POOL_SPIN_COUNT  4000
+#define RENDER_POOL_YIELD_COUNT 200
+#define RENDER_POOL_NAP_NS      50000   // 50 us
+
+#define BATCH_GENERATION(b) ((uint32_t)((b) >> 32))
+#define BATCH_COUNT(b)      ((int)(((b) >> 16) & 0xFFFF))
+#define BATCH_NEXT(b)       ((int)((b) & 0xFFFF))
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+int render_pool_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+// Claim the next job of the current batch, -1 when none are left
+static int claim_job(render_pool_t* pool) {
+    uint_least64_t batch = atomic_load_explicit(&pool->batch, memory_order_acquire);
+    for (;;) {
+        if (BATCH_NEXT(batch) >= BATCH_COUNT(batch)) {
+            return -1;
+        }
+        // The generation travels with the claim, so a worker that stalls
+        // across batches can never take a job from the wrong one
+        if (atomic_compare_exchange_weak_explicit(&pool->batch, &batch, batch + 1,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            return BATCH_NEXT(batch);
+        }
+    }
+}
+
+// Run jobs until the batch is exhausted, returns how many this thread ran
+static int run_jobs(render_pool_t* pool, int worker) {
+    int ran = 0;
+    int job;
+    while ((job = claim_job(pool)) >= 0) {
+        // job_fn/context are stable while we hold an unfinished claim
+        pool->job_fn(worker, job, pool->job_context);
+        atomic_fetch_add_explicit(&pool->jobs_done, 1, memory_order_release);
+        ran++;
+    }
+    return ran;
+}
+
+// Keep each worker on its own core where the OS allows it
+static void pin_worker(int worker) {
+#if defined(__APPLE__)
+    // macOS has no hard affinity: distinct tags ask for distinct L2 caches,
+    // and the interactive QoS class keeps workers off the efficiency cores
+    thread_affinity_policy_data_t policy = { worker };
+    thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY,
+                      (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#elif defined(__linux__)
+    // Core 0 is left to the audio callback thread - workers take the other
+    // cores in turn, sharing them when there are more workers than cores
+    int cores = render_pool_cpu_count();
+    if (cores < 2) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(1 + (worker - 1) % (cores - 1), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)worker;
+#endif
+}
+
+static void* worker_main(void* arg) {
+    render_pool_worker_t* start = (render_pool_worker_t*)arg;
+    render_pool_t* pool = start->pool;
+    int worker = start->worker;
+    int idle = 0;
+
+    pin_worker(worker);
+
+    while (atomic_load_explicit(&pool->running, memory_order_relaxed)) {
+        if (run_jobs(pool, worker) > 0) {
+            idle = 0;
+            continue;
+        }
+
+        idle++;
+        if (idle < RENDER_POOL_SPIN_COUNT) {
+            cpu_relax();
+        } else if (idle < RENDER_POOL_SPIN_COUNT + RENDER_POOL_YIELD_COUNT) {
+            sched_yield();
+        } else {
+            struct timespec nap = { 0, RENDER_POOL_NAP_NS };
+            nanosleep(&nap, NULL);
+        }
+    }
+    return NULL;
+}
+
+bool render_pool_init(render_pool_t* pool, int worker_count) {
+    memset(pool, 0, sizeof(render_pool_t));
+    if (worker_count < 0) worker_count = 0;
+    if (worker_count > RENDER_POOL_MAX_THREADS) worker_count = RENDER_POOL_MAX_THREADS;
+
+    atomic_init(&pool->batch, 0);
+    atomic_init(&pool->jobs_done, 0);
+    atomic_init(&pool->running, true);
+
+    for (int i = 0; i < worker_count; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].worker = i + 1;
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            printf("❌ Failed to start render worker %d\n", i + 1);
+            break;
+        }
+        pool->worker_count++;
+    }
+    return pool->worker_count == worker_count;
+}
+
+void render_pool_free(render_pool_t* pool) {
+    atomic_store_explicit(&pool->running, false, memory_order_relaxed);
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pool->worker_count = 0;
+}
+
+void render_pool_run(render_pool_t* pool, render_job_fn fn, void* context, int job_count) {
+    if (job_count <= 0) {
+        return;
+    }
+    if (pool->worker_count == 0 || job_count == 1) {
+        for (int job = 0; job < job_count; job++) {
+            fn(0, job, context);
+        }
+        return;
+    }
+
+    // Publish the batch: everything written here is released by the store
+    pool->job_fn = fn;
+    pool->job_context = context;
+    atomic_store_explicit(&pool->jobs_done, 0, memory_order_relaxed);
+
+    uint32_t generation = BATCH_GENERATION(atomic_load_explicit(&pool->batch, memory_order_relaxed)) + 1;
+    uint_least64_t batch = ((uint_least64_t)generation << 32) | ((uint_least64_t)(job_count & 0xFFFF) << 16);
+    atomic_store_explicit(&pool->batch, batch, memory_order_release);
+
+    // Work alongside the pool, then wait for jobs other threads claimed
+    run_jobs(pool, 0);
+    while (atomic_load_explicit(&pool->jobs_done, memory_order_acquire) < job_count) {
+        cpu_relax();
+    }
+}
+
+int render_pool_start(render_pool_t* pool, int threads, int job_count) {
+    if (threads <= 0) {
+        threads = render_pool_cpu_count();
+    }
+    if (threads > RENDER_POOL_MAX_THREADS + 1) {
+        threads = RENDER_POOL_MAX_THREADS + 1;
+    }
+    if (threads > job_count) {
+        threads = job_count > 0 ? job_count : 1;
+    }
+    if (!render_pool_init(pool, threads - 1)) {
+        printf("⚠️ Running on %d of %d threads\n", pool->worker_count + 1, threads);
+    }
+    return pool->worker_count + 1;
+}
+
+// One batch of a longer run, its job numbers shifted to the whole run's
+typedef struct {
+    render_job_fn fn;
+    void* context;
+    int offset;
+} run_all_batch_t;
+
+static void run_all_job(int worker, int job, void* context) {
+    const run_all_batch_t* batch = (const run_all_batch_t*)context;
+    batch->fn(worker, batch->offset + job, batch->context);
+}
+
+void render_pool_run_all(render_pool_t* pool, render_job_fn fn, void* context, int job_count) {
+    run_all_batch_t batch = { fn, context, 0 };
+    for (; batch.offset < job_count; batch.offset += RENDER_POOL_MAX_JOBS) {
+        int count = job_count - batch.offset;
+        if (count > RENDER_POOL_MAX_JOBS) count = RENDER_POOL_MAX_JOBS;
+        render_pool_run(pool, run_all_job, &batch, count);
+    }
+}
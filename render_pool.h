@@ -0,0 +1,74 @@
+#ifndef RENDER_POOL_H
+#define RENDER_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Worker threads for splitting an audio block across cores
+// The audio thread publishes a batch of jobs, takes jobs itself alongside
+// the workers, and spins until every claimed job has finished. There are
+// no locks or condition variables: the handoff is one atomic word holding
+// the batch generation, job count and next unclaimed job. Idle workers spin
+// briefly, then yield, then nap - a napping worker simply claims nothing,
+// so a batch never waits for a thread to wake up.
+
+#define RENDER_POOL_MAX_THREADS 64
+#define RENDER_POOL_MAX_JOBS    65535   // Per batch
+
+// Called once per job; worker 0 is the audio thread, 1..n the pool threads
+typedef void (*render_job_fn)(int worker, int job, void* context);
+
+struct render_pool;
+
+typedef struct {
+    struct render_pool* pool;
+    int worker;
+    pthread_t thread;
+} render_pool_worker_t;
+
+typedef struct render_pool {
+    // Batch state: generation (32 bits) | job count (16) | next job (16)
+    _Alignas(64) atomic_uint_least64_t batch;
+    _Alignas(64) atomic_int jobs_done;
+
+    // Set before the batch is published
+    _Alignas(64) render_job_fn job_fn;
+    void* job_context;
+
+    atomic_bool running;
+    int worker_count;                        // Pool threads, not counting the caller
+    render_pool_worker_t workers[RENDER_POOL_MAX_THREADS];
+} render_pool_t;
+
+// Start worker_count threads (0 is valid: every batch runs on the caller)
+bool render_pool_init(render_pool_t* pool, int worker_count);
+void render_pool_free(render_pool_t* pool);
+
+// Run job_count jobs (at most RENDER_POOL_MAX_JOBS) and return once all
+// have finished (caller thread only)
+void render_pool_run(render_pool_t* pool, render_job_fn fn, void* context, int job_count);
+
+// Online cores, for sizing the pool
+int render_pool_cpu_count(void);
+
+// Batch work (file conversion, offline rendering) on a pool of its own.
+// Start one for job_count jobs on threads threads (0 = one per core, never
+// more than there are jobs or a pool holds). Returns the threads running,
+// the caller included - fewer than asked if some couldn't be started
+int render_pool_start(render_pool_t* pool, int threads, int job_count);
+
+// Run any number of jobs, RENDER_POOL_MAX_JOBS at a time; fn gets each
+// job's index in the whole run (caller thread only)
+void render_pool_run_all(render_pool_t* pool, render_job_fn fn, void* context, int job_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RENDER_POOL_H
@@ -0,0 +1,324 @@
+#include "rt_log.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// How long the logger sleeps when the ring is empty
+#define RT_LOG_POLL_NS 10000000   // 10 ms
+
+typedef union {
+    long long i;
+    unsigned long long u;
+    double d;
+    const void* p;
+} rt_log_arg_t;
+
+// One preformatted binary record
+typedef struct {
+    atomic_uint sequence;         // Slot ownership, stored relative to the slot index
+    uint8_t level;
+    uint8_t argc;
+    const char* format;
+    rt_log_arg_t args[RT_LOG_MAX_ARGS];
+} rt_log_record_t;
+
+// Bounded multi-producer ring: a slot whose sequence equals the write index
+// is free, sequence == index + 1 means it holds a record for the consumer.
+// Sequences are stored minus the slot number so the zeroed ring starts out
+// with every slot free and needs no initialisation
+static struct {
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) unsigned tail;     // Logger thread only
+    _Alignas(64) atomic_uint dropped;
+    atomic_int level;
+    rt_log_record_t records[RT_LOG_SIZE];
+} g_log = {
+    .level = RT_LOG_INFO
+};
+
+static pthread_t g_logger_thread;
+static atomic_bool g_logger_running = false;
+
+static const char* level_names[] = { "error", "warn", "info", "debug" };
+
+static unsigned load_sequence(unsigned slot) {
+    return atomic_load_explicit(&g_log.records[slot].sequence, memory_order_acquire) + slot;
+}
+
+static void store_sequence(unsigned slot, unsigned sequence) {
+    atomic_store_explicit(&g_log.records[slot].sequence, sequence - slot, memory_order_release);
+}
+
+void rt_log_set_level(rt_log_level_t level) {
+    atomic_store_explicit(&g_log.level, level, memory_order_relaxed);
+}
+
+rt_log_level_t rt_log_get_level(void) {
+    return (rt_log_level_t)atomic_load_explicit(&g_log.level, memory_order_relaxed);
+}
+
+int rt_log_level_from_name(const char* name) {
+    for (int i = 0; i <= RT_LOG_DEBUG; i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+unsigned rt_log_dropped(void) {
+    return atomic_load_explicit(&g_log.dropped, memory_order_relaxed);
+}
+
+// Step over one conversion specification, returning its conversion
+// character and length modifier ('l' for l, 'L' for ll, 'z' for z)
+static const char* scan_conversion(const char* p, char* conversion, char* length) {
+    p++; // '%'
+    while (*p && strchr("-+ #0123456789.", *p)) p++;
+
+    *length = 0;
+    if (p[0] == 'l' && p[1] == 'l') { *length = 'L'; p += 2; }
+    else if (*p == 'l') { *length = 'l'; p++; }
+    else if (*p == 'z') { *length = 'z'; p++; }
+
+    *conversion = *p;
+    return *p ? p + 1 : p;
+}
+
+// Producer side: copy the arguments out, no formatting
+void rt_log(rt_log_level_t level, const char* format, ...) {
+    if ((int)level > atomic_load_explicit(&g_log.level, memory_order_relaxed)) {
+        return;
+    }
+
+    // Claim a slot - the only retry is losing the race to another producer
+    unsigned slot;
+    unsigned pos = atomic_load_explicit(&g_log.head, memory_order_relaxed);
+    for (;;) {
+        slot = pos & (RT_LOG_SIZE - 1);
+        int diff = (int)(load_sequence(slot) - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&g_log.head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Logger hasn't caught up - drop rather than wait
+            atomic_fetch_add_explicit(&g_log.dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&g_log.head, memory_order_relaxed);
+        }
+    }
+
+    rt_log_record_t* record = &g_log.records[slot];
+    record->level = (uint8_t)level;
+    record->format = format;
+    record->argc = 0;
+
+    va_list args;
+    va_start(args, format);
+    for (const char* p = format; *p && record->argc < RT_LOG_MAX_ARGS; ) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+
+        char conversion, length;
+        p = scan_conversion(p, &conversion, &length);
+        rt_log_arg_t* arg = &record->args[record->argc++];
+
+        switch (conversion) {
+            case 'd': case 'i': case 'c':
+                if (length == 'L') arg->i = va_arg(args, long long);
+                else if (length == 'l') arg->i = va_arg(args, long);
+                else if (length == 'z') arg->i = (long long)va_arg(args, size_t);
+                else arg->i = va_arg(args, int);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                if (length == 'L') arg->u = va_arg(args, unsigned long long);
+                else if (length == 'l') arg->u = va_arg(args, unsigned long);
+                else if (length == 'z') arg->u = va_arg(args, size_t);
+                else arg->u = va_arg(args, unsigned);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+                arg->d = va_arg(args, double);
+                break;
+            case 's': case 'p':
+                arg->p = va_arg(args, const void*);
+                break;
+            default:
+                record->argc--; // Unsupported - printed verbatim by the logger
+                break;
+        }
+    }
+    va_end(args);
+
+    // Hand the record to the logger
+    store_sequence(slot, pos + 1);
+}
+
+// Logger side: format one record, one conversion at a time so every
+// argument is passed to snprintf with its real type
+static void print_record(const rt_log_record_t* record) {
+    char line[512];
+    size_t used = 0;
+    int arg_index = 0;
+
+    if (record->level <= RT_LOG_WARN) {
+        used = (size_t)snprintf(line, sizeof(line), "[%s] ", level_names[record->level]);
+    }
+
+    for (const char* p = record->format; *p && used < sizeof(line) - 1; ) {
+        if (*p != '%' || p[1] == '%') {
+            line[used++] = *p;
+            p += (*p == '%') ? 2 : 1;
+            continue;
+        }
+
+        char conversion, length;
+        const char* end = scan_conversion(p, &conversion, &length);
+
+        char spec[32];
+        size_t spec_length = (size_t)(end - p);
+        if (conversion == '\0' || spec_length >= sizeof(spec) || arg_index >= record->argc ||
+            !strchr("dicuxXofFeEgGsp", conversion)) {
+            // Unsupported or out of arguments - copy the text through
+            while (p < end && used < sizeof(line) - 1) line[used++] = *p++;
+            continue;
+        }
+        memcpy(spec, p, spec_length);
+        spec[spec_length] = '\0';
+
+        const rt_log_arg_t* arg = &record->args[arg_index++];
+        char* out = line + used;
+        size_t room = sizeof(line) - used;
+        int written;
+
+        switch (conversion) {
+            case 'd': case 'i': case 'c':
+                if (length == 'L') written = snprintf(out, room, spec, arg->i);
+                else if (length == 'l') written = snprintf(out, room, spec, (long)arg->i);
+                else if (length == 'z') written = snprintf(out, room, spec, (size_t)arg->i);
+                else written = snprintf(out, room, spec, (int)arg->i);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                if (length == 'L') written = snprintf(out, room, spec, arg->u);
+                else if (length == 'l') written = snprintf(out, room, spec, (unsigned long)arg->u);
+                else if (length == 'z') written = snprintf(out, room, spec, (size_t)arg->u);
+                else written = snprintf(out, room, spec, (unsigned)arg->u);
+                break;
+            case 's':
+                written = snprintf(out, room, spec, arg->p ? (const char*)arg->p : "(null)");
+                break;
+            case 'p':
+                written = snprintf(out, room, spec, arg->p);
+                break;
+            default:
+                written = snprintf(out, room, spec, arg->d);
+                break;
+        }
+
+        if (written > 0) {
+            used += ((size_t)written < room) ? (size_t)written : room - 1;
+        }
+        p = end;
+    }
+
+    line[used] = '\0';
+    fputs(line, stdout);
+}
+
+// Print every complete record, returns how many
+static int drain_ring(void) {
+    int count = 0;
+    for (;;) {
+        unsigned slot = g_log.tail & (RT_LOG_SIZE - 1);
+        if (load_sequence(slot) != g_log.tail + 1) {
+            break; // Empty, or the producer is still filling the slot
+        }
+
+        print_record(&g_log.records[slot]);
+
+        // Free the slot for the producer one lap ahead
+        store_sequence(slot, g_log.tail + RT_LOG_SIZE);
+        g_log.tail++;
+        count++;
+    }
+    return count;
+}
+
+static void* logger_thread_main(void* arg) {
+    (void)arg;
+    unsigned reported_drops = 0;
+
+    for (;;) {
+        bool running = atomic_load_explicit(&g_logger_running, memory_order_acquire);
+        int printed = drain_ring();
+
+        unsigned drops = rt_log_dropped();
+        if (drops != reported_drops) {
+            printf("⚠️ Log: %u messages dropped\n", drops - reported_drops);
+            reported_drops = drops;
+            printed++;
+        }
+        if (printed > 0) {
+            fflush(stdout);
+        }
+
+        if (!running) {
+            break; // Drained once more after the stop request
+        }
+        if (printed == 0) {
+            struct timespec pause = { 0, RT_LOG_POLL_NS };
+            nanosleep(&pause, NULL);
+        }
+    }
+    fflush(stdout);
+    return NULL;
+}
+
+bool rt_log_start(void) {
+    if (atomic_load(&g_logger_running)) {
+        return true;
+    }
+
+    // Lowest normal priority - the logger must never compete with audio
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    struct sched_param param = { .sched_priority = sched_get_priority_min(SCHED_OTHER) };
+    pthread_attr_setschedparam(&attr, &param);
+
+    atomic_store(&g_logger_running, true);
+    int result = pthread_create(&g_logger_thread, &attr, logger_thread_main, NULL);
+    if (result != 0) {
+        // Fall back to inherited scheduling
+        result = pthread_create(&g_logger_thread, NULL, logger_thread_main, NULL);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (result != 0) {
+        atomic_store(&g_logger_running, false);
+        printf("❌ Failed to start logger thread\n");
+        return false;
+    }
+    return true;
+}
+
+void rt_log_stop(void) {
+    if (!atomic_load(&g_logger_running)) {
+        return;
+    }
+    atomic_store_explicit(&g_logger_running, false, memory_order_release);
+    pthread_join(g_logger_thread, NULL);
+}
@@ -0,0 +1,51 @@
+#ifndef RT_LOG_H
+#define RT_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Realtime-safe logging
+// rt_log() never blocks and never formats: it copies the format pointer and
+// the raw argument values into a slot of a lock-free ring and returns. A
+// low-priority logger thread formats and prints the records. When the ring
+// is full the message is dropped and counted, and the logger reports the
+// count the next time it runs.
+//
+// Any thread may log (multi-producer); only the logger thread consumes.
+// Formats must be string literals, as must any %s argument - only the
+// pointers are stored. Supported conversions: d i c u x X o (optionally
+// with l/ll/z), f F e E g G, s, p and %%. At most RT_LOG_MAX_ARGS arguments.
+
+typedef enum {
+    RT_LOG_ERROR = 0,
+    RT_LOG_WARN,
+    RT_LOG_INFO,    // Default
+    RT_LOG_DEBUG    // High-rate events: pitch bend, pressure, voice steals
+} rt_log_level_t;
+
+#define RT_LOG_MAX_ARGS 6
+#define RT_LOG_SIZE     1024   // Slots in the ring (power of two)
+
+// Messages below the current level are discarded before touching the ring
+void rt_log_set_level(rt_log_level_t level);
+rt_log_level_t rt_log_get_level(void);
+int rt_log_level_from_name(const char* name);   // -1 if unknown
+
+void rt_log(rt_log_level_t level, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Logger thread - messages logged while it is stopped stay in the ring
+bool rt_log_start(void);
+void rt_log_stop(void);     // Prints everything still queued, then joins
+unsigned rt_log_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RT_LOG_H
@@ -0,0 +1,103 @@
+#include "dx7.h"
+
+#define TWO_PI (2.0 * M_PI)
+
+// Quarter-wave table: 2^10 entries per quadrant plus two guard points so the
+// mirrored quadrants can interpolate up to (and including) the peak
+#define SINE_TABLE_BITS 10
+#define SINE_TABLE_SIZE (1 << SINE_TABLE_BITS)
+#define SINE_FRAC_BITS (30 - SINE_TABLE_BITS)
+#define SINE_FRAC_SCALE (1.0 / (double)(1 << SINE_FRAC_BITS))
+
+static double sine_table[SINE_TABLE_SIZE + 2];
+static bool sine_table_ready = false;
+
+// Reference path: libm sin() on the phase converted back to radians
+double dx7_sine_libm(uint32_t phase) {
+    return sin(TWO_PI * ((double)phase / DX7_PHASE_SCALE));
+}
+
+// Interpolated quarter-wave table lookup
+// Bits 31-30 select the quadrant, the next 10 bits index the table and the
+// remaining 20 bits are the linear interpolation fraction
+double dx7_sine_table(uint32_t phase) {
+    uint32_t quadrant = phase >> 30;
+    uint32_t pos = phase & 0x3FFFFFFF;
+
+    // Quadrants 1 and 3 run the table backwards
+    if (quadrant & 1) {
+        pos = 0x40000000 - pos;
+    }
+
+    uint32_t index = pos >> SINE_FRAC_BITS;
+    double frac = (double)(pos & ((1u << SINE_FRAC_BITS) - 1)) * SINE_FRAC_SCALE;
+    double value = sine_table[index] + (sine_table[index + 1] - sine_table[index]) * frac;
+
+    // Quadrants 2 and 3 are the negative half cycle
+    return (quadrant & 2) ? -value : value;
+}
+
+// Odd polynomial approximation of sin(pi/2 * t) for t in [-1, 1]
+// Taylor coefficients through t^11 - max error is about 6e-8
+double dx7_sine_poly(uint32_t phase) {
+    // Signed phase covers [-pi, pi); fold the outer quadrants into [-pi/2, pi/2]
+    int64_t p = (int32_t)phase;
+    if (p > 0x40000000) {
+        p = 0x80000000LL - p;
+    } else if (p < -0x40000000) {
+        p = -0x80000000LL - p;
+    }
+
+    double t = (double)p * (1.0 / 1073741824.0); // 2^30 = quarter cycle
+    double t2 = t * t;
+    return t * (1.5707963267948966 +
+           t2 * (-0.6459640975062462 +
+           t2 * (0.0796926262461670 +
+           t2 * (-0.0046817541353187 +
+           t2 * (0.0001604411847874 +
+           t2 * (-0.0000035988432352))))));
+}
+
+// Build the table (once, before any kernel is looked up)
+void dx7_sine_init(void) {
+    if (!sine_table_ready) {
+        for (int i = 0; i < SINE_TABLE_SIZE + 2; i++) {
+            sine_table[i] = sin((double)i / SINE_TABLE_SIZE * (M_PI / 2.0));
+        }
+        sine_table_ready = true;
+    }
+}
+
+// Function for a kernel - each voice carries its own, chosen by its engine.
+// NULL if unknown, or for the table before dx7_sine_init()
+dx7_sine_fn_t dx7_sine_kernel_fn(dx7_sine_kernel_t kernel) {
+    switch (kernel) {
+        case DX7_SINE_LIBM:  return dx7_sine_libm;
+        case DX7_SINE_TABLE: return sine_table_ready ? dx7_sine_table : NULL;
+        case DX7_SINE_POLY:  return dx7_sine_poly;
+    }
+    return NULL;
+}
+
+const char* dx7_sine_kernel_name(dx7_sine_kernel_t kernel) {
+    switch (kernel) {
+        case DX7_SINE_LIBM:  return "libm";
+        case DX7_SINE_TABLE: return "table";
+        case DX7_SINE_POLY:  return "poly";
+    }
+    return "unknown";
+}
+
+// Parse a kernel name as given on the command line, -1 if unknown
+int dx7_sine_kernel_from_name(const char* name) {
+    if (strcmp(name, "libm") == 0) return DX7_SINE_LIBM;
+    if (strcmp(name, "table") == 0) return DX7_SINE_TABLE;
+    if (strcmp(name, "poly") == 0) return DX7_SINE_POLY;
+    return -1;
+}
+
+// Sine of an arbitrary angle in radians through a kernel
+double dx7_sine_radians(dx7_sine_fn_t sine, double radians) {
+    uint32_t phase = (uint32_t)(int64_t)(radians * (DX7_PHASE_SCALE / TWO_PI));
+    return sine(phase);
+}
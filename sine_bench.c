@@ -0,0 +1,132 @@
+// Sine kernel benchmark - accuracy and speed of each kernel against libm
+//
+// Build and run with: make bench
+
+#include "dx7.h"
+#include <time.h>
+
+#define TWO_PI (2.0 * M_PI)
+
+// THD test tone: an exact number of cycles in the analysis window keeps every
+// harmonic on a DFT bin, so no window function is needed
+#define THD_WINDOW 65536
+#define THD_CYCLES 1001
+#define THD_HARMONICS 10
+
+#define SPEED_ITERATIONS 50000000
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Power of a single DFT bin (Goertzel)
+static double goertzel_power(const double* samples, int count, int bin) {
+    double coeff = 2.0 * cos(TWO_PI * bin / count);
+    double s1 = 0.0, s2 = 0.0;
+    for (int i = 0; i < count; i++) {
+        double s0 = samples[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+// Maximum absolute error against libm over a stride through the full phase range
+static double measure_max_error(dx7_sine_fn_t fn) {
+    double max_error = 0.0;
+    for (uint64_t p = 0; p < 0x100000000ULL; p += 4099) {
+        double error = fabs(fn((uint32_t)p) - sin(TWO_PI * ((double)p / DX7_PHASE_SCALE)));
+        if (error > max_error) max_error = error;
+    }
+    return max_error;
+}
+
+// Distortion of a tone generated through the phase accumulator
+// THD covers harmonics 2-10; THD+N is everything left after removing the
+// fitted fundamental, which also catches the table's high-order images
+static void measure_thd(dx7_sine_fn_t fn, double* samples, double* thd, double* thd_n) {
+    uint32_t increment = (uint32_t)(THD_CYCLES * (DX7_PHASE_SCALE / THD_WINDOW));
+    uint32_t phase = 0;
+    for (int i = 0; i < THD_WINDOW; i++) {
+        samples[i] = fn(phase);
+        phase += increment;
+    }
+
+    double fundamental = goertzel_power(samples, THD_WINDOW, THD_CYCLES);
+    double harmonics = 0.0;
+    for (int h = 2; h <= THD_HARMONICS; h++) {
+        harmonics += goertzel_power(samples, THD_WINDOW, h * THD_CYCLES);
+    }
+    *thd = sqrt(harmonics / fundamental);
+
+    // Least-squares amplitude of the ideal sine, then residual energy
+    double correlation = 0.0;
+    for (int i = 0; i < THD_WINDOW; i++) {
+        correlation += samples[i] * sin(TWO_PI * THD_CYCLES * i / THD_WINDOW);
+    }
+    double amplitude = 2.0 * correlation / THD_WINDOW;
+
+    double residual = 0.0;
+    for (int i = 0; i < THD_WINDOW; i++) {
+        double error = samples[i] - amplitude * sin(TWO_PI * THD_CYCLES * i / THD_WINDOW);
+        residual += error * error;
+    }
+    *thd_n = sqrt(residual / THD_WINDOW) / (amplitude / sqrt(2.0));
+}
+
+static double to_db(double ratio) {
+    return ratio > 0.0 ? 20.0 * log10(ratio) : -INFINITY;
+}
+
+// Nanoseconds per call driving the kernel from a phase accumulator
+static double measure_speed(dx7_sine_fn_t fn) {
+    volatile double sink = 0.0;
+    uint32_t phase = 0;
+    double sum = 0.0;
+
+    double start = now_seconds();
+    for (int i = 0; i < SPEED_ITERATIONS; i++) {
+        sum += fn(phase);
+        phase += 0x01234567;
+    }
+    double elapsed = now_seconds() - start;
+
+    sink = sum;
+    (void)sink;
+    return elapsed * 1e9 / SPEED_ITERATIONS;
+}
+
+int main(void) {
+    dx7_sine_init();
+
+    double* samples = malloc(THD_WINDOW * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "Error: Cannot allocate analysis buffer\n");
+        return 1;
+    }
+
+    const dx7_sine_kernel_t kernels[] = { DX7_SINE_LIBM, DX7_SINE_TABLE, DX7_SINE_POLY };
+    const dx7_sine_fn_t functions[] = { dx7_sine_libm, dx7_sine_table, dx7_sine_poly };
+    double libm_ns = 0.0;
+
+    printf("Sine kernel benchmark (build default: %s)\n", dx7_sine_kernel_name(DX7_SINE_KERNEL));
+    printf("%-8s %12s %10s %10s %10s %9s\n",
+           "kernel", "max error", "THD dB", "THD+N dB", "ns/call", "speedup");
+
+    for (int k = 0; k < 3; k++) {
+        double thd, thd_n;
+        double max_error = measure_max_error(functions[k]);
+        measure_thd(functions[k], samples, &thd, &thd_n);
+        double ns = measure_speed(functions[k]);
+        if (kernels[k] == DX7_SINE_LIBM) libm_ns = ns;
+
+        printf("%-8s %12.3e %10.1f %10.1f %10.2f %8.2fx\n",
+               dx7_sine_kernel_name(kernels[k]), max_error,
+               to_db(thd), to_db(thd_n), ns, libm_ns / ns);
+    }
+
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "voice_bank.h"
+#include "algorithm_kernels.h"
+
+// Arena alignment - one cache line, enough for AVX2 loads
+#define VOICE_BANK_ALIGN 64
+
+// Instantiate the kernel body once per instruction set
+
+// 4 lanes: baseline SSE2 on x86-64, NEON on arm64, plain vectors elsewhere
+#define VB_WIDTH 4
+#define VB_SUFFIX vec4
+#define VB_TARGET
+#include "voice_bank_kernel.h"
+#undef VB_WIDTH
+#undef VB_SUFFIX
+#undef VB_TARGET
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VOICE_BANK_HAVE_AVX2 1
+
+// 8 lanes: compiled for AVX2 + FMA, only called when the CPU reports them
+#define VB_WIDTH 8
+#define VB_SUFFIX avx2
+#define VB_TARGET __attribute__((target("avx2,fma")))
+#include "voice_bank_kernel.h"
+#undef VB_WIDTH
+#undef VB_SUFFIX
+#undef VB_TARGET
+#endif
+
+// Best kernel the running CPU supports
+voice_bank_isa_t voice_bank_detect_isa(void) {
+#ifdef VOICE_BANK_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return VOICE_BANK_ISA_AVX2;
+    }
+#endif
+    return VOICE_BANK_ISA_VEC4;
+}
+
+const char* voice_bank_isa_name(voice_bank_isa_t isa) {
+    switch (isa) {
+        case VOICE_BANK_ISA_AUTO:
+            return "auto";
+        case VOICE_BANK_ISA_VEC4:
+#if defined(__x86_64__) || defined(__i386__)
+            return "sse2";
+#elif defined(__ARM_NEON)
+            return "neon";
+#else
+            return "vec4";
+#endif
+        case VOICE_BANK_ISA_AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+// Parse an instruction set name as given on the command line, -2 if unknown
+int voice_bank_isa_from_name(const char* name) {
+    if (strcmp(name, "auto") == 0) return VOICE_BANK_ISA_AUTO;
+    if (strcmp(name, "sse2") == 0 || strcmp(name, "neon") == 0 ||
+        strcmp(name, "vec4") == 0) return VOICE_BANK_ISA_VEC4;
+    if (strcmp(name, "avx2") == 0) return VOICE_BANK_ISA_AVX2;
+    return -2;
+}
+
+bool voice_bank_init(voice_bank_t* bank, int voices, voice_bank_isa_t isa, int sample_rate, int control_rate) {
+    memset(bank, 0, sizeof(voice_bank_t));
+
+    voice_bank_isa_t best = voice_bank_detect_isa();
+    if (isa == VOICE_BANK_ISA_AUTO) {
+        isa = best;
+    } else if (isa > best) {
+        printf("❌ CPU does not support the %s voice bank kernel\n", voice_bank_isa_name(isa));
+        return false;
+    }
+
+    // Round up to whole groups of the widest kernel
+    int capacity = (voices + VOICE_BANK_LANES - 1) / VOICE_BANK_LANES * VOICE_BANK_LANES;
+    size_t lane_bytes = (size_t)capacity * sizeof(float);
+
+    // 8 [op][lane] arrays per operator plus 7 per-lane arrays
+    size_t arrays = 8 * MAX_OPERATORS + 7;
+    void* arena = NULL;
+    if (posix_memalign(&arena, VOICE_BANK_ALIGN, arrays * lane_bytes) != 0) {
+        printf("❌ Failed to allocate voice bank\n");
+        return false;
+    }
+    memset(arena, 0, arrays * lane_bytes);
+
+    uint8_t* cursor = (uint8_t*)arena;
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        bank->phase[op] = (uint32_t*)cursor;       cursor += lane_bytes;
+        bank->freq[op] = (float*)cursor;           cursor += lane_bytes;
+        bank->gain[op] = (float*)cursor;           cursor += lane_bytes;
+        bank->env_stage[op] = (int32_t*)cursor;    cursor += lane_bytes;
+        bank->env_level[op] = (float*)cursor;      cursor += lane_bytes;
+        bank->env_rate[op] = (float*)cursor;       cursor += lane_bytes;
+        bank->env_target[op] = (float*)cursor;     cursor += lane_bytes;
+        bank->rate_scale[op] = (float*)cursor;     cursor += lane_bytes;
+    }
+    bank->lfo_phase = (uint32_t*)cursor;           cursor += lane_bytes;
+    bank->lfo_random = (uint32_t*)cursor;          cursor += lane_bytes;
+    bank->lfo_hold = (float*)cursor;               cursor += lane_bytes;
+    bank->lfo_age = (uint32_t*)cursor;             cursor += lane_bytes;
+    bank->mix_gain = (float*)cursor;               cursor += lane_bytes;
+    bank->patch_id = (uint32_t*)cursor;            cursor += lane_bytes;
+    bank->active = (uint8_t*)cursor;
+
+    bank->capacity = capacity;
+    bank->isa = isa;
+    bank->sample_rate = sample_rate;
+    bank->control_rate = control_rate;
+    bank->arena = arena;
+
+    printf("✅ Voice bank: %d lanes, %s kernel\n", capacity, voice_bank_isa_name(isa));
+    return true;
+}
+
+void voice_bank_free(voice_bank_t* bank) {
+    free(bank->arena);
+    memset(bank, 0, sizeof(voice_bank_t));
+}
+
+// Copy a freshly initialised voice into its lane
+void voice_bank_load_voice(voice_bank_t* bank, int lane, const voice_state_t* voice,
+                           const dx7_patch_t* patch, uint32_t patch_id) {
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        const dx7_operator_t* params = &patch->operators[op];
+        const operator_state_t* op_state = &voice->operators[op];
+
+        double vel_factor = 1.0 - (1.0 - voice->velocity) * (params->key_vel_sens / 7.0);
+
+        bank->phase[op][lane] = op_state->phase;
+        bank->freq[op][lane] = (float)op_state->freq;
+        bank->gain[op][lane] = (float)((double)params->output_level / 99.0 * vel_factor * op_state->level_scale);
+        bank->env_stage[op][lane] = op_state->env.stage;
+        bank->env_level[op][lane] = (float)op_state->env.level;
+        bank->env_rate[op][lane] = (float)op_state->env.rate;
+        bank->env_target[op][lane] = (float)op_state->env.target;
+        bank->rate_scale[op][lane] = (float)op_state->rate_scale;
+    }
+
+    bank->lfo_phase[lane] = voice->lfo.phase;
+    bank->lfo_random[lane] = voice->lfo.random;
+    bank->lfo_hold[lane] = (float)voice->lfo.hold;
+    bank->lfo_age[lane] = voice->samples_played < VOICE_BANK_LFO_AGE_MAX
+                        ? (uint32_t)voice->samples_played : VOICE_BANK_LFO_AGE_MAX;
+    bank->mix_gain[lane] = (float)(voice->velocity * 0.5); // Same headroom as the scalar mix
+    bank->patch_id[lane] = patch_id;
+    bank->active[lane] = 1;
+}
+
+// Move every operator of a lane into its release stage
+void voice_bank_release(voice_bank_t* bank, int lane, const dx7_patch_t* patch) {
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        envelope_state_t env = {
+            .stage = bank->env_stage[op][lane],
+            .level = bank->env_level[op][lane],
+            .rate = bank->env_rate[op][lane],
+            .target = bank->env_target[op][lane],
+            .samples_in_stage = 0,
+            .sample_rate = bank->sample_rate
+        };
+        trigger_release(&env, &patch->operators[op], bank->rate_scale[op][lane]);
+
+        bank->env_stage[op][lane] = env.stage;
+        bank->env_rate[op][lane] = (float)env.rate;
+        bank->env_target[op][lane] = (float)env.target;
+    }
+}
+
+void voice_bank_clear_lane(voice_bank_t* bank, int lane) {
+    bank->active[lane] = 0;
+    bank->mix_gain[lane] = 0.0f;
+}
+
+// Same test as the scalar path: no carrier can be heard any more
+bool voice_bank_lane_finished(const voice_bank_t* bank, int lane, const dx7_patch_t* patch) {
+    uint8_t sounding = 0;
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        if (bank->gain[op][lane] != 0.0f &&
+            !envelope_is_silent(bank->env_stage[op][lane], bank->env_level[op][lane], bank->env_rate[op][lane])) {
+            sounding |= (uint8_t)(1u << op);
+        }
+    }
+    return dx7_algorithm_live_ops(patch->algorithm, sounding) == 0;
+}
+
+void voice_bank_render(voice_bank_t* bank, const dx7_patch_t* patch,
+                       const voice_bank_controls_t* controls, float* output, int frame_count) {
+    voice_bank_render_lanes(bank, patch, controls, output, frame_count, 0, bank->capacity);
+}
+
+// Render a slice of the bank - lanes must be whole VOICE_BANK_LANES groups.
+// Slices touch disjoint state, so they can run on different threads as
+// long as each has its own output buffer
+void voice_bank_render_lanes(voice_bank_t* bank, const dx7_patch_t* patch,
+                             const voice_bank_controls_t* controls, float* output, int frame_count,
+                             int first_lane, int lane_count) {
+    int end_lane = first_lane + lane_count;
+#ifdef VOICE_BANK_HAVE_AVX2
+    if (bank->isa == VOICE_BANK_ISA_AVX2) {
+        voice_bank_render_avx2(bank, patch, controls, output, frame_count, first_lane, end_lane);
+        return;
+    }
+#endif
+    voice_bank_render_vec4(bank, patch, controls, output, frame_count, first_lane, end_lane);
+}
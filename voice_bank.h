@@ -0,0 +1,100 @@
+#ifndef VOICE_BANK_H
+#define VOICE_BANK_H
+
+#include "dx7.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Structure-of-arrays voice bank
+// Every per-voice quantity is stored as [operator][lane] so a kernel can
+// advance VOICE_BANK_LANES voices with one instruction. Lanes map 1:1 onto
+// voice slots; inactive lanes are computed but mixed at zero gain. Operators
+// that no lane of a group can hear are skipped, and groups with no audible
+// lane are skipped entirely.
+
+// Widest kernel (AVX2, 8 floats) - lane count is always a multiple of this
+#define VOICE_BANK_LANES 8
+
+// Lane ages stop counting here - inside int32 for the float conversion, and
+// long past any LFO delay
+#define VOICE_BANK_LFO_AGE_MAX 0x40000000u
+
+// Kernel instruction sets, chosen at runtime
+typedef enum {
+    VOICE_BANK_ISA_AUTO = -1,  // Pick the best the CPU supports
+    VOICE_BANK_ISA_VEC4 = 0,   // 4 lanes: SSE2 on x86, NEON on arm64
+    VOICE_BANK_ISA_AVX2        // 8 lanes: AVX2 + FMA (x86 only)
+} voice_bank_isa_t;
+
+typedef struct {
+    int capacity;                          // Lanes allocated (multiple of VOICE_BANK_LANES)
+    voice_bank_isa_t isa;                  // Kernel in use
+    int sample_rate;                       // Rate the lanes render at
+    int control_rate;                      // Samples between envelope and LFO updates
+
+    // Oscillators [op][lane]
+    uint32_t* phase[MAX_OPERATORS];        // 32-bit phase accumulator
+    float* freq[MAX_OPERATORS];            // Frequency in Hz (pitch bend is applied at render)
+    float* gain[MAX_OPERATORS];            // Output level x velocity factor x key scaling
+
+    // Envelopes [op][lane]
+    int32_t* env_stage[MAX_OPERATORS];
+    float* env_level[MAX_OPERATORS];
+    float* env_rate[MAX_OPERATORS];
+    float* env_target[MAX_OPERATORS];
+    float* rate_scale[MAX_OPERATORS];      // Keyboard rate scaling, for stage transitions
+
+    // Per lane
+    // Key-synced LFO - only advanced when the patch has lfo_sync set
+    uint32_t* lfo_phase;                   // LFO phase accumulator, same scale as phase
+    uint32_t* lfo_random;                  // Sample & hold generator
+    float* lfo_hold;                       // Sample & hold level
+    uint32_t* lfo_age;                     // Samples since note-on, for the LFO delay (saturating)
+    float* mix_gain;                       // Velocity gain, 0 for inactive lanes
+    uint32_t* patch_id;                    // Patch the lane was started with
+    uint8_t* active;
+
+    void* arena;                           // Single aligned allocation behind all arrays
+} voice_bank_t;
+
+// Controller values sampled once per block
+typedef struct {
+    double mod_wheel;          // 0.0 to 1.0
+    const double* lfo_values;  // Shared LFO from dx7_lfo_render(), NULL for per-lane key sync
+    double master_gain;        // Volume x expression, reached at the end of the block
+    double master_gain_start;  // Value at the end of the previous block (smoothing ramp)
+    double pitch_bend;         // Frequency ratio reached at the end of the block
+    double pitch_bend_start;   // Ratio at the end of the previous block
+    uint32_t patch_id;         // Only lanes started with this patch are rendered
+} voice_bank_controls_t;
+
+// Setup and CPU dispatch
+bool voice_bank_init(voice_bank_t* bank, int voices, voice_bank_isa_t isa, int sample_rate, int control_rate);
+void voice_bank_free(voice_bank_t* bank);
+voice_bank_isa_t voice_bank_detect_isa(void);
+const char* voice_bank_isa_name(voice_bank_isa_t isa);
+int voice_bank_isa_from_name(const char* name);
+
+// Lane management - lane index is the voice slot index
+void voice_bank_load_voice(voice_bank_t* bank, int lane, const voice_state_t* voice,
+                           const dx7_patch_t* patch, uint32_t patch_id);
+void voice_bank_release(voice_bank_t* bank, int lane, const dx7_patch_t* patch);
+void voice_bank_clear_lane(voice_bank_t* bank, int lane);
+bool voice_bank_lane_finished(const voice_bank_t* bank, int lane, const dx7_patch_t* patch);
+
+// Render every active lane started with controls->patch_id and mix into
+// output (output is added to, not cleared). Other lanes are left untouched,
+// so voices holding different patches take one call per patch
+void voice_bank_render(voice_bank_t* bank, const dx7_patch_t* patch,
+                       const voice_bank_controls_t* controls, float* output, int frame_count);
+void voice_bank_render_lanes(voice_bank_t* bank, const dx7_patch_t* patch,
+                             const voice_bank_controls_t* controls, float* output, int frame_count,
+                             int first_lane, int lane_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VOICE_BANK_H
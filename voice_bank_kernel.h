@@ -0,0 +1,400 @@
+// SIMD render kernel body for voice_bank.c
+//
+// Not a normal header: voice_bank.c includes it once per instruction set with
+//   VB_WIDTH   lanes per vector (4 or 8)
+//   VB_SUFFIX  suffix for the generated types and functions
+//   VB_TARGET  function attributes for the instruction set (may be empty)
+// The body uses GCC/clang vector extensions, so the same source compiles to
+// SSE2, AVX2 or NEON depending on the target it is instantiated for.
+
+#if !defined(VB_WIDTH) || !defined(VB_SUFFIX) || !defined(VB_TARGET)
+#error "voice_bank_kernel.h must be included from voice_bank.c"
+#endif
+
+#define VB_CAT_(a, b) a##_##b
+#define VB_CAT(a, b) VB_CAT_(a, b)
+#define VB(name) VB_CAT(name, VB_SUFFIX)
+
+typedef float VB(vf) __attribute__((vector_size(VB_WIDTH * 4)));
+typedef int32_t VB(vi) __attribute__((vector_size(VB_WIDTH * 4)));
+typedef uint32_t VB(vu) __attribute__((vector_size(VB_WIDTH * 4)));
+
+#define vf VB(vf)
+#define vi VB(vi)
+#define vu VB(vu)
+
+static inline VB_TARGET vf VB(splat)(float x) {
+    return (vf){0} + x;
+}
+
+static inline VB_TARGET vf VB(select)(vi mask, vf a, vf b) {
+    return (vf)(((vi)a & mask) | ((vi)b & ~mask));
+}
+
+static inline VB_TARGET vi VB(select_int)(vi mask, vi a, vi b) {
+    return (a & mask) | (b & ~mask);
+}
+
+static inline VB_TARGET vf VB(vmin)(vf a, vf b) {
+    return VB(select)(a < b, a, b);
+}
+
+static inline VB_TARGET vf VB(vmax)(vf a, vf b) {
+    return VB(select)(a > b, a, b);
+}
+
+static inline VB_TARGET bool VB(any)(vi mask) {
+    int32_t bits = 0;
+    for (int l = 0; l < VB_WIDTH; l++) bits |= mask[l];
+    return bits != 0;
+}
+
+static inline VB_TARGET float VB(hsum)(vf v) {
+    float sum = 0.0f;
+    for (int l = 0; l < VB_WIDTH; l++) sum += v[l];
+    return sum;
+}
+
+// sin(pi/2 * x) for x in [-2, 2): fold to [-1, 1] then the odd polynomial
+// from dx7_sine_poly() in single precision
+static inline VB_TARGET vf VB(sin_quarter)(vf x) {
+    vf t = VB(vmax)(VB(vmin)(x, 2.0f - x), -2.0f - x);
+    vf t2 = t * t;
+    return t * (1.5707963268f +
+           t2 * (-0.6459640975f +
+           t2 * (0.0796926262f +
+           t2 * (-0.0046817541f +
+           t2 * (0.0001604412f +
+           t2 * (-0.0000035988f))))));
+}
+
+// Sine of a 32-bit phase accumulator
+static inline VB_TARGET vf VB(sin_phase)(vu phase) {
+    vf x = __builtin_convertvector((vi)phase, vf) * (1.0f / 1073741824.0f);
+    return VB(sin_quarter)(x);
+}
+
+// Sine of an angle in radians (modest range - FM indices and feedback)
+static inline VB_TARGET vf VB(sin_radians)(vf radians) {
+    vf cycles = radians * (float)(1.0 / (2.0 * M_PI));
+    cycles -= __builtin_convertvector(__builtin_convertvector(cycles, vi), vf);
+    vf x = cycles * 4.0f;
+    x = VB(select)(x >= 2.0f, x - 4.0f, x);
+    x = VB(select)(x < -2.0f, x + 4.0f, x);
+    return VB(sin_quarter)(x);
+}
+
+// 2^x for the small exponents of the pitch LFO (|x| <= 0.1)
+static inline VB_TARGET vf VB(exp2_small)(vf x) {
+    vf y = x * 0.6931471806f;
+    return 1.0f + y * (1.0f + y * (0.5f + y * (0.1666666667f + y * 0.0416666667f)));
+}
+
+// Key-synced LFO: each lane runs its own scalar LFO, advanced by delta
+// (rare - only patches with lfo_sync set take this path)
+static inline VB_TARGET vf VB(lfo_lanes)(voice_bank_t* bank, int base, vi active, int wave, uint32_t delta) {
+    vf value = VB(splat)(0.0f);
+    for (int l = 0; l < VB_WIDTH; l++) {
+        if (!active[l]) continue;
+        dx7_lfo_t lfo = {
+            .phase = bank->lfo_phase[base + l],
+            .random = bank->lfo_random[base + l],
+            .hold = bank->lfo_hold[base + l]
+        };
+        value[l] = (float)dx7_lfo_advance(&lfo, wave, delta);
+        bank->lfo_phase[base + l] = lfo.phase;
+        bank->lfo_random[base + l] = lfo.random;
+        bank->lfo_hold[base + l] = (float)lfo.hold;
+    }
+    return value;
+}
+
+// LFO depth after frames more samples - ramps up over the patch's LFO delay
+static inline VB_TARGET vf VB(lfo_delay_gain)(vf age, float frames, float delay_scale) {
+    vf gain = (age + frames) * delay_scale - 1.0f;
+    return VB(vmin)(VB(vmax)(gain, VB(splat)(0.0f)), VB(splat)(1.0f));
+}
+
+// Operators live in any lane of a group - the vector form of
+// voice_bank_lane_finished(), with the same silence test as envelope_is_silent()
+static inline VB_TARGET uint8_t VB(group_live_ops)(const vi* stage, const vf* level, const vf* rate,
+                                                   const vf* gain, vi active, int algorithm) {
+    vi sounding = (vi){0};
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        vi silent = (level[op] <= (float)DX7_SILENCE_LEVEL) &
+                    ((stage[op] == ENV_DECAY2) | ((stage[op] == ENV_RELEASE) & (rate[op] <= 0.0f)));
+        sounding |= active & (gain[op] != 0.0f) & ~silent & (1 << op);
+    }
+
+    uint8_t live = 0;
+    for (int l = 0; l < VB_WIDTH; l++) {
+        live |= dx7_algorithm_live_ops(algorithm, (uint8_t)sounding[l]);
+    }
+    return live;
+}
+
+// Straight-line algorithm kernels - same bodies as the scalar path in algorithms.c
+// processed[] holds output x level per operator on entry, feedback already applied
+typedef vf (*VB(algorithm_fn))(vf* processed, const vf* op_levels);
+
+#define ALG_OP(op, modulation) processed[op] = VB(sin_radians)(modulation) // sin(2pi + x) == sin(x)
+#define ALG_TERM(op, strength) processed[op] * ((float)(strength) * op_levels[op] * 2.0f)
+#define ALG_CARRIER(op) processed[op]
+#define ALG_OUTPUT(sum, carriers) ((sum) * (float)(1.0 / sqrt((double)(carriers))))
+
+#define ALGORITHM_KERNEL(n) \
+static VB_TARGET vf VB(algorithm_##n)(vf* processed, const vf* op_levels) { \
+    (void)op_levels; /* Unused by algorithms without modulation */ \
+    DX7_ALGORITHM_##n \
+}
+DX7_ALGORITHM_LIST(ALGORITHM_KERNEL)
+#undef ALGORITHM_KERNEL
+
+#define ALGORITHM_ENTRY(n) VB(algorithm_##n),
+static const VB(algorithm_fn) VB(algorithm_kernels)[33] = {
+    NULL, // Index 0 unused
+    DX7_ALGORITHM_LIST(ALGORITHM_ENTRY)
+};
+#undef ALGORITHM_ENTRY
+
+#undef ALG_OP
+#undef ALG_TERM
+#undef ALG_CARRIER
+#undef ALG_OUTPUT
+
+// Render the active lanes in [first_lane, end_lane) that belong to
+// controls->patch_id and mix into output. Other lanes in a group are
+// computed along with it but their state is never written back
+static VB_TARGET void VB(voice_bank_render)(voice_bank_t* bank, const dx7_patch_t* patch,
+                                           const voice_bank_controls_t* controls,
+                                           float* output, int frame_count,
+                                           int first_lane, int end_lane) {
+    // Block constants - same derivations as process_operators_block()
+    const double* shared_lfo = controls->lfo_values;
+    const int lfo_wave = patch->lfo_wave;
+    const uint32_t lfo_increment = shared_lfo ? 0 : dx7_lfo_increment(patch, controls->mod_wheel, bank->sample_rate);
+    const double lfo_delay = dx7_lfo_delay_samples(patch, bank->sample_rate);
+    const bool delayed_lfo = lfo_delay > 0.0;
+    const float delay_scale = delayed_lfo ? (float)(2.0 / lfo_delay) : 0.0f;
+    const float phase_per_hz = (float)(DX7_PHASE_SCALE / bank->sample_rate);
+    const float amd_scale = (float)((double)patch->lfo_amd / 99.0 * 0.5);
+    const float pmd_scale = (float)((double)patch->lfo_pmd / 99.0 * (patch->lfo_pitch_mod_sens / 7.0) * 0.1);
+    const bool pitch_lfo = patch->lfo_pmd > 0;
+    const float feedback_scale = (float)((double)patch->feedback / 7.0 * 0.1);
+    const bool feedback = patch->feedback > 0;
+    const int control_rate = bank->control_rate;
+
+    // Master gain ramps across the block from the previous block's value
+    const float master_end = (float)controls->master_gain;
+    const float master_step = (float)((controls->master_gain - controls->master_gain_start) / frame_count);
+
+    // Pitch bend ramps the same way, sampled at the control points
+    const float bend_end = (float)controls->pitch_bend;
+    const float bend_step = (float)((controls->pitch_bend - controls->pitch_bend_start) / frame_count);
+
+    // Kernel picked once per block - the patch can't change mid-block
+    int algorithm = (patch->algorithm < 1 || patch->algorithm > 32) ? 1 : patch->algorithm;
+    const VB(algorithm_fn) algorithm_kernel = VB(algorithm_kernels)[algorithm];
+
+    // Rate 99 stages jump straight to their target
+    vi instant_attack[MAX_OPERATORS];
+    vi instant_decay1[MAX_OPERATORS];
+    for (int op = 0; op < MAX_OPERATORS; op++) {
+        instant_attack[op] = (vi){0} + (patch->operators[op].env_rates[ENV_ATTACK] >= 99 ? -1 : 0);
+        instant_decay1[op] = (vi){0} + (patch->operators[op].env_rates[ENV_DECAY1] >= 99 ? -1 : 0);
+    }
+
+    for (int base = first_lane; base < end_lane; base += VB_WIDTH) {
+        bool group_active = false;
+        vi active;
+        for (int l = 0; l < VB_WIDTH; l++) {
+            bool mine = bank->active[base + l] && bank->patch_id[base + l] == controls->patch_id;
+            active[l] = mine ? -1 : 0;
+            if (mine) group_active = true;
+        }
+        if (!group_active) continue;
+
+        // Pull the group's state into registers
+        vu phase[MAX_OPERATORS];
+        vf phase_inc[MAX_OPERATORS];
+        vf gain[MAX_OPERATORS];
+        vi stage[MAX_OPERATORS];
+        vf level[MAX_OPERATORS];
+        vf rate[MAX_OPERATORS];
+        vf target[MAX_OPERATORS];
+
+        for (int op = 0; op < MAX_OPERATORS; op++) {
+            phase[op] = *(const vu*)&bank->phase[op][base];
+            phase_inc[op] = *(const vf*)&bank->freq[op][base] * phase_per_hz;
+            gain[op] = *(const vf*)&bank->gain[op][base];
+            stage[op] = *(const vi*)&bank->env_stage[op][base];
+            level[op] = *(const vf*)&bank->env_level[op][base];
+            rate[op] = *(const vf*)&bank->env_rate[op][base];
+            target[op] = *(const vf*)&bank->env_target[op][base];
+        }
+
+        vf age = __builtin_convertvector(*(const vi*)&bank->lfo_age[base], vf);
+        vf mix = VB(select)(active, *(const vf*)&bank->mix_gain[base], VB(splat)(0.0f));
+
+        // Operators no lane can hear are skipped; a silent group costs nothing
+        uint8_t live = VB(group_live_ops)(stage, level, rate, gain, active, algorithm);
+        if (!live) continue;
+
+        // Control values at the start of the first period
+        vf lfo = shared_lfo ? VB(splat)((float)shared_lfo[0]) : VB(lfo_lanes)(bank, base, active, lfo_wave, 0);
+        if (delayed_lfo) lfo *= VB(lfo_delay_gain)(age, 0.0f, delay_scale);
+        vf amp_start = 1.0f + lfo * amd_scale;
+        vf pitch_start = pitch_lfo ? VB(exp2_small)(lfo * pmd_scale) : VB(splat)(1.0f);
+        pitch_start *= bend_end - bend_step * (float)frame_count;
+        vf env_start[MAX_OPERATORS];
+        for (int op = 0; op < MAX_OPERATORS; op++) {
+            env_start[op] = level[op];
+        }
+
+        for (int t = 0; t < frame_count; t += control_rate) {
+            // Recheck every DX7_BLOCK_SIZE frames so voices that die away
+            // mid-block stop costing anything straight away
+            if (t > 0 && t % DX7_BLOCK_SIZE == 0) {
+                live = VB(group_live_ops)(stage, level, rate, gain, active, algorithm);
+                if (!live) break;
+            }
+
+            int n = frame_count - t;
+            if (n > control_rate) n = control_rate;
+            const float inv_n = 1.0f / (float)n;
+
+            // LFO at the end of this control period
+            if (shared_lfo) {
+                lfo = VB(splat)((float)shared_lfo[t / control_rate + 1]);
+            } else {
+                lfo = VB(lfo_lanes)(bank, base, active, lfo_wave, lfo_increment * (uint32_t)n);
+            }
+            if (delayed_lfo) lfo *= VB(lfo_delay_gain)(age, (float)(t + n), delay_scale);
+            vf amp_end = 1.0f + lfo * amd_scale;
+            vf pitch_end = pitch_lfo ? VB(exp2_small)(lfo * pmd_scale) : VB(splat)(1.0f);
+            pitch_end *= bend_end - bend_step * (float)(frame_count - (t + n));
+            vf amp_step = (amp_end - amp_start) * inv_n;
+            vf pitch_step = (pitch_end - pitch_start) * inv_n;
+
+            // Envelopes - n linear steps for every lane, stage changes fixed up below
+            vf env_step[MAX_OPERATORS];
+            for (int op = 0; op < MAX_OPERATORS; op++) {
+                if (!(live & (1u << op))) {
+                    env_step[op] = VB(splat)(0.0f);
+                    continue;
+                }
+
+                vi is_attack = stage[op] == ENV_ATTACK;
+                vi is_decay1 = stage[op] == ENV_DECAY1;
+                vi is_decay2 = stage[op] == ENV_DECAY2;
+                vi transition = active &
+                                ((is_attack & ((level[op] >= target[op]) | instant_attack[op])) |
+                                 (is_decay1 & ((level[op] <= target[op]) | instant_decay1[op])));
+
+                vf next = level[op] + rate[op] * (float)n;
+                vf attack = VB(vmin)(next, target[op]);
+                vf decay1 = VB(vmax)(next, target[op]);
+                vf decay2 = VB(select)(level[op] > target[op], VB(vmax)(next, target[op]), level[op]);
+                vf release = VB(vmax)(next, VB(splat)(0.0f));
+                level[op] = VB(select)(is_attack, attack,
+                            VB(select)(is_decay1, decay1,
+                            VB(select)(is_decay2, decay2, release)));
+
+                // Rare: let the scalar envelope code pick the next stage's rate
+                if (VB(any)(transition)) {
+                    for (int l = 0; l < VB_WIDTH; l++) {
+                        if (!transition[l]) continue;
+                        envelope_state_t env = {
+                            .stage = stage[op][l],
+                            .level = target[op][l],
+                            .rate = rate[op][l],
+                            .target = target[op][l],
+                            .samples_in_stage = 0,
+                            .sample_rate = bank->sample_rate
+                        };
+                        advance_envelope(&env, &patch->operators[op], bank->rate_scale[op][base + l], n);
+                        stage[op][l] = env.stage;
+                        level[op][l] = (float)env.level;
+                        rate[op][l] = (float)env.rate;
+                        target[op][l] = (float)env.target;
+                    }
+                }
+
+                env_step[op] = (level[op] - env_start[op]) * inv_n;
+            }
+
+            // Audio rate - ramp the control values back from the period's end
+            for (int k = 0; k < n; k++) {
+                const int f = t + k;
+                const float back = (float)(n - 1 - k);
+                vf amp_mod = amp_end - amp_step * back;
+                vf pitch = pitch_end - pitch_step * back;
+
+                vf op_outputs[MAX_OPERATORS];
+                vf op_levels[MAX_OPERATORS];
+
+                for (int op = 0; op < MAX_OPERATORS; op++) {
+                    if (!(live & (1u << op))) {
+                        op_levels[op] = VB(splat)(0.0f);
+                        op_outputs[op] = VB(splat)(0.0f);
+                        continue;
+                    }
+                    op_levels[op] = gain[op] * (level[op] - env_step[op] * back) * amp_mod;
+                    op_outputs[op] = VB(sin_phase)(phase[op]);
+
+                    // Phase increment as uint32 - offset by 2^31 to stay in int32 range
+                    vf inc = VB(vmin)(phase_inc[op] * pitch, VB(splat)(4294967040.0f));
+                    phase[op] += (vu)__builtin_convertvector(inc - 2147483648.0f, vi) + 0x80000000u;
+                }
+
+                // Algorithm - same kernel as process_algorithm()
+                vf processed[MAX_OPERATORS];
+                for (int op = 0; op < MAX_OPERATORS; op++) {
+                    processed[op] = op_outputs[op] * op_levels[op];
+                }
+
+                if (feedback) {
+                    vf feedback_value = processed[0] * feedback_scale;
+                    processed[0] = VB(sin_radians)((float)(2.0 * M_PI) * processed[0] + feedback_value);
+                }
+
+                vf sample = algorithm_kernel(processed, op_levels);
+                float master = master_end - master_step * (float)(frame_count - 1 - f);
+                output[f] += VB(hsum)(sample * mix) * master;
+            }
+
+            amp_start = amp_end;
+            pitch_start = pitch_end;
+            for (int op = 0; op < MAX_OPERATORS; op++) {
+                env_start[op] = level[op];
+            }
+        }
+
+        // Write the group's state back - lanes of other patches keep theirs
+        for (int op = 0; op < MAX_OPERATORS; op++) {
+            vi* phase_out = (vi*)&bank->phase[op][base];
+            vi* stage_out = (vi*)&bank->env_stage[op][base];
+            vf* level_out = (vf*)&bank->env_level[op][base];
+            vf* rate_out = (vf*)&bank->env_rate[op][base];
+            vf* target_out = (vf*)&bank->env_target[op][base];
+            *phase_out = VB(select_int)(active, (vi)phase[op], *phase_out);
+            *stage_out = VB(select_int)(active, stage[op], *stage_out);
+            *level_out = VB(select)(active, level[op], *level_out);
+            *rate_out = VB(select)(active, rate[op], *rate_out);
+            *target_out = VB(select)(active, target[op], *target_out);
+        }
+        // Age stops counting well inside int32 - the delay is long over by then
+        for (int l = 0; l < VB_WIDTH; l++) {
+            if (active[l] && bank->lfo_age[base + l] < VOICE_BANK_LFO_AGE_MAX) {
+                bank->lfo_age[base + l] += (uint32_t)frame_count;
+            }
+        }
+    }
+}
+
+#undef vf
+#undef vi
+#undef vu
+#undef VB
+#undef VB_CAT
+#undef VB_CAT_
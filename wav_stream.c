@@ -0,0 +1,127 @@
+#include "dx7.h"
+
+// Streaming WAV writer
+// The renderer fills one chunk while a writer thread encodes and writes
+// the other, so synthesis and file I/O overlap and memory stays at two
+// chunks however long the render is. Each chunk is handed over with a
+// mutex and condition variable - this is the offline path, so blocking
+// is fine.
+
+static void* writer_main(void* arg) {
+    dx7_wav_stream_t* stream = (dx7_wav_stream_t*)arg;
+    int next = 0;
+
+    pthread_mutex_lock(&stream->lock);
+    for (;;) {
+        while (stream->frames[next] == 0 && !stream->closing) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        int frames = stream->frames[next];
+        if (frames == 0) {
+            break; // Closing and nothing left to write
+        }
+
+        // Chunks are written in order; the renderer can't touch this one
+        // until it is marked free again
+        pthread_mutex_unlock(&stream->lock);
+        sf_count_t written = stream->failed ? 0 : sf_write_float(stream->file, stream->chunks[next], frames);
+        pthread_mutex_lock(&stream->lock);
+
+        if (written != frames) {
+            stream->failed = true;
+        } else {
+            stream->frames_written += frames;
+        }
+        stream->frames[next] = 0;
+        pthread_cond_broadcast(&stream->changed);
+        next ^= 1;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+// Create a mono 16-bit WAV and start its writer thread
+bool dx7_wav_stream_open(dx7_wav_stream_t* stream, const char* path, int sample_rate) {
+    memset(stream, 0, sizeof(dx7_wav_stream_t));
+
+    SF_INFO sf_info = {0};
+    sf_info.samplerate = sample_rate;
+    sf_info.channels = 1; // Mono
+    sf_info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+
+    stream->file = sf_open(path, SFM_WRITE, &sf_info);
+    if (!stream->file) {
+        fprintf(stderr, "Error: Cannot create output file '%s'\n", path);
+        fprintf(stderr, "libsndfile error: %s\n", sf_strerror(NULL));
+        return false;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        stream->chunks[i] = (float*)malloc(DX7_WAV_CHUNK_FRAMES * sizeof(float));
+    }
+    if (!stream->chunks[0] || !stream->chunks[1]) {
+        fprintf(stderr, "Error: Cannot allocate audio buffer\n");
+        free(stream->chunks[0]);
+        free(stream->chunks[1]);
+        sf_close(stream->file);
+        return false;
+    }
+
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+    if (pthread_create(&stream->thread, NULL, writer_main, stream) != 0) {
+        fprintf(stderr, "Error: Cannot start the WAV writer thread\n");
+        pthread_cond_destroy(&stream->changed);
+        pthread_mutex_destroy(&stream->lock);
+        free(stream->chunks[0]);
+        free(stream->chunks[1]);
+        sf_close(stream->file);
+        return false;
+    }
+    return true;
+}
+
+// The next chunk to fill (DX7_WAV_CHUNK_FRAMES samples), waiting while the
+// writer still has it. NULL once a write has failed
+float* dx7_wav_stream_chunk(dx7_wav_stream_t* stream) {
+    pthread_mutex_lock(&stream->lock);
+    while (stream->frames[stream->filling] != 0 && !stream->failed) {
+        pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+    bool failed = stream->failed;
+    pthread_mutex_unlock(&stream->lock);
+    return failed ? NULL : stream->chunks[stream->filling];
+}
+
+// Hand the chunk from dx7_wav_stream_chunk() to the writer
+void dx7_wav_stream_submit(dx7_wav_stream_t* stream, int frames) {
+    if (frames <= 0) {
+        return;
+    }
+    pthread_mutex_lock(&stream->lock);
+    stream->frames[stream->filling] = frames;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    stream->filling ^= 1;
+}
+
+// Write what is left, stop the writer and close the file. Returns false
+// if any chunk couldn't be written
+bool dx7_wav_stream_close(dx7_wav_stream_t* stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->closing = true;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    bool ok = !stream->failed;
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write all samples to file\n");
+    }
+    sf_close(stream->file);
+    pthread_cond_destroy(&stream->changed);
+    pthread_mutex_destroy(&stream->lock);
+    free(stream->chunks[0]);
+    free(stream->chunks[1]);
+    return ok;
+}